@@ -0,0 +1,37 @@
+# Microbenchmarks of the engine's CPU hot paths. Build it on its own:
+#   qmake bench/bench.pro && make
+# and run it from anywhere, since the OBJ files are compiled in:
+#   ./MicroBench [--filter name] [--save-baseline file] [--baseline file]
+# or check the chunk meshers against the golden meshes, rewriting them
+# first with --update-goldens when the geometry is meant to change:
+#   ./MicroBench --check-meshes [--update-goldens] [--goldens file]
+QT = core
+
+TARGET = MicroBench
+TEMPLATE = app
+CONFIG += console
+CONFIG += c++1z
+CONFIG -= app_bundle
+# Timings of a debug build say little about the game
+CONFIG -= debug
+CONFIG += release
+
+INCLUDEPATH += ../include
+
+# Everything it times is in the engine core, which needs no GUI or GL
+include(../src/core.pri)
+
+RESOURCES += ../objs.qrc
+
+# Kept in the source tree, so that --update-goldens rewrites the
+# checked-in file wherever the build directory is
+DEFINES += MESHGOLDENS=\\\"$$PWD/goldens/meshes.txt\\\"
+
+SOURCES += \
+    $$PWD/benchmain.cpp \
+    $$PWD/meshgolden.cpp \
+    $$PWD/microbench.cpp
+
+HEADERS += \
+    $$PWD/meshgolden.h \
+    $$PWD/microbench.h
@@ -0,0 +1,239 @@
+#include "meshgolden.h"
+#include "microbench.h"
+#include "meshVoxelizer.h"
+#include "scene/chunk.h"
+#include "scene/progen.h"
+#include "scene/river.h"
+#include "scene/world.h"
+#include "tinyobj/tiny_obj_loader.h"
+#include <cstring>
+#include <iostream>
+#include <random>
+
+// Mesh used by the OBJ loader and voxelizer benchmarks
+#define BENCHOBJ ":/objs/cow.obj"
+
+namespace {
+
+// Results are written here so that the timed work is not optimized away
+volatile int sink;
+
+// The Chunk fixtures createVBOdata is timed on. None has neighbors, so
+// the faces on its sides are always built.
+void fillFlat(Chunk *c) {
+    for (int x = 0; x < 16; x++) {
+        for (int z = 0; z < 16; z++) {
+            for (int y = 0; y < 128; y++) {
+                c->setBlockAt(x, y, z, STONE);
+            }
+            c->setBlockAt(x, 128, z, GRASS);
+        }
+    }
+}
+
+void fillCaves(Chunk *c, ProGen &progen) {
+    fillFlat(c);
+    for (int x = 0; x < 16; x++) {
+        for (int z = 0; z < 16; z++) {
+            for (int y = 25; y < 118; y++) {
+                if (!progen.keepCave(x, y, z)) {
+                    c->setBlockAt(x, y, z, EMPTY);
+                }
+            }
+        }
+    }
+}
+
+void fillMountain(Chunk *c, ProGen &progen, int originX, int originZ) {
+    for (int x = 0; x < 16; x++) {
+        for (int z = 0; z < 16; z++) {
+            int height = std::min(255, progen.getBlockHeight(originX + x, originZ + z)[0]);
+            for (int y = 0; y < height; y++) {
+                c->setBlockAt(x, y, z, STONE);
+            }
+            c->setBlockAt(x, height, z, height > 200 ? SNOW : GRASS);
+            for (int y = height + 1; y < 132; y++) {
+                c->setBlockAt(x, y, z, WATER);
+            }
+        }
+    }
+}
+
+// Every block has six exposed faces: the most vertices a Chunk can have
+void fillCheckerboard(Chunk *c) {
+    for (int x = 0; x < 16; x++) {
+        for (int z = 0; z < 16; z++) {
+            for (int y = 0; y < 256; y++) {
+                c->setBlockAt(x, y, z, (x + y + z) % 2 ? STONE : EMPTY);
+            }
+        }
+    }
+}
+
+void benchChunkMeshing(MicroBench &bench) {
+    ProGen progen;
+    Chunk flat(0, 0), caves(0, 0), mountain(0, 0), checkerboard(0, 0);
+    fillFlat(&flat);
+    fillCaves(&caves, progen);
+    // The generated heights of the Chunk the player spawns in
+    fillMountain(&mountain, progen, 112, 192);
+    fillCheckerboard(&checkerboard);
+    const std::pair<const char *, Chunk *> fixtures[] = {
+        {"createVBOdata/flat", &flat}, {"createVBOdata/caves", &caves},
+        {"createVBOdata/mountain", &mountain}, {"createVBOdata/checkerboard", &checkerboard}
+    };
+    for (const auto &f : fixtures) {
+        Chunk *c = f.second;
+        bench.run(f.first, 16 * 256 * 16, [c]() {
+            c->createVBOdata();
+            ChunkVBOData data = c->takeVBOdata();
+        });
+    }
+}
+
+void benchProGen(MicroBench &bench) {
+    ProGen progen;
+    bench.run("getBlockHeight", 32 * 32, [&]() {
+        int total = 0;
+        for (int x = 0; x < 32; x++) {
+            for (int z = 0; z < 32; z++) {
+                total += progen.getBlockHeight(x * 7, z * 7)[0];
+            }
+        }
+        sink = total;
+    });
+    bench.run("keepCave", 16 * 16 * 16, [&]() {
+        int total = 0;
+        for (int x = 0; x < 16; x++) {
+            for (int y = 40; y < 56; y++) {
+                for (int z = 0; z < 16; z++) {
+                    total += progen.keepCave(x, y, z);
+                }
+            }
+        }
+        sink = total;
+    });
+}
+
+void benchTerrain(MicroBench &bench) {
+    uPtr<World> terrain;
+    bench.run("createTerrainZone", 64 * 64, [&]() {
+        terrain->createTerrainZone(0, 0);
+    }, [&]() {
+        terrain = mkU<World>();
+    });
+    bench.run("River::draw", 1, [&]() {
+        River river(terrain.get(), 0, 0);
+        river.draw();
+    }, [&]() {
+        terrain = mkU<World>();
+        terrain->createTerrainZone(0, 0);
+    });
+
+    // The zone and the ones around it, so that no ray leaves the World
+    terrain = mkU<World>();
+    for (int x = -64; x <= 64; x += 64) {
+        for (int z = -64; z <= 64; z += 64) {
+            terrain->createTerrainZone(x, z);
+        }
+    }
+    // Rays from above the zone towards the ground, as the player casts
+    // them when it moves and looks around
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> position(4.f, 60.f), direction(-0.5f, 0.5f);
+    std::vector<std::pair<glm::vec3, glm::vec3>> rays;
+    for (int i = 0; i < 256; i++) {
+        glm::vec3 origin(position(rng), 200.f, position(rng));
+        glm::vec3 dir = glm::normalize(glm::vec3(direction(rng), -1.f, direction(rng)));
+        rays.push_back({origin, dir * 100.f});
+    }
+    bench.run("gridMarch", rays.size(), [&]() {
+        int hits = 0;
+        for (const auto &ray : rays) {
+            float dist;
+            glm::ivec3 block;
+            hits += gridMarch(ray.first, ray.second, *terrain, &dist, &block);
+        }
+        sink = hits;
+    });
+}
+
+void benchOBJ(MicroBench &bench) {
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::vector<std::vector<int>> faces;
+    std::vector<float> positions;
+    std::string errors = tinyobj::LoadObj(shapes, materials, faces, positions, BENCHOBJ);
+    if (!errors.empty()) {
+        std::cout << "Skipping OBJ benchmarks: " << errors << std::endl;
+        return;
+    }
+    bench.run("LoadObj", faces.size(), [&]() {
+        std::vector<tinyobj::shape_t> s;
+        std::vector<tinyobj::material_t> m;
+        std::vector<std::vector<int>> f;
+        std::vector<float> p;
+        tinyobj::LoadObj(s, m, f, p, BENCHOBJ);
+    });
+    // Scaled up, as a statue would be
+    std::vector<float> scaled = positions;
+    for (float &p : scaled) {
+        p *= 8.f;
+    }
+    bench.run("voxelizeTriangles", faces.size(), [&]() {
+        sink = static_cast<int>(voxelizeTriangles(faces, scaled, glm::vec3(0.f)).size());
+    });
+}
+
+}
+
+int main(int argc, char *argv[]) {
+    std::string filter, baseline, saveBaseline;
+    std::string goldens = MESHGOLDENS;
+    bool checkMeshes = false, updateGoldens = false;
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--filter") == 0 && hasValue) {
+            filter = argv[++i];
+        } else if (std::strcmp(argv[i], "--baseline") == 0 && hasValue) {
+            baseline = argv[++i];
+        } else if (std::strcmp(argv[i], "--save-baseline") == 0 && hasValue) {
+            saveBaseline = argv[++i];
+        } else if (std::strcmp(argv[i], "--check-meshes") == 0) {
+            checkMeshes = true;
+        } else if (std::strcmp(argv[i], "--update-goldens") == 0) {
+            checkMeshes = updateGoldens = true;
+        } else if (std::strcmp(argv[i], "--goldens") == 0 && hasValue) {
+            goldens = argv[++i];
+        }
+    }
+
+    MicroBench bench(filter);
+    // Instead of the benchmarks, checks the meshers against the goldens
+    if (checkMeshes) {
+        int mismatches = checkMeshGoldens(goldens, updateGoldens, bench);
+        if (mismatches < 0) {
+            std::cerr << "Could not " << (updateGoldens ? "write " : "read ") << goldens << std::endl;
+            return 1;
+        }
+        return mismatches > 0 ? 1 : 0;
+    }
+    benchChunkMeshing(bench);
+    benchProGen(bench);
+    benchTerrain(bench);
+    benchOBJ(bench);
+
+    if (!saveBaseline.empty() && !bench.saveBaseline(saveBaseline)) {
+        std::cerr << "Could not write " << saveBaseline << std::endl;
+        return 1;
+    }
+    if (!baseline.empty()) {
+        int regressions = bench.compare(baseline);
+        if (regressions < 0) {
+            std::cerr << "Could not read " << baseline << std::endl;
+            return 1;
+        }
+        return regressions > 0 ? 1 : 0;
+    }
+    return 0;
+}
@@ -0,0 +1,326 @@
+#include "meshgolden.h"
+#include "scene/river.h"
+#include "scene/world.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <tuple>
+
+// First line of the goldens file; bump the version when the line
+// format or the canonical form changes
+#define MESHGOLDENSHEADER "miniminecraft-meshes 1"
+
+namespace {
+
+// Zones the fixtures come from: the one the player spawns in, the
+// origin and two far from both. Zones are far enough apart that no
+// Chunk sees another zone's blocks.
+const glm::ivec2 goldenZones[] = {
+    {64, 192}, {0, 0}, {-640, 320}, {1536, -2048}
+};
+
+bool isWhole(float f) {
+    return std::abs(f - std::round(f)) < 1e-4f;
+}
+
+bool faceLess(const MeshFace &a, const MeshFace &b) {
+    return std::make_tuple(a.block.x, a.block.y, a.block.z, a.direction, a.tile.x, a.tile.y, a.translucent)
+            < std::make_tuple(b.block.x, b.block.y, b.block.z, b.direction, b.tile.x, b.tile.y, b.translucent);
+}
+
+// 64-bit FNV-1a, fed one field at a time
+void hashBytes(uint64_t *hash, const void *bytes, size_t size) {
+    const unsigned char *p = static_cast<const unsigned char *>(bytes);
+    for (size_t i = 0; i < size; i++) {
+        *hash = (*hash ^ p[i]) * 1099511628211ull;
+    }
+}
+
+void hashInt(uint64_t *hash, int32_t value) {
+    hashBytes(hash, &value, sizeof(value));
+}
+
+std::string tileKey(const MeshFace &f) {
+    return std::to_string(f.tile.x) + "," + std::to_string(f.tile.y) + (f.translucent ? "t" : "");
+}
+
+// Cuts the quads of one vertex and index buffer into unit faces
+bool addFaces(const std::vector<glm::vec4> &vertices, const std::vector<uint32_t> &indices, bool translucent,
+              std::vector<MeshFace> *faces, std::string *error) {
+    // Three vec4s per vertex: position, normal and UV
+    size_t vertexCount = vertices.size() / 3;
+    if (vertices.size() % 3 != 0 || indices.size() % 6 != 0) {
+        *error = "buffer sizes are not whole vertices and quads";
+        return false;
+    }
+    for (size_t q = 0; q < indices.size(); q += 6) {
+        // The corners of the quad are the distinct positions of its two
+        // triangles
+        glm::vec3 corners[4];
+        int cornerCount = 0;
+        glm::vec3 lo(std::numeric_limits<float>::max()), hi(std::numeric_limits<float>::lowest());
+        glm::vec2 uvLo(std::numeric_limits<float>::max());
+        for (size_t i = q; i < q + 6; i++) {
+            if (indices[i] >= vertexCount) {
+                *error = "index " + std::to_string(indices[i]) + " out of range";
+                return false;
+            }
+            glm::vec3 p(vertices[indices[i] * 3]);
+            lo = glm::min(lo, p);
+            hi = glm::max(hi, p);
+            uvLo = glm::min(uvLo, glm::vec2(vertices[indices[i] * 3 + 2]));
+            if (std::find(corners, corners + cornerCount, p) == corners + cornerCount) {
+                if (cornerCount == 4) {
+                    *error = "quad " + std::to_string(q / 6) + " has more than four corners";
+                    return false;
+                }
+                corners[cornerCount++] = p;
+            }
+        }
+        glm::vec3 normal(vertices[indices[q] * 3 + 1]);
+        int axis = std::abs(normal.x) > 0.5f ? 0 : std::abs(normal.y) > 0.5f ? 1 : 2;
+        int u = (axis + 1) % 3, v = (axis + 2) % 3;
+        bool rectangle = cornerCount == 4 && lo[axis] == hi[axis] && hi[u] > lo[u] && hi[v] > lo[v];
+        for (int i = 0; i < 3; i++) {
+            rectangle = rectangle && isWhole(lo[i]) && isWhole(hi[i]);
+        }
+        if (!rectangle || std::abs(std::abs(normal[axis]) - 1.f) > 1e-4f) {
+            *error = "quad " + std::to_string(q / 6) + " is not an axis-aligned rectangle of whole blocks";
+            return false;
+        }
+
+        MeshFace face;
+        bool positive = normal[axis] > 0.f;
+        face.direction = static_cast<Direction>(axis * 2 + (positive ? 0 : 1));
+        face.tile = glm::ivec2(glm::round(uvLo / BLK_UV));
+        face.translucent = translucent;
+        // A face pointing along +axis lies on the far side of its block
+        face.block[axis] = static_cast<int>(std::round(lo[axis])) - (positive ? 1 : 0);
+        for (int a = static_cast<int>(std::round(lo[u])); a < static_cast<int>(std::round(hi[u])); a++) {
+            for (int b = static_cast<int>(std::round(lo[v])); b < static_cast<int>(std::round(hi[v])); b++) {
+                face.block[u] = a;
+                face.block[v] = b;
+                faces->push_back(face);
+            }
+        }
+    }
+    return true;
+}
+
+struct GoldenFixture {
+    std::string name;
+    Chunk *chunk;
+};
+
+// Generates the golden zones as BlockTypeWorker does, rivers included
+std::vector<GoldenFixture> makeFixtures(World *world) {
+    std::vector<GoldenFixture> fixtures;
+    for (const glm::ivec2 &zone : goldenZones) {
+        world->createTerrainZone(zone.x, zone.y);
+        River river(world, zone.x, zone.y);
+        if (river.random() < 0.15) {
+            river.draw();
+        }
+        for (int x = 0; x < 64; x += 16) {
+            for (int z = 0; z < 64; z += 16) {
+                int cx = zone.x + x, cz = zone.y + z;
+                fixtures.push_back({"chunk(" + std::to_string(cx) + "," + std::to_string(cz) + ")",
+                                    world->getChunkAt(cx, cz).get()});
+            }
+        }
+    }
+    return fixtures;
+}
+
+std::string formatSignature(const MeshSignature &s) {
+    char hash[17];
+    std::snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(s.hash));
+    std::ostringstream out;
+    out << hash << " " << s.faces;
+    for (const auto &tile : s.area) {
+        out << " " << tile.first << "=" << tile.second;
+    }
+    return out.str();
+}
+
+bool parseSignature(std::istringstream &fields, MeshSignature *s) {
+    std::string hash, tile;
+    if (!(fields >> hash >> s->faces)) {
+        return false;
+    }
+    s->hash = std::strtoull(hash.c_str(), nullptr, 16);
+    while (fields >> tile) {
+        size_t eq = tile.find('=');
+        if (eq == std::string::npos) {
+            return false;
+        }
+        s->area[tile.substr(0, eq)] = std::atoll(tile.c_str() + eq + 1);
+    }
+    return true;
+}
+
+bool readGoldens(const std::string &path, std::map<std::string, MeshSignature> *goldens) {
+    std::ifstream in(path);
+    std::string line;
+    if (!in || !std::getline(in, line) || line != MESHGOLDENSHEADER) {
+        return false;
+    }
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string name;
+        MeshSignature s;
+        if (!(fields >> name)) {
+            continue;
+        }
+        if (!parseSignature(fields, &s)) {
+            return false;
+        }
+        (*goldens)[name] = s;
+    }
+    return true;
+}
+
+// Prints how the faces per tile differ between two signatures
+void printAreaChange(const MeshSignature &golden, const MeshSignature &got) {
+    std::map<std::string, std::pair<int64_t, int64_t>> tiles;
+    for (const auto &t : golden.area) {
+        tiles[t.first].first = t.second;
+    }
+    for (const auto &t : got.area) {
+        tiles[t.first].second = t.second;
+    }
+    bool sameArea = true;
+    for (const auto &t : tiles) {
+        if (t.second.first != t.second.second) {
+            std::cout << "      tile " << t.first << ": " << t.second.first << " -> " << t.second.second
+                      << " faces" << std::endl;
+            sameArea = false;
+        }
+    }
+    if (sameArea) {
+        std::cout << "      same faces per tile, but not in the same places" << std::endl;
+    }
+}
+
+}
+
+bool meshSignature(const ChunkVBOData &data, MeshSignature *out, std::string *error) {
+    std::vector<MeshFace> faces;
+    if (!addFaces(data.vertex_data, data.idx_data, false, &faces, error)
+            || !addFaces(data.trans_vertex_data, data.trans_idx_data, true, &faces, error)) {
+        return false;
+    }
+    std::sort(faces.begin(), faces.end(), faceLess);
+
+    *out = MeshSignature();
+    out->hash = 14695981039346656037ull;
+    out->faces = static_cast<int64_t>(faces.size());
+    for (const MeshFace &f : faces) {
+        hashInt(&out->hash, f.block.x);
+        hashInt(&out->hash, f.block.y);
+        hashInt(&out->hash, f.block.z);
+        hashInt(&out->hash, f.direction);
+        hashInt(&out->hash, f.tile.x);
+        hashInt(&out->hash, f.tile.y);
+        hashInt(&out->hash, f.translucent);
+        out->area[tileKey(f)]++;
+    }
+    return true;
+}
+
+const std::vector<Mesher> &meshers() {
+    static const std::vector<Mesher> all {
+        {"createVBOdata", [](Chunk *c) {
+            c->createVBOdata();
+            return c->takeVBOdata();
+        }}
+    };
+    return all;
+}
+
+int checkMeshGoldens(const std::string &path, bool update, MicroBench &bench) {
+    World world;
+    std::vector<GoldenFixture> fixtures = makeFixtures(&world);
+    const std::vector<Mesher> &all = meshers();
+
+    std::map<std::string, MeshSignature> goldens;
+    if (update) {
+        std::ofstream out(path, std::ios::trunc);
+        if (!out) {
+            return -1;
+        }
+        out << MESHGOLDENSHEADER << "\n";
+        for (const GoldenFixture &f : fixtures) {
+            MeshSignature s;
+            std::string error;
+            if (!meshSignature(all.front().mesh(f.chunk), &s, &error)) {
+                std::cout << all.front().name << " on " << f.name << ": " << error << std::endl;
+                return -1;
+            }
+            out << f.name << " " << formatSignature(s) << "\n";
+        }
+        if (!out) {
+            return -1;
+        }
+        std::cout << "Wrote " << fixtures.size() << " goldens to " << path << std::endl;
+    }
+    if (!readGoldens(path, &goldens)) {
+        return -1;
+    }
+
+    int mismatches = 0;
+    for (const Mesher &m : all) {
+        int failed = 0;
+        for (const GoldenFixture &f : fixtures) {
+            auto golden = goldens.find(f.name);
+            MeshSignature s;
+            std::string error;
+            if (!meshSignature(m.mesh(f.chunk), &s, &error)) {
+                std::cout << "  " << m.name << " on " << f.name << ": " << error << std::endl;
+                failed++;
+            } else if (golden == goldens.end()) {
+                std::cout << "  " << m.name << " on " << f.name << ": no golden" << std::endl;
+                failed++;
+            } else if (s.hash != golden->second.hash) {
+                std::cout << "  " << m.name << " on " << f.name << ": " << golden->second.faces << " -> "
+                          << s.faces << " faces" << std::endl;
+                printAreaChange(golden->second, s);
+                failed++;
+            }
+        }
+        std::cout << m.name << ": " << fixtures.size() - failed << "/" << fixtures.size()
+                  << " chunks match" << std::endl;
+        mismatches += failed;
+    }
+
+    // Every Mesher is timed over all the fixtures, so that each result
+    // is comparable with the reference's
+    std::cout << std::endl;
+    for (const Mesher &m : all) {
+        bench.run("mesher/" + m.name, static_cast<int64_t>(fixtures.size()) * 16 * 256 * 16, [&]() {
+            for (const GoldenFixture &f : fixtures) {
+                ChunkVBOData data = m.mesh(f.chunk);
+            }
+        });
+    }
+    const BenchResult *reference = nullptr;
+    for (const BenchResult &r : bench.results()) {
+        if (r.name.compare(0, 7, "mesher/") != 0) {
+            continue;
+        }
+        if (!reference) {
+            reference = &r;
+            continue;
+        }
+        char line[256];
+        std::snprintf(line, sizeof(line), "  %-28s %+7.1f%% throughput against %s", r.name.c_str(),
+                      (r.itemsPerSec / reference->itemsPerSec - 1.0) * 100.0, reference->name.c_str());
+        std::cout << line << std::endl;
+    }
+    return mismatches;
+}
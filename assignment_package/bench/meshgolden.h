@@ -0,0 +1,53 @@
+#pragma once
+#include "microbench.h"
+#include "scene/chunk.h"
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+// One block face of a mesh, however the mesher happened to emit it
+struct MeshFace {
+    // Block the face belongs to, in world coordinates
+    glm::ivec3 block;
+    Direction direction;
+    // Atlas cell of the face's texture, in units of BLK_UV
+    glm::ivec2 tile;
+    bool translucent;
+};
+
+// What a mesh looks like, whatever order its quads come in and however
+// many faces each quad covers: every quad is cut into unit MeshFaces,
+// which are sorted and hashed
+struct MeshSignature {
+    uint64_t hash;
+    int64_t faces;
+    // Unit faces per atlas cell, keyed "u,v" with a trailing 't' for
+    // translucent faces
+    std::map<std::string, int64_t> area;
+
+    MeshSignature() : hash(0), faces(0), area() {}
+};
+
+// Reads the mesh as quads, each made of two consecutive triangles.
+// Returns false with the reason in error if it holds anything else
+// than axis-aligned quads covering whole block faces.
+bool meshSignature(const ChunkVBOData &data, MeshSignature *out, std::string *error);
+
+// A way to mesh a Chunk. The first of meshers() is the reference the
+// goldens are taken from; an optimized mesher is added after it and
+// must produce the same signatures.
+struct Mesher {
+    std::string name;
+    std::function<ChunkVBOData(Chunk*)> mesh;
+};
+
+const std::vector<Mesher> &meshers();
+
+// Meshes the golden fixtures with every Mesher, compares their
+// signatures with the goldens kept at path and times each Mesher
+// against the reference. If update is set the reference's signatures
+// are written to path first. Returns the number of mismatches, or -1
+// if path could not be read or written.
+int checkMeshGoldens(const std::string &path, bool update, MicroBench &bench);
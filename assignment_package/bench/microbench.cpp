@@ -0,0 +1,163 @@
+#include "microbench.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <new>
+#include <sstream>
+
+static std::atomic<uint64_t> allocations(0);
+
+void *operator new(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+uint64_t allocationCount() {
+    return allocations.load(std::memory_order_relaxed);
+}
+
+static int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+MicroBench::MicroBench(const std::string &filter)
+    : m_filter(filter), m_results()
+{}
+
+void MicroBench::run(const std::string &name, int64_t itemsPerOp, const std::function<void()> &op,
+                     const std::function<void()> &setup) {
+    if (name.find(m_filter) == std::string::npos) {
+        return;
+    }
+    // Runs n calls and returns the nanoseconds spent in op alone,
+    // adding the allocations op made to *allocs
+    auto timeCalls = [&](int64_t n, uint64_t *allocs) {
+        int64_t ns = 0;
+        if (!setup) {
+            uint64_t before = allocationCount();
+            int64_t start = nowNs();
+            for (int64_t i = 0; i < n; i++) {
+                op();
+            }
+            ns = nowNs() - start;
+            *allocs += allocationCount() - before;
+            return ns;
+        }
+        for (int64_t i = 0; i < n; i++) {
+            setup();
+            uint64_t before = allocationCount();
+            int64_t start = nowNs();
+            op();
+            ns += nowNs() - start;
+            *allocs += allocationCount() - before;
+        }
+        return ns;
+    };
+
+    // The first call warms caches and picks the calls per sample
+    uint64_t allocs = 0;
+    int64_t first = std::max<int64_t>(1, timeCalls(1, &allocs));
+    int64_t calls = std::max<int64_t>(1, BENCHMINSAMPLEMS * 1000000LL / first);
+
+    allocs = 0;
+    std::vector<double> samples;
+    for (int s = 0; s < BENCHSAMPLES; s++) {
+        samples.push_back(static_cast<double>(timeCalls(calls, &allocs)) / calls);
+    }
+    std::sort(samples.begin(), samples.end());
+
+    BenchResult r;
+    r.name = name;
+    r.nsPerOp = samples[samples.size() / 2];
+    r.itemsPerSec = r.nsPerOp > 0 ? itemsPerOp * 1e9 / r.nsPerOp : 0;
+    r.allocsPerOp = static_cast<double>(allocs) / (calls * BENCHSAMPLES);
+    m_results.push_back(r);
+
+    char line[256];
+    std::snprintf(line, sizeof(line), "%-28s %14.1f ns/op %14.0f items/s %10.1f allocs/op",
+                  r.name.c_str(), r.nsPerOp, r.itemsPerSec, r.allocsPerOp);
+    std::cout << line << std::endl;
+}
+
+const std::vector<BenchResult> &MicroBench::results() const {
+    return m_results;
+}
+
+bool MicroBench::saveBaseline(const std::string &path) const {
+    std::ofstream out(path);
+    if (!out) {
+        return false;
+    }
+    out << "# name ns/op items/s allocs/op\n";
+    for (const BenchResult &r : m_results) {
+        out << r.name << " " << r.nsPerOp << " " << r.itemsPerSec << " " << r.allocsPerOp << "\n";
+    }
+    return bool(out);
+}
+
+int MicroBench::compare(const std::string &path) const {
+    std::ifstream in(path);
+    if (!in) {
+        return -1;
+    }
+    std::map<std::string, BenchResult> baseline;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::istringstream fields(line);
+        BenchResult r;
+        if (fields >> r.name >> r.nsPerOp >> r.itemsPerSec >> r.allocsPerOp) {
+            baseline[r.name] = r;
+        }
+    }
+
+    int regressions = 0;
+    std::cout << "\nAgainst " << path << ":" << std::endl;
+    for (const BenchResult &r : m_results) {
+        auto it = baseline.find(r.name);
+        if (it == baseline.end()) {
+            std::cout << "  " << r.name << ": not in baseline" << std::endl;
+            continue;
+        }
+        double change = r.nsPerOp / it->second.nsPerOp - 1.0;
+        bool regressed = change > BENCHREGRESSION;
+        regressions += regressed;
+        char out[256];
+        std::snprintf(out, sizeof(out), "  %-28s %+7.1f%% time, allocs/op %.1f -> %.1f%s",
+                      r.name.c_str(), change * 100.0, it->second.allocsPerOp, r.allocsPerOp,
+                      regressed ? "  REGRESSION" : "");
+        std::cout << out << std::endl;
+    }
+    return regressions;
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Each sample runs a benchmark for at least this long, and the median
+// of BENCHSAMPLES samples is reported
+#define BENCHMINSAMPLEMS 100
+#define BENCHSAMPLES 5
+// Slowdown against the baseline that counts as a regression
+#define BENCHREGRESSION 0.1
+
+struct BenchResult {
+    std::string name;
+    double nsPerOp;
+    double itemsPerSec;
+    double allocsPerOp;
+};
+
+// Heap allocations made so far, counted by the replacement global
+// operator new in microbench.cpp
+uint64_t allocationCount();
+
+// Runs benchmarks, collects their results and compares them with a
+// baseline saved by an earlier run
+class MicroBench {
+private:
+    std::string m_filter;
+    std::vector<BenchResult> m_results;
+
+public:
+    // Only benchmarks whose name contains filter are run
+    MicroBench(const std::string &filter);
+
+    // Times op, which handles itemsPerOp items (blocks, columns, rays...)
+    // each call. setup, if given, runs untimed before every call, for
+    // ops that use up their input.
+    void run(const std::string &name, int64_t itemsPerOp, const std::function<void()> &op,
+             const std::function<void()> &setup = nullptr);
+
+    const std::vector<BenchResult> &results() const;
+    bool saveBaseline(const std::string &path) const;
+    // Prints every result next to the baseline's. Returns the number of
+    // benchmarks more than BENCHREGRESSION slower, or -1 if the
+    // baseline could not be read.
+    int compare(const std::string &path) const;
+};
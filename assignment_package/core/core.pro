@@ -0,0 +1,16 @@
+# The engine core (see ../src/core.pri) as a static library that needs
+# nothing but QtCore. Build it together with the tools that link it:
+#   qmake headless.pro && make
+QT = core
+
+TARGET = minecraftcore
+TEMPLATE = lib
+CONFIG += staticlib
+CONFIG += c++1z
+# The tools built on it measure performance
+CONFIG -= debug
+CONFIG += release
+
+INCLUDEPATH += ../include
+
+include(../src/core.pri)
@@ -3,8 +3,28 @@
 
 // Refer to the lambert shader files for useful comments
 
-uniform mat4 u_Model;
-uniform mat4 u_ViewProj;
+// Shared by every program and uploaded once per frame; see UniformBlocks
+layout(std140) uniform FrameUniforms {
+    mat4 u_ViewProj;           // The matrix that defines the camera's transformation
+    mat4 u_InvViewProj;        // Its inverse, for casting rays through the screen
+    mat4 u_CascadeViewProj[4]; // Light view-projection of each shadow cascade
+    vec3 u_CameraPos;
+    float u_TimeElapsed;
+    vec4 u_CascadeSplits;      // Distance from the camera at which each cascade ends
+    vec2 u_FogRange;           // Distances at which fog starts and becomes opaque
+    ivec2 u_Dimensions;        // Screen dimensions
+    int u_Time;
+};
+
+// Per-draw state, shared by every program; see UniformBlocks
+layout(std140) uniform DrawUniforms {
+    mat4 u_Model;       // The matrix that defines the transformation of the object we're rendering
+    mat4 u_ModelInvTr;  // The inverse transpose of the model matrix, for transforming normals
+    vec4 u_Color;
+    int u_Cascade;      // Shadow cascade being rendered by the shadow program
+    int u_Animation;
+    int u_CurrFrame;
+};
 
 in vec4 vs_Pos;
 in vec4 vs_Col;
@@ -7,9 +7,18 @@
 //This simultaneous transformation allows your program to run much faster, especially when rendering
 //geometry with millions of vertices.
 
-uniform mat4 u_ViewProj;    // The matrix that defines the camera's transformation.
-                            // We've written a static matrix for you to use for HW2,
-                            // but in HW3 you'll have to generate one yourself
+// Shared by every program and uploaded once per frame; see UniformBlocks
+layout(std140) uniform FrameUniforms {
+    mat4 u_ViewProj;           // The matrix that defines the camera's transformation
+    mat4 u_InvViewProj;        // Its inverse, for casting rays through the screen
+    mat4 u_CascadeViewProj[4]; // Light view-projection of each shadow cascade
+    vec3 u_CameraPos;
+    float u_TimeElapsed;
+    vec4 u_CascadeSplits;      // Distance from the camera at which each cascade ends
+    vec2 u_FogRange;           // Distances at which fog starts and becomes opaque
+    ivec2 u_Dimensions;        // Screen dimensions
+    int u_Time;
+};
 
 in vec4 vs_Pos;             // The array of vertex positions passed to the shader
 in vec4 vs_Nor;             // The array of vertex normals passed to the shader
@@ -11,11 +11,20 @@
 // can compute what color to apply to its pixel based on things like vertex
 // position, light position, and vertex color.
 uniform sampler2D u_Texture;
-uniform sampler2D u_Depth;
-uniform vec4 u_Color; // The color with which to render this instance of geometry.
-uniform int u_Time;
-uniform float u_TimeElapsed;
-uniform vec3 u_CameraPos;
+uniform sampler2D u_Depth; // 2 x 2 atlas of the shadow cascades' depth maps
+
+// Shared by every program and uploaded once per frame; see UniformBlocks
+layout(std140) uniform FrameUniforms {
+    mat4 u_ViewProj;           // The matrix that defines the camera's transformation
+    mat4 u_InvViewProj;        // Its inverse, for casting rays through the screen
+    mat4 u_CascadeViewProj[4]; // Light view-projection of each shadow cascade
+    vec3 u_CameraPos;
+    float u_TimeElapsed;
+    vec4 u_CascadeSplits;      // Distance from the camera at which each cascade ends
+    vec2 u_FogRange;           // Distances at which fog starts and becomes opaque
+    ivec2 u_Dimensions;        // Screen dimensions
+    int u_Time;
+};
 // These are the interpolated values out of the rasterizer, so you can't know
 // their specific values without knowing the vertices that contributed to them
 in vec4 fs_Pos;
@@ -24,7 +33,7 @@ in float fs_isAnimatable;
 in vec4 fs_Nor;
 in vec4 fs_LightVec;
 in vec4 fs_Col;
-in vec4 fs_ShadowCoord;
+in vec4 fs_ShadowCoord[4];
 
 out vec4 out_Col; // This is the final output color that you will see on your
                   // screen for the pixel that is currently being processed.
@@ -74,9 +83,9 @@ float fbm(vec3 p) {
     return sum;
 }
 
-const float maxDist = 200.f;
-const float minDist = 150.f;
 float fogIntensity(float distance){
+    float minDist = u_FogRange.x;
+    float maxDist = u_FogRange.y;
     if (distance > maxDist) return 1.f;
     if (distance < minDist) return 0.f;
     return 1 - (maxDist - distance)/(maxDist - minDist);
@@ -84,6 +93,25 @@ float fogIntensity(float distance){
 
 const vec3 fogColor = vec3(0.84f, 0.81f, 1.0f);
 
+// 0.5 where the nearest cascade covering a point at distance d from the
+// camera puts it in shadow, 1.0 otherwise
+float cascadeShadow(float d, float bias) {
+    int c = 0;
+    while (c < 4 && d > u_CascadeSplits[c]) {
+        c++;
+    }
+    if (c == 4) {
+        return 1.0;
+    }
+    vec4 coord = fs_ShadowCoord[c];
+    if (any(lessThan(coord.xy, vec2(0.f))) || any(greaterThan(coord.xy, vec2(1.f)))) {
+        return 1.0;
+    }
+    // Cascade c's tile starts at (c % 2, c / 2) halves of the atlas
+    vec2 uv = (coord.xy + vec2(c & 1, c >> 1)) * 0.5;
+    return texture(u_Depth, uv).r < (coord.z - bias) ? 0.5 : 1.0;
+}
+
 void main()
 {
     // Material base color (before shading)
@@ -126,12 +154,14 @@ void main()
 
         // apply shadow
         float time = mod(u_TimeElapsed, 216000.0) / 216000;
-        float bias = max(0.005 * (1.0 - dot(fs_Nor.xyz, fs_LightVec.xyz)), 0.0005);
+        // Cascades are far tighter than the old single map, so less bias is needed
+        float bias = max(0.002 * (1.0 - dot(fs_Nor.xyz, fs_LightVec.xyz)), 0.0003);
         float shadow;
         if (time >= 0.25 && time <= 0.75) {
             shadow = 0.3;
         } else {
-            shadow = texture(u_Depth, fs_ShadowCoord.xy).r < (fs_ShadowCoord.z - bias) ? 0.5 : 1.0;
+            // Distant terrain lies beyond the last cascade
+            shadow = cascadeShadow(d, bias);
         }
 
         // Compute final shaded color (with distance fog)
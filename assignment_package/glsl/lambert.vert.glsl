@@ -9,24 +9,28 @@
 //geometry with millions of vertices.
 
 
-uniform mat4 u_Model;       // The matrix that defines the transformation of the
-                            // object we're rendering. In this assignment,
-                            // this will be the result of traversing your scene graph.
-
-uniform mat4 u_ModelInvTr;  // The inverse transpose of the model matrix.
-                            // This allows us to transform the object's normals properly
-                            // if the object has been non-uniformly scaled.
-
-uniform mat4 u_ViewProj;    // The matrix that defines the camera's transformation.
-                            // We've written a static matrix for you to use for HW2,
-                            // but in HW3 you'll have to generate one yourself
-
-uniform mat4 u_ShadowViewProj;
-
-uniform vec4 u_Color;       // When drawing the cube instance, we'll set our uniform color to represent different block types.
-uniform int u_Time;
-
-uniform float u_TimeElapsed;
+// Shared by every program and uploaded once per frame; see UniformBlocks
+layout(std140) uniform FrameUniforms {
+    mat4 u_ViewProj;           // The matrix that defines the camera's transformation
+    mat4 u_InvViewProj;        // Its inverse, for casting rays through the screen
+    mat4 u_CascadeViewProj[4]; // Light view-projection of each shadow cascade
+    vec3 u_CameraPos;
+    float u_TimeElapsed;
+    vec4 u_CascadeSplits;      // Distance from the camera at which each cascade ends
+    vec2 u_FogRange;           // Distances at which fog starts and becomes opaque
+    ivec2 u_Dimensions;        // Screen dimensions
+    int u_Time;
+};
+
+// Per-draw state, shared by every program; see UniformBlocks
+layout(std140) uniform DrawUniforms {
+    mat4 u_Model;       // The matrix that defines the transformation of the object we're rendering
+    mat4 u_ModelInvTr;  // The inverse transpose of the model matrix, for transforming normals
+    vec4 u_Color;
+    int u_Cascade;      // Shadow cascade being rendered by the shadow program
+    int u_Animation;
+    int u_CurrFrame;
+};
 
 in vec4 vs_Pos;             // The array of vertex positions passed to the shader
 
@@ -36,7 +40,7 @@ in vec2 vs_UV;
 in float vs_isAnimatable;
 
 out vec4 fs_Pos;
-out vec4 fs_ShadowCoord;
+out vec4 fs_ShadowCoord[4]; // Position in each cascade's shadow map, in [0, 1]
 out vec4 fs_Nor;            // The array of normals that has been transformed by u_ModelInvTr. This is implicitly passed to the fragment shader.
 out vec4 fs_LightVec;       // The direction in which our virtual light lies, relative to each vertex. This is implicitly passed to the fragment shader.
 out vec2 fs_UV;
@@ -95,14 +99,15 @@ void main()
     vec4 modelposition = u_Model * fs_Pos;   // Temporarily store the transformed vertex positions for use below
 
     fs_LightVec = getLightDir();  // Compute the direction in which the light source lies
-    fs_ShadowCoord = u_ShadowViewProj * modelposition;
     mat4 biasMatrix = mat4(
         0.5, 0.0, 0.0, 0.0,
         0.0, 0.5, 0.0, 0.0,
         0.0, 0.0, 0.5, 0.0,
         0.5, 0.5, 0.5, 1.0
         );
-    fs_ShadowCoord = biasMatrix * fs_ShadowCoord;
+    for (int i = 0; i < 4; i++) {
+        fs_ShadowCoord[i] = biasMatrix * u_CascadeViewProj[i] * modelposition;
+    }
     gl_Position = u_ViewProj * modelposition;// gl_Position is a built-in variable of OpenGL which is
                                              // used to render the final positions of the geometry's vertices
 }
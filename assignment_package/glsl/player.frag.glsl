@@ -4,9 +4,16 @@
 // Refer to the lambert shader files for useful comments
 
 uniform sampler2D u_Texture;
-uniform int u_Animation;
-uniform int u_CurrFrame;
-uniform vec3 u_CameraPos;
+
+// Per-draw state, shared by every program; see UniformBlocks
+layout(std140) uniform DrawUniforms {
+    mat4 u_Model;       // The matrix that defines the transformation of the object we're rendering
+    mat4 u_ModelInvTr;  // The inverse transpose of the model matrix, for transforming normals
+    vec4 u_Color;
+    int u_Cascade;      // Shadow cascade being rendered by the shadow program
+    int u_Animation;
+    int u_CurrFrame;
+};
 
 in vec4 fs_Col;
 in vec4 fs_Pos;
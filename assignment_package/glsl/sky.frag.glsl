@@ -1,15 +1,17 @@
 #version 150
 
-uniform mat4 u_ViewProj;    // We're actually passing the inverse of the viewproj
-                            // from our CPU, but it's named u_ViewProj so we don't
-                            // have to bother rewriting our ShaderProgram class
-
-uniform ivec2 u_Dimensions; // Screen dimensions
-
-uniform vec3 u_Eye; // Camera pos
-
-uniform int u_Time;
-uniform float u_TimeElapsed;
+// Shared by every program and uploaded once per frame; see UniformBlocks
+layout(std140) uniform FrameUniforms {
+    mat4 u_ViewProj;           // The matrix that defines the camera's transformation
+    mat4 u_InvViewProj;        // Its inverse, for casting rays through the screen
+    mat4 u_CascadeViewProj[4]; // Light view-projection of each shadow cascade
+    vec3 u_CameraPos;
+    float u_TimeElapsed;
+    vec4 u_CascadeSplits;      // Distance from the camera at which each cascade ends
+    vec2 u_FogRange;           // Distances at which fog starts and becomes opaque
+    ivec2 u_Dimensions;        // Screen dimensions
+    int u_Time;
+};
 
 out vec4 outColor;
 
@@ -441,17 +443,17 @@ void main() {
     vec2 ndc = (gl_FragCoord.xy / vec2(u_Dimensions)) * 2.0 - 1.0; // -1 to 1 NDC
     vec4 p = vec4(ndc.xy, 1, 1); // Pixel at the far clip plane
     p *= 10000.0; // Times far clip plane value
-    p = u_ViewProj * p; // Convert from unhomogenized screen to world
-    vec3 rayDir = normalize(p.xyz - u_Eye); // Eye ray direction to pixel
+    p = u_InvViewProj * p; // Convert from unhomogenized screen to world
+    vec3 rayDir = normalize(p.xyz - u_CameraPos); // Eye ray direction to pixel
 
     // Simulate a moving sun with changing color
-    vec3 sunDir = normalize(sunLocation(time) - u_Eye); // Eye ray direction to sun
+    vec3 sunDir = normalize(sunLocation(time) - u_CameraPos); // Eye ray direction to sun
     float sunCoreSize = 1.5;
     float sunSize = 2;
     float coronaSize = getCoronaSize(time);
 
     //Simulate a moving moon
-    vec3 moonDir = normalize(moonLocation(time) - u_Eye);  // Eye ray direction to moon
+    vec3 moonDir = normalize(moonLocation(time) - u_CameraPos);  // Eye ray direction to moon
     float moonSize = 2.5;
     float moonEdge = 5;
 
@@ -0,0 +1,7 @@
+# The engine core library and the tools that run it without a window
+# or a GPU, for profiling on build machines:
+#   qmake headless.pro && make
+TEMPLATE = subdirs
+
+SUBDIRS = core worldgen
+worldgen.depends = core
@@ -0,0 +1,48 @@
+# The engine core: world data, terrain generation and meshing, and
+# voxelizing OBJ meshes. It only needs QtCore (threads and files),
+# never widgets or OpenGL, so that it can also be built as a static
+# library for the headless tools; see ../core/core.pro.
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD
+
+SOURCES += \
+    $$PWD/scene/blockcodec.cpp \
+    $$PWD/scene/blocktypeworker.cpp \
+    $$PWD/scene/chunk.cpp \
+    $$PWD/scene/frustum.cpp \
+    $$PWD/scene/pipelinelatency.cpp \
+    $$PWD/scene/progen.cpp \
+    $$PWD/scene/regionfile.cpp \
+    $$PWD/scene/river.cpp \
+    $$PWD/scene/turtle.cpp \
+    $$PWD/scene/vboworker.cpp \
+    $$PWD/scene/visibilitygraph.cpp \
+    $$PWD/scene/world.cpp \
+    $$PWD/scene/worldstore.cpp \
+    $$PWD/meshVoxelizer.cpp \
+    $$PWD/memorystats.cpp \
+    $$PWD/trace.cpp \
+    $$PWD/tinyobj/tiny_obj_loader.cc
+
+HEADERS += \
+    $$PWD/scene/blockcodec.h \
+    $$PWD/scene/blocktypeworker.h \
+    $$PWD/scene/chunk.h \
+    $$PWD/scene/frustum.h \
+    $$PWD/scene/noisehelper.h \
+    $$PWD/scene/pipelinelatency.h \
+    $$PWD/scene/progen.h \
+    $$PWD/scene/regionfile.h \
+    $$PWD/scene/river.h \
+    $$PWD/scene/texturehelp.h \
+    $$PWD/scene/turtle.h \
+    $$PWD/scene/vboworker.h \
+    $$PWD/scene/visibilitygraph.h \
+    $$PWD/scene/world.h \
+    $$PWD/scene/worldstore.h \
+    $$PWD/meshVoxelizer.h \
+    $$PWD/memorystats.h \
+    $$PWD/trace.h \
+    $$PWD/tinyobj/tiny_obj_loader.h \
+    $$PWD/smartpointerhelp.h \
+    $$PWD/glm_includes.h
@@ -1,11 +1,28 @@
 #include "drawable.h"
 #include <glm_includes.h>
 
+const std::vector<VertexAttribFormat> INTERLEAVED_VERTEX_FORMAT {
+    {ATTR_LOC_POS, 4, 0},
+    {ATTR_LOC_NOR, 4, sizeof(glm::vec4)},
+    {ATTR_LOC_UV, 2, 2 * sizeof(glm::vec4)},
+    {ATTR_LOC_ANIMATABLE, 1, 2 * sizeof(glm::vec4) + 3 * sizeof(float)},
+    {ATTR_LOC_PART, 1, 2 * sizeof(glm::vec4) + 3 * sizeof(float)}
+};
+
+void specifyVertexAttribs(OpenGLContext *context, const std::vector<VertexAttribFormat> &format, GLsizei stride) {
+    for (const VertexAttribFormat &a : format) {
+        context->glEnableVertexAttribArray(a.location);
+        context->glVertexAttribPointer(a.location, a.components, GL_FLOAT, false, stride, (void*)a.offset);
+    }
+}
+
 Drawable::Drawable(OpenGLContext* context)
     : m_count(-1), m_transCount(-1), m_bufIdx(-1),  m_bufTransIdx(-1), m_bufPos(-1), m_bufNor(-1), m_bufCol(-1), m_bufUV(-1), m_bufAll(-1), m_bufTransAll(-1),
       m_idxGenerated(false), m_transIdxGenerated(false),
       m_posGenerated(false), m_norGenerated(false), m_colGenerated(false), m_uvGenerated (false),
       m_allGenerated(false), m_transAllGenerated(false),
+      m_vao(0), m_transVao(0), m_vaoGenerated(false), m_transVaoGenerated(false),
+      m_vaoLayout(LAYOUT_NONE), m_transVaoReady(false),
       mp_context(context)
 {}
 
@@ -15,12 +32,22 @@ Drawable::~Drawable()
 
 void Drawable::destroyVBOdata()
 {
-    mp_context->glDeleteBuffers(1, &m_bufIdx);
-    mp_context->glDeleteBuffers(1, &m_bufPos);
-    mp_context->glDeleteBuffers(1, &m_bufNor);
-    mp_context->glDeleteBuffers(1, &m_bufCol);
-    m_idxGenerated = m_posGenerated = m_norGenerated = m_colGenerated = false;
+    if (m_idxGenerated) mp_context->glState().deleteBuffer(m_bufIdx);
+    if (m_transIdxGenerated) mp_context->glState().deleteBuffer(m_bufTransIdx);
+    if (m_posGenerated) mp_context->glState().deleteBuffer(m_bufPos);
+    if (m_norGenerated) mp_context->glState().deleteBuffer(m_bufNor);
+    if (m_colGenerated) mp_context->glState().deleteBuffer(m_bufCol);
+    if (m_uvGenerated) mp_context->glState().deleteBuffer(m_bufUV);
+    if (m_allGenerated) mp_context->glState().deleteBuffer(m_bufAll);
+    if (m_transAllGenerated) mp_context->glState().deleteBuffer(m_bufTransAll);
+    if (m_vaoGenerated) mp_context->glState().deleteVertexArray(m_vao);
+    if (m_transVaoGenerated) mp_context->glState().deleteVertexArray(m_transVao);
+    m_vaoGenerated = m_transVaoGenerated = false;
+    invalidateVAOs();
+    m_idxGenerated = m_transIdxGenerated = m_posGenerated = m_norGenerated = m_colGenerated = false;
+    m_uvGenerated = m_allGenerated = m_transAllGenerated = false;
     m_count = -1;
+    m_transCount = -1;
 }
 
 GLenum Drawable::drawMode()
@@ -46,6 +73,9 @@ int Drawable::transCount()
 
 void Drawable::generateIdx()
 {
+    invalidateVAOs();
+    // Uploads must not change the element buffer of a Drawable's VAO
+    mp_context->glState().bindDefaultVertexArray();
     m_idxGenerated = true;
     // Create a VBO on our GPU and store its handle in bufIdx
     mp_context->glGenBuffers(1, &m_bufIdx);
@@ -53,12 +83,16 @@ void Drawable::generateIdx()
 
 void Drawable::generateTransIdx()
 {
+    invalidateVAOs();
+    // Uploads must not change the element buffer of a Drawable's VAO
+    mp_context->glState().bindDefaultVertexArray();
     m_transIdxGenerated  = true;
     mp_context->glGenBuffers(1, &m_bufTransIdx);
 }
 
 void Drawable::generatePos()
 {
+    invalidateVAOs();
     m_posGenerated = true;
     // Create a VBO on our GPU and store its handle in bufPos
     mp_context->glGenBuffers(1, &m_bufPos);
@@ -66,6 +100,7 @@ void Drawable::generatePos()
 
 void Drawable::generateNor()
 {
+    invalidateVAOs();
     m_norGenerated = true;
     // Create a VBO on our GPU and store its handle in bufNor
     mp_context->glGenBuffers(1, &m_bufNor);
@@ -73,6 +108,7 @@ void Drawable::generateNor()
 
 void Drawable::generateCol()
 {
+    invalidateVAOs();
     m_colGenerated = true;
     // Create a VBO on our GPU and store its handle in bufCol
     mp_context->glGenBuffers(1, &m_bufCol);
@@ -80,6 +116,7 @@ void Drawable::generateCol()
 
 void Drawable::generateUV()
 {
+    invalidateVAOs();
     m_uvGenerated = true;
     // Create a VBO on our GPU and store its handle in bufCol
     mp_context->glGenBuffers(1, &m_bufUV);
@@ -87,12 +124,14 @@ void Drawable::generateUV()
 
 void Drawable::generateAll()
 {
+    invalidateVAOs();
     m_allGenerated = true;
     mp_context->glGenBuffers(1, &m_bufAll);
 }
 
 void Drawable::generateTransAll()
 {
+    invalidateVAOs();
     m_transAllGenerated = true;
     mp_context->glGenBuffers(1, &m_bufTransAll);
 }
@@ -100,6 +139,7 @@ void Drawable::generateTransAll()
 bool Drawable::bindIdx()
 {
     if(m_idxGenerated) {
+        mp_context->glState().bindDefaultVertexArray();
         mp_context->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_bufIdx);
     }
     return m_idxGenerated;
@@ -108,6 +148,7 @@ bool Drawable::bindIdx()
 bool Drawable::bindTransIdx()
 {
     if(m_transIdxGenerated) {
+        mp_context->glState().bindDefaultVertexArray();
         mp_context->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_bufTransIdx);
     }
     return m_transIdxGenerated;
@@ -116,7 +157,7 @@ bool Drawable::bindTransIdx()
 bool Drawable::bindPos()
 {
     if(m_posGenerated){
-        mp_context->glBindBuffer(GL_ARRAY_BUFFER, m_bufPos);
+        mp_context->glState().bindArrayBuffer(m_bufPos);
     }
     return m_posGenerated;
 }
@@ -124,7 +165,7 @@ bool Drawable::bindPos()
 bool Drawable::bindNor()
 {
     if(m_norGenerated){
-        mp_context->glBindBuffer(GL_ARRAY_BUFFER, m_bufNor);
+        mp_context->glState().bindArrayBuffer(m_bufNor);
     }
     return m_norGenerated;
 }
@@ -132,7 +173,7 @@ bool Drawable::bindNor()
 bool Drawable::bindCol()
 {
     if(m_colGenerated){
-        mp_context->glBindBuffer(GL_ARRAY_BUFFER, m_bufCol);
+        mp_context->glState().bindArrayBuffer(m_bufCol);
     }
     return m_colGenerated;
 }
@@ -140,7 +181,7 @@ bool Drawable::bindCol()
 bool Drawable::bindUV()
 {
     if(m_uvGenerated){
-        mp_context->glBindBuffer(GL_ARRAY_BUFFER, m_bufUV);
+        mp_context->glState().bindArrayBuffer(m_bufUV);
     }
     return m_uvGenerated;
 }
@@ -148,7 +189,7 @@ bool Drawable::bindUV()
 bool Drawable::bindAll()
 {
     if(m_allGenerated){
-        mp_context->glBindBuffer(GL_ARRAY_BUFFER, m_bufAll);
+        mp_context->glState().bindArrayBuffer(m_bufAll);
     }
     return m_allGenerated;
 }
@@ -156,11 +197,74 @@ bool Drawable::bindAll()
 bool Drawable::bindTransAll()
 {
     if(m_transAllGenerated){
-        mp_context->glBindBuffer(GL_ARRAY_BUFFER, m_bufTransAll);
+        mp_context->glState().bindArrayBuffer(m_bufTransAll);
     }
     return m_transAllGenerated;
 }
 
+void Drawable::invalidateVAOs()
+{
+    m_vaoLayout = LAYOUT_NONE;
+    m_transVaoReady = false;
+}
+
+void Drawable::specifyAttributes(VertexLayout layout)
+{
+    if (layout == LAYOUT_INTERLEAVED) {
+        if (bindAll()) {
+            specifyVertexAttribs(mp_context, INTERLEAVED_VERTEX_FORMAT, INTERLEAVED_VERTEX_STRIDE);
+        }
+        if (m_idxGenerated) mp_context->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_bufIdx);
+        return;
+    }
+    if (bindPos()) {
+        mp_context->glEnableVertexAttribArray(ATTR_LOC_POS);
+        mp_context->glVertexAttribPointer(ATTR_LOC_POS, 4, GL_FLOAT, false, 0, NULL);
+    }
+    if (bindNor()) {
+        mp_context->glEnableVertexAttribArray(ATTR_LOC_NOR);
+        mp_context->glVertexAttribPointer(ATTR_LOC_NOR, 4, GL_FLOAT, false, 0, NULL);
+    }
+    if (bindCol()) {
+        mp_context->glEnableVertexAttribArray(ATTR_LOC_COL);
+        mp_context->glVertexAttribPointer(ATTR_LOC_COL, 4, GL_FLOAT, false, 0, NULL);
+    }
+    if (bindUV()) {
+        mp_context->glEnableVertexAttribArray(ATTR_LOC_UV);
+        mp_context->glVertexAttribPointer(ATTR_LOC_UV, 2, GL_FLOAT, false, 0, NULL);
+    }
+    if (m_idxGenerated) mp_context->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_bufIdx);
+}
+
+void Drawable::bindVAO(VertexLayout layout)
+{
+    if (!m_vaoGenerated) {
+        mp_context->glGenVertexArrays(1, &m_vao);
+        m_vaoGenerated = true;
+    }
+    mp_context->glState().bindVertexArray(m_vao);
+    if (m_vaoLayout != layout) {
+        specifyAttributes(layout);
+        m_vaoLayout = layout;
+    }
+}
+
+void Drawable::bindTransVAO()
+{
+    if (!m_transVaoGenerated) {
+        mp_context->glGenVertexArrays(1, &m_transVao);
+        m_transVaoGenerated = true;
+    }
+    mp_context->glState().bindVertexArray(m_transVao);
+    if (!m_transVaoReady) {
+        if (bindTransAll()) {
+            specifyVertexAttribs(mp_context, INTERLEAVED_VERTEX_FORMAT, INTERLEAVED_VERTEX_STRIDE);
+        }
+        if (m_transIdxGenerated) mp_context->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_bufTransIdx);
+        m_transVaoReady = true;
+    }
+}
+
 InstancedDrawable::InstancedDrawable(OpenGLContext *context)
     : Drawable(context), m_numInstances(0), m_bufPosOffset(-1), m_offsetGenerated(false)
 {}
@@ -171,14 +275,41 @@ int InstancedDrawable::instanceCount() const {
     return m_numInstances;
 }
 
+void InstancedDrawable::specifyAttributes(VertexLayout layout) {
+    if (layout != LAYOUT_INSTANCED) {
+        Drawable::specifyAttributes(layout);
+        return;
+    }
+    if (bindPos()) {
+        mp_context->glEnableVertexAttribArray(ATTR_LOC_POS);
+        mp_context->glVertexAttribPointer(ATTR_LOC_POS, 4, GL_FLOAT, false, 0, NULL);
+    }
+    if (bindNor()) {
+        mp_context->glEnableVertexAttribArray(ATTR_LOC_NOR);
+        mp_context->glVertexAttribPointer(ATTR_LOC_NOR, 4, GL_FLOAT, false, 0, NULL);
+    }
+    // The instanced shader reads its UVs from the color buffer
+    if (bindCol()) {
+        mp_context->glEnableVertexAttribArray(ATTR_LOC_UV);
+        mp_context->glVertexAttribPointer(ATTR_LOC_UV, 2, GL_FLOAT, false, 0, NULL);
+    }
+    if (bindOffsetBuf()) {
+        mp_context->glEnableVertexAttribArray(ATTR_LOC_OFFSET);
+        mp_context->glVertexAttribPointer(ATTR_LOC_OFFSET, 3, GL_FLOAT, false, 0, NULL);
+        mp_context->glVertexAttribDivisor(ATTR_LOC_OFFSET, 1);
+    }
+    if (m_idxGenerated) mp_context->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_bufIdx);
+}
+
 void InstancedDrawable::generateOffsetBuf() {
+    invalidateVAOs();
     m_offsetGenerated = true;
     mp_context->glGenBuffers(1, &m_bufPosOffset);
 }
 
 bool InstancedDrawable::bindOffsetBuf() {
     if(m_offsetGenerated){
-        mp_context->glBindBuffer(GL_ARRAY_BUFFER, m_bufPosOffset);
+        mp_context->glState().bindArrayBuffer(m_bufPosOffset);
     }
     return m_offsetGenerated;
 }
@@ -186,13 +317,15 @@ bool InstancedDrawable::bindOffsetBuf() {
 
 void InstancedDrawable::clearOffsetBuf() {
     if(m_offsetGenerated) {
-        mp_context->glDeleteBuffers(1, &m_bufPosOffset);
+        invalidateVAOs();
+        mp_context->glState().deleteBuffer(m_bufPosOffset);
         m_offsetGenerated = false;
     }
 }
 void InstancedDrawable::clearColorBuf() {
     if(m_colGenerated) {
-        mp_context->glDeleteBuffers(1, &m_bufCol);
+        invalidateVAOs();
+        mp_context->glState().deleteBuffer(m_bufCol);
         m_colGenerated = false;
     }
 }
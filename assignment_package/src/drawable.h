@@ -1,6 +1,46 @@
 #pragma once
 #include <openglcontext.h>
 #include <glm_includes.h>
+#include <vector>
+
+// Vertex attribute locations bound before linking every ShaderProgram,
+// so that a VAO set up once can be drawn with any of them
+enum VertexAttribLocation : GLuint {
+    ATTR_LOC_POS, ATTR_LOC_NOR, ATTR_LOC_UV, ATTR_LOC_ANIMATABLE,
+    ATTR_LOC_COL, ATTR_LOC_OFFSET, ATTR_LOC_PART
+};
+
+// Where one vertex attribute sits in an interleaved vertex
+struct VertexAttribFormat {
+    VertexAttribLocation location;
+    GLint components;
+    // In bytes from the start of the vertex
+    size_t offset;
+};
+
+// The vertex of LAYOUT_INTERLEAVED buffers and of the terrain arena:
+// position, normal and UV vec4s. The UV's last float is whether the
+// face animates in terrain meshes and which body part it belongs to in
+// player meshes, so ATTR_LOC_ANIMATABLE and ATTR_LOC_PART both read it
+// and each shader declares the one its meshes mean.
+extern const std::vector<VertexAttribFormat> INTERLEAVED_VERTEX_FORMAT;
+const GLsizei INTERLEAVED_VERTEX_STRIDE = 3 * sizeof(glm::vec4);
+
+// Enables the attributes of format in the bound VAO, reading vertices
+// stride bytes apart from the bound GL_ARRAY_BUFFER
+void specifyVertexAttribs(OpenGLContext *context, const std::vector<VertexAttribFormat> &format, GLsizei stride);
+
+// How a Drawable's buffers feed the vertex attributes
+enum VertexLayout : unsigned char {
+    // Not set up yet, or its buffers have changed since
+    LAYOUT_NONE,
+    // One buffer per attribute (pos, nor, col, uv)
+    LAYOUT_SEPARATE,
+    // pos, nor and uv in one buffer of three vec4s per vertex
+    LAYOUT_INTERLEAVED,
+    // LAYOUT_SEPARATE plus a per-instance offset
+    LAYOUT_INSTANCED
+};
 
 //This defines a class which can be rendered by our shader program.
 //Make any geometry a subclass of ShaderProgram::Drawable in order to render it with the ShaderProgram class.
@@ -28,6 +68,20 @@ protected:
     bool m_allGenerated;
     bool m_transAllGenerated;
 
+    // Vertex array objects remembering how the opaque and translucent
+    // buffers are laid out, so drawing only has to bind them
+    GLuint m_vao;
+    GLuint m_transVao;
+    bool m_vaoGenerated;
+    bool m_transVaoGenerated;
+    VertexLayout m_vaoLayout;
+    bool m_transVaoReady;
+
+    // Points the attributes of the bound VAO at this Drawable's buffers
+    virtual void specifyAttributes(VertexLayout layout);
+    // Forces the VAOs to be set up again on their next use
+    void invalidateVAOs();
+
     OpenGLContext* mp_context; // Since Qt's OpenGL support is done through classes like QOpenGLFunctions_3_2_Core,
         // we need to pass our OpenGL context to the Drawable in order to call GL functions
         // from within this class.
@@ -38,7 +92,7 @@ public:
     virtual ~Drawable();
 
     virtual void createVBOdata() = 0; // To be implemented by subclasses. Populates the VBOs of the Drawable.
-    void destroyVBOdata(); // Frees the VBOs of the Drawable.
+    virtual void destroyVBOdata(); // Frees the VBOs of the Drawable.
 
     // Getter functions for various GL data
     virtual GLenum drawMode();
@@ -66,6 +120,12 @@ public:
 
     bool bindAll();
     bool bindTransAll();
+
+    // Binds the VAO for drawing the opaque geometry with the given
+    // layout, setting it up first if needed
+    void bindVAO(VertexLayout layout);
+    // Binds the VAO for drawing the translucent geometry
+    void bindTransVAO();
 };
 
 // A subclass of Drawable that enables the base code to render duplicates of
@@ -80,6 +140,8 @@ protected:
 
     bool m_offsetGenerated;
 
+    void specifyAttributes(VertexLayout layout) override;
+
 public:
     InstancedDrawable(OpenGLContext* mp_context);
     virtual ~InstancedDrawable();
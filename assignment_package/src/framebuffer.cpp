@@ -5,7 +5,8 @@ FrameBuffer::FrameBuffer(OpenGLContext *context,
                          unsigned int width, unsigned int height, unsigned int devicePixelRatio)
     : mp_context(context), m_frameBuffer(-1),
       m_outputTexture(-1), m_depthRenderBuffer(-1),
-      m_width(width), m_height(height), m_devicePixelRatio(devicePixelRatio), m_created(false)
+      m_width(width), m_height(height), m_devicePixelRatio(devicePixelRatio), m_created(false),
+      m_textureSlot(0), m_memory(MEMORY_TEXTURES)
 {}
 
 void FrameBuffer::resize(unsigned int width, unsigned int height, unsigned int devicePixelRatio) {
@@ -22,7 +23,7 @@ void FrameBuffer::createPost() {
 
     mp_context->glBindFramebuffer(GL_FRAMEBUFFER, m_frameBuffer);
     // Bind our texture so that all functions that deal with textures will interact with this one
-    mp_context->glBindTexture(GL_TEXTURE_2D, m_outputTexture);
+    mp_context->glState().bindTexture(m_outputTexture);
     // Give an empty image to OpenGL ( the last "0" )
     mp_context->glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, m_width * m_devicePixelRatio, m_height * m_devicePixelRatio, 0, GL_RGB, GL_UNSIGNED_BYTE, (void*)0);
 
@@ -38,6 +39,8 @@ void FrameBuffer::createPost() {
     mp_context->glBindRenderbuffer(GL_RENDERBUFFER, m_depthRenderBuffer);
     mp_context->glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, m_width * m_devicePixelRatio, m_height * m_devicePixelRatio);
     mp_context->glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depthRenderBuffer);
+    // Color and depth
+    m_memory.set(2 * 4 * static_cast<size_t>(m_width * m_devicePixelRatio) * (m_height * m_devicePixelRatio));
 
     // Set m_renderedTexture as the color output of our frame buffer
     mp_context->glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_outputTexture, 0);
@@ -56,14 +59,18 @@ void FrameBuffer::createPost() {
     }
 }
 
-void FrameBuffer::createDepth() {
+void FrameBuffer::createDepth(unsigned int size) {
+    m_width = size;
+    m_height = size;
+    m_devicePixelRatio = 1;
     // Initialize the frame buffers and render textures
     mp_context->glGenFramebuffers(1, &m_frameBuffer);
     mp_context->glGenTextures(1, &m_outputTexture);
 
     mp_context->glBindFramebuffer(GL_FRAMEBUFFER, m_frameBuffer);
-    mp_context->glBindTexture(GL_TEXTURE_2D, m_outputTexture);
-    mp_context->glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT16, 1024, 1024, 0, GL_DEPTH_COMPONENT, GL_FLOAT, 0);
+    mp_context->glState().bindTexture(m_outputTexture);
+    mp_context->glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, size, size, 0, GL_DEPTH_COMPONENT, GL_FLOAT, 0);
+    m_memory.set(4 * static_cast<size_t>(size) * size);
 
     mp_context->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
     mp_context->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
@@ -88,9 +95,10 @@ void FrameBuffer::destroy() {
     if(m_created) {
         m_created = false;
         mp_context->glDeleteFramebuffers(1, &m_frameBuffer);
-        mp_context->glDeleteTextures(1, &m_outputTexture);
+        mp_context->glState().deleteTexture(m_outputTexture);
         mp_context->glDeleteRenderbuffers(1, &m_depthRenderBuffer);
     }
+    m_memory.set(0);
 }
 
 void FrameBuffer::bindFrameBuffer() {
@@ -107,8 +115,7 @@ void FrameBuffer::clearFramebuffer() {
 
 void FrameBuffer::bindToTextureSlot(unsigned int slot) {
     m_textureSlot = slot;
-    mp_context->glActiveTexture(GL_TEXTURE0 + slot);
-    mp_context->glBindTexture(GL_TEXTURE_2D, m_outputTexture);
+    mp_context->glState().bindTexture(slot, m_outputTexture);
 }
 
 unsigned int FrameBuffer::getTextureSlot() const {
@@ -1,6 +1,7 @@
 #pragma once
 #include "openglcontext.h"
 #include "glm_includes.h"
+#include "memorystats.h"
 
 // A class representing a frame buffer in the OpenGL pipeline.
 // Stores three GPU handles: one to a frame buffer object, one to
@@ -23,6 +24,8 @@ private:
     bool m_created;
 
     unsigned int m_textureSlot;
+    // Storage of the attachments, at 4 bytes per texel of each
+    MemoryAccount m_memory;
 
 public:
     FrameBuffer(OpenGLContext *context, unsigned int width, unsigned int height, unsigned int devicePixelRatio);
@@ -31,8 +34,9 @@ public:
     void resize(unsigned int width, unsigned int height, unsigned int devicePixelRatio);
     // Initialize all GPU-side data required for post process texture
     void createPost();
-    // Initialize all GPU-side data required for shadow mapping
-    void createDepth();
+    // Initialize all GPU-side data required for shadow mapping, with a
+    // size x size depth texture
+    void createDepth(unsigned int size);
     // Deallocate all GPU-side data
     void destroy();
     void bindFrameBuffer();
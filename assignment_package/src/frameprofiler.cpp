@@ -0,0 +1,213 @@
+#include "frameprofiler.h"
+#include "trace.h"
+#include <QOpenGLContext>
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+FrameProfiler::FrameProfiler(QOpenGLExtraFunctions *gl)
+    : mp_gl(gl), m_gpuTiming(true), m_history(PROFILEHISTORY), m_frame(0), m_queries(),
+      m_queryFrame(), m_queryIssued(), m_queryActive(false),
+      m_getQueryObjectui64v(nullptr)
+{
+    m_queryFrame.fill(-1);
+}
+
+void FrameProfiler::create() {
+    m_getQueryObjectui64v = reinterpret_cast<GetQueryObjectui64v>(
+                QOpenGLContext::currentContext()->getProcAddress("glGetQueryObjectui64v"));
+    if (!m_getQueryObjectui64v) {
+        return;
+    }
+    for (auto &set : m_queries) {
+        mp_gl->glGenQueries(GPUPROFILESTAGES, set.data());
+    }
+}
+
+void FrameProfiler::destroy() {
+    for (auto &set : m_queries) {
+        mp_gl->glDeleteQueries(GPUPROFILESTAGES, set.data());
+        set.fill(0);
+    }
+}
+
+void FrameProfiler::setGpuTiming(bool enabled) {
+    m_gpuTiming = enabled;
+}
+
+ProfileFrame &FrameProfiler::row(int64_t frame) {
+    return m_history[frame % PROFILEHISTORY];
+}
+
+void FrameProfiler::collect(int set) {
+    int64_t frame = m_queryFrame[set];
+    m_queryFrame[set] = -1;
+    if (frame < 0 || m_frame - frame >= PROFILEHISTORY) {
+        return;
+    }
+    ProfileFrame &r = row(frame);
+    for (int s = 0; s < GPUPROFILESTAGES; s++) {
+        if (!m_queryIssued[set][s]) {
+            continue;
+        }
+        m_queryIssued[set][s] = false;
+        GLuint available = 0;
+        mp_gl->glGetQueryObjectuiv(m_queries[set][s], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            r.gpuMs[s] = -1.f;
+            continue;
+        }
+        GLuint64 nsecs = 0;
+        m_getQueryObjectui64v(m_queries[set][s], GL_QUERY_RESULT, &nsecs);
+        r.gpuMs[s] = nsecs / 1e6f;
+    }
+}
+
+void FrameProfiler::endFrame() {
+    m_frame++;
+    row(m_frame) = ProfileFrame();
+    // The next frame reuses this set, last issued the frame before this one
+    collect(m_frame % PROFILEQUERYSETS);
+}
+
+void FrameProfiler::beginStage(ProfileStage stage) {
+    int set = m_frame % PROFILEQUERYSETS;
+    if (!m_gpuTiming || stage >= GPUPROFILESTAGES || m_queryIssued[set][stage] || m_queryActive
+            || m_queries[set][stage] == 0) {
+        return;
+    }
+    mp_gl->glBeginQuery(GL_TIME_ELAPSED, m_queries[set][stage]);
+    m_queryIssued[set][stage] = true;
+    m_queryFrame[set] = m_frame;
+    m_queryActive = true;
+}
+
+void FrameProfiler::endStage(ProfileStage stage, qint64 nsecs) {
+    row(m_frame).cpuMs[stage] += nsecs / 1e6f;
+    if (m_queryActive && stage < GPUPROFILESTAGES && m_queryIssued[m_frame % PROFILEQUERYSETS][stage]) {
+        mp_gl->glEndQuery(GL_TIME_ELAPSED);
+        m_queryActive = false;
+    }
+}
+
+void FrameProfiler::summarize(std::vector<float> &values, float *mean, float *p99) {
+    *mean = 0.f;
+    *p99 = 0.f;
+    if (values.empty()) {
+        return;
+    }
+    float sum = 0.f;
+    for (float v : values) {
+        sum += v;
+    }
+    *mean = sum / values.size();
+    size_t rank = std::min(values.size() - 1, values.size() * 99 / 100);
+    std::nth_element(values.begin(), values.begin() + rank, values.end());
+    *p99 = values[rank];
+}
+
+std::string FrameProfiler::status() const {
+    int64_t frames = std::min<int64_t>(m_frame, PROFILEHISTORY);
+    std::vector<float> cpu, gpu;
+    cpu.reserve(frames);
+    gpu.reserve(frames);
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(2);
+    out << std::left << std::setw(12) << "stage" << " cpu avg/p99   gpu avg/p99";
+    for (int s = 0; s < PROFILESTAGES; s++) {
+        cpu.clear();
+        gpu.clear();
+        for (int64_t f = m_frame - frames; f < m_frame; f++) {
+            const ProfileFrame &r = m_history[f % PROFILEHISTORY];
+            cpu.push_back(r.cpuMs[s]);
+            if (s < GPUPROFILESTAGES && r.gpuMs[s] >= 0.f) {
+                gpu.push_back(r.gpuMs[s]);
+            }
+        }
+        float cpuMean, cpuP99, gpuMean, gpuP99;
+        summarize(cpu, &cpuMean, &cpuP99);
+        summarize(gpu, &gpuMean, &gpuP99);
+        out << "\n" << std::setw(12) << stageName(static_cast<ProfileStage>(s)) << " "
+            << std::right << std::setw(5) << cpuMean << "/" << std::left << std::setw(6) << cpuP99;
+        if (s < GPUPROFILESTAGES && m_gpuTiming) {
+            out << "  " << std::right << std::setw(5) << gpuMean << "/" << std::left << gpuP99;
+        }
+    }
+    return out.str();
+}
+
+bool FrameProfiler::writeCSV(const std::string &path) const {
+    std::ofstream out(path);
+    if (!out) {
+        return false;
+    }
+    out << "frame";
+    for (int s = 0; s < PROFILESTAGES; s++) {
+        out << "," << stageName(static_cast<ProfileStage>(s)) << " cpu ms";
+    }
+    for (int s = 0; s < GPUPROFILESTAGES; s++) {
+        out << "," << stageName(static_cast<ProfileStage>(s)) << " gpu ms";
+    }
+    out << "\n" << std::fixed << std::setprecision(4);
+    int64_t frames = std::min<int64_t>(m_frame, PROFILEHISTORY);
+    for (int64_t f = m_frame - frames; f < m_frame; f++) {
+        const ProfileFrame &r = m_history[f % PROFILEHISTORY];
+        out << f;
+        for (float ms : r.cpuMs) {
+            out << "," << ms;
+        }
+        // Results that never arrived are left empty
+        for (float ms : r.gpuMs) {
+            out << ",";
+            if (ms >= 0.f) {
+                out << ms;
+            }
+        }
+        out << "\n";
+    }
+    return bool(out);
+}
+
+const char *FrameProfiler::stageName(ProfileStage stage) {
+    switch (stage) {
+    case STAGE_SHADOWS: return "shadows";
+    case STAGE_SKY: return "sky";
+    case STAGE_TERRAIN_OPAQUE: return "opaque";
+    case STAGE_TERRAIN_TRANSLUCENT: return "translucent";
+    case STAGE_PLAYER: return "player";
+    case STAGE_POSTPROCESS: return "postprocess";
+    case STAGE_BLOCK_HIGHLIGHT: return "highlight";
+    case STAGE_INPUT: return "input";
+    case STAGE_PHYSICS: return "physics";
+    case STAGE_EXPANSION: return "expansion";
+    case STAGE_UPLOADS: return "uploads";
+    case STAGE_UPKEEP: return "upkeep";
+    default: return "?";
+    }
+}
+
+ProfileScope::ProfileScope(FrameProfiler &profiler, ProfileStage stage, bool enabled)
+    : mp_profiler(enabled ? &profiler : nullptr), m_stage(stage), m_timer(),
+      m_traceStartNs(enabled && Tracer::enabled() ? Tracer::nowNs() : -1)
+{
+    if (mp_profiler) {
+        mp_profiler->beginStage(stage);
+        m_timer.start();
+    }
+}
+
+ProfileScope::~ProfileScope() {
+    end();
+}
+
+void ProfileScope::end() {
+    if (mp_profiler) {
+        mp_profiler->endStage(m_stage, m_timer.nsecsElapsed());
+        mp_profiler = nullptr;
+    }
+    if (m_traceStartNs >= 0) {
+        Tracer::zone(FrameProfiler::stageName(m_stage), m_traceStartNs, Tracer::nowNs());
+        m_traceStartNs = -1;
+    }
+}
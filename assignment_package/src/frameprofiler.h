@@ -0,0 +1,103 @@
+#pragma once
+#include <QElapsedTimer>
+#include <QOpenGLExtraFunctions>
+#include <array>
+#include <string>
+#include <vector>
+
+// Frames kept for the averages, p99 and CSV dumps
+#define PROFILEHISTORY 300
+// Sets of GPU queries cycled through, so that results are read a frame
+// after they were issued instead of stalling on the current one
+#define PROFILEQUERYSETS 2
+// Where the C key writes the history to
+#define PROFILECSVPATH "frame_profile.csv"
+
+// Parts of a frame that are timed. The paintGL stages come first and
+// are also timed on the GPU; the tick stages only use the CPU.
+enum ProfileStage : unsigned char {
+    STAGE_SHADOWS, STAGE_SKY, STAGE_TERRAIN_OPAQUE, STAGE_TERRAIN_TRANSLUCENT,
+    STAGE_PLAYER, STAGE_POSTPROCESS, STAGE_BLOCK_HIGHLIGHT,
+    STAGE_INPUT, STAGE_PHYSICS, STAGE_EXPANSION, STAGE_UPLOADS, STAGE_UPKEEP,
+    PROFILESTAGES
+};
+#define GPUPROFILESTAGES (STAGE_BLOCK_HIGHLIGHT + 1)
+
+// Milliseconds each stage took in one frame; 0 if it did not run and,
+// for the GPU, -1 if its result was not ready in time
+struct ProfileFrame {
+    std::array<float, PROFILESTAGES> cpuMs;
+    std::array<float, GPUPROFILESTAGES> gpuMs;
+
+    ProfileFrame() : cpuMs(), gpuMs() {}
+};
+
+// Times the stages of each frame on the CPU and, with GL_TIME_ELAPSED
+// queries, on the GPU. Stages must not overlap, since only one elapsed
+// time query can be active at once; a stage entered twice in a frame
+// adds up its CPU time but only the first entry is timed on the GPU.
+class FrameProfiler {
+private:
+    QOpenGLExtraFunctions *mp_gl;
+    bool m_gpuTiming;
+    // Ring buffer of the last PROFILEHISTORY frames
+    std::vector<ProfileFrame> m_history;
+    int64_t m_frame;
+    std::array<std::array<GLuint, GPUPROFILESTAGES>, PROFILEQUERYSETS> m_queries;
+    // Frame each query set was issued in and which of its stages ran
+    std::array<int64_t, PROFILEQUERYSETS> m_queryFrame;
+    std::array<std::array<bool, GPUPROFILESTAGES>, PROFILEQUERYSETS> m_queryIssued;
+    bool m_queryActive;
+    // Not in QOpenGLExtraFunctions; resolved by create(), and without it
+    // no queries are made
+    typedef void (QOPENGLF_APIENTRYP GetQueryObjectui64v)(GLuint, GLenum, GLuint64*);
+    GetQueryObjectui64v m_getQueryObjectui64v;
+
+    ProfileFrame &row(int64_t frame);
+    // Copies the results of a query set into the frame it was issued in
+    void collect(int set);
+    // Mean and 99th percentile of one column over the history
+    static void summarize(std::vector<float> &values, float *mean, float *p99);
+
+public:
+    FrameProfiler(QOpenGLExtraFunctions *gl);
+
+    // Creates the queries; call once the GL context exists
+    void create();
+    void destroy();
+    // GPU timing is off when something else times the whole frame with
+    // its own elapsed time query
+    void setGpuTiming(bool enabled);
+
+    // Finishes the frame being built, which the stages timed since the
+    // last call belong to, and collects the GPU results of the frame
+    // before it if they are ready; results that are not are dropped.
+    void endFrame();
+    void beginStage(ProfileStage stage);
+    void endStage(ProfileStage stage, qint64 nsecs);
+
+    // One line per stage: average and p99 CPU and GPU milliseconds
+    std::string status() const;
+    // Writes the history as CSV, oldest frame first
+    bool writeCSV(const std::string &path) const;
+
+    static const char *stageName(ProfileStage stage);
+};
+
+// Times a stage from construction until end() or destruction, and
+// traces it as a zone named after the stage
+class ProfileScope {
+private:
+    FrameProfiler *mp_profiler;
+    ProfileStage m_stage;
+    QElapsedTimer m_timer;
+    // When the stage's trace zone started, or -1 if tracing was off
+    int64_t m_traceStartNs;
+
+public:
+    // A disabled scope times nothing, for code that only counts as the
+    // stage on some calls
+    ProfileScope(FrameProfiler &profiler, ProfileStage stage, bool enabled = true);
+    ~ProfileScope();
+    void end();
+};
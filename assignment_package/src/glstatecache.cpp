@@ -0,0 +1,143 @@
+#include "glstatecache.h"
+
+// No GL object gets this name, so it never matches a real binding
+static const GLuint UNKNOWN_BINDING = ~0u;
+
+GLStateCache::GLStateCache(QOpenGLExtraFunctions *gl)
+    : mp_gl(gl), m_program(UNKNOWN_BINDING), m_vertexArray(UNKNOWN_BINDING),
+      m_defaultVertexArray(0), m_arrayBuffer(UNKNOWN_BINDING), m_activeTexture(-1),
+      m_frame(), m_lastFrame()
+{
+    invalidate();
+}
+
+void GLStateCache::invalidate() {
+    m_program = UNKNOWN_BINDING;
+    m_vertexArray = UNKNOWN_BINDING;
+    m_arrayBuffer = UNKNOWN_BINDING;
+    m_activeTexture = -1;
+    for (GLuint &t : m_textures) {
+        t = UNKNOWN_BINDING;
+    }
+}
+
+void GLStateCache::beginFrame() {
+    m_lastFrame = m_frame;
+    m_frame = GLStateStats();
+    invalidate();
+}
+
+const GLStateStats &GLStateCache::lastFrame() const {
+    return m_lastFrame;
+}
+
+const GLStateStats &GLStateCache::currentFrame() const {
+    return m_frame;
+}
+
+void GLStateCache::useProgram(GLuint program) {
+    if (program == m_program) {
+        m_frame.programBindsElided++;
+        return;
+    }
+    mp_gl->glUseProgram(program);
+    m_program = program;
+    m_frame.programBinds++;
+}
+
+void GLStateCache::bindVertexArray(GLuint vao) {
+    if (vao == m_vertexArray) {
+        m_frame.vertexArrayBindsElided++;
+        return;
+    }
+    mp_gl->glBindVertexArray(vao);
+    m_vertexArray = vao;
+    m_frame.vertexArrayBinds++;
+}
+
+void GLStateCache::setDefaultVertexArray(GLuint vao) {
+    m_defaultVertexArray = vao;
+}
+
+void GLStateCache::bindDefaultVertexArray() {
+    bindVertexArray(m_defaultVertexArray);
+}
+
+void GLStateCache::bindArrayBuffer(GLuint buffer) {
+    if (buffer == m_arrayBuffer) {
+        m_frame.bufferBindsElided++;
+        return;
+    }
+    mp_gl->glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    m_arrayBuffer = buffer;
+    m_frame.bufferBinds++;
+}
+
+void GLStateCache::bindTexture(int slot, GLuint texture) {
+    if (slot < 0 || slot >= MAXCACHEDTEXTURESLOTS) {
+        mp_gl->glActiveTexture(GL_TEXTURE0 + slot);
+        mp_gl->glBindTexture(GL_TEXTURE_2D, texture);
+        m_activeTexture = -1;
+        m_frame.textureBinds++;
+        return;
+    }
+    if (m_textures[slot] == texture) {
+        m_frame.textureBindsElided++;
+        return;
+    }
+    if (m_activeTexture != slot) {
+        mp_gl->glActiveTexture(GL_TEXTURE0 + slot);
+        m_activeTexture = slot;
+    }
+    mp_gl->glBindTexture(GL_TEXTURE_2D, texture);
+    m_textures[slot] = texture;
+    m_frame.textureBinds++;
+}
+
+void GLStateCache::bindTexture(GLuint texture) {
+    mp_gl->glBindTexture(GL_TEXTURE_2D, texture);
+    if (m_activeTexture >= 0) {
+        m_textures[m_activeTexture] = texture;
+    }
+    m_frame.textureBinds++;
+}
+
+void GLStateCache::deleteBuffer(GLuint buffer) {
+    mp_gl->glDeleteBuffers(1, &buffer);
+    if (buffer == m_arrayBuffer) {
+        m_arrayBuffer = UNKNOWN_BINDING;
+    }
+}
+
+void GLStateCache::deleteVertexArray(GLuint vao) {
+    mp_gl->glDeleteVertexArrays(1, &vao);
+    if (vao == m_vertexArray) {
+        m_vertexArray = UNKNOWN_BINDING;
+    }
+}
+
+void GLStateCache::deleteTexture(GLuint texture) {
+    mp_gl->glDeleteTextures(1, &texture);
+    for (GLuint &t : m_textures) {
+        if (t == texture) {
+            t = UNKNOWN_BINDING;
+        }
+    }
+}
+
+void GLStateCache::countUniform(bool elided) {
+    if (elided) {
+        m_frame.uniformUploadsElided++;
+    } else {
+        m_frame.uniformUploads++;
+    }
+}
+
+void GLStateCache::countDraws(int drawCalls, int64_t triangles) {
+    m_frame.drawCalls += drawCalls;
+    m_frame.triangles += triangles;
+}
+
+void GLStateCache::countUpload(int64_t bytes) {
+    m_frame.uploadBytes += bytes;
+}
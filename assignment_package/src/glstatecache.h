@@ -0,0 +1,86 @@
+#pragma once
+#include <QOpenGLExtraFunctions>
+#include <cstdint>
+
+// Number of texture units whose bindings GLStateCache tracks
+#define MAXCACHEDTEXTURESLOTS 8
+
+// Binds and uniform uploads requested during one frame, and how many
+// of them GLStateCache skipped because they would not change anything,
+// plus the draws and buffer uploads made
+struct GLStateStats {
+    int programBinds, programBindsElided;
+    int vertexArrayBinds, vertexArrayBindsElided;
+    int bufferBinds, bufferBindsElided;
+    int textureBinds, textureBindsElided;
+    int uniformUploads, uniformUploadsElided;
+    int drawCalls;
+    int64_t triangles;
+    int64_t uploadBytes;
+
+    GLStateStats()
+        : programBinds(0), programBindsElided(0), vertexArrayBinds(0), vertexArrayBindsElided(0),
+          bufferBinds(0), bufferBindsElided(0), textureBinds(0), textureBindsElided(0),
+          uniformUploads(0), uniformUploadsElided(0), drawCalls(0), triangles(0), uploadBytes(0)
+    {}
+    int elided() const {
+        return programBindsElided + vertexArrayBindsElided + bufferBindsElided
+                + textureBindsElided + uniformUploadsElided;
+    }
+};
+
+// Shadows the bits of GL state the renderer changes most often so that
+// binding what is already bound costs nothing. Everything that binds
+// programs, VAOs, GL_ARRAY_BUFFER or 2D textures must go through here,
+// otherwise the shadow copy goes stale. The element array binding is
+// part of the VAO, so it is not tracked.
+class GLStateCache {
+private:
+    QOpenGLExtraFunctions *mp_gl;
+    GLuint m_program;
+    GLuint m_vertexArray;
+    // The VAO buffers are uploaded through, see bindDefaultVertexArray
+    GLuint m_defaultVertexArray;
+    GLuint m_arrayBuffer;
+    int m_activeTexture;
+    GLuint m_textures[MAXCACHEDTEXTURESLOTS];
+    GLStateStats m_frame;
+    GLStateStats m_lastFrame;
+
+public:
+    GLStateCache(QOpenGLExtraFunctions *gl);
+
+    // Forgets the shadowed state, for when something else (such as
+    // Qt compositing the widget) may have changed it
+    void invalidate();
+    // Publishes the counters of the frame that just ended, starts new
+    // ones and invalidates, since Qt draws between our frames
+    void beginFrame();
+    const GLStateStats &lastFrame() const;
+    // Counters of the frame in progress
+    const GLStateStats &currentFrame() const;
+
+    void useProgram(GLuint program);
+    void bindVertexArray(GLuint vao);
+    void setDefaultVertexArray(GLuint vao);
+    // Binds the shared VAO. Element array buffers must only be bound
+    // for uploading while it is bound, or they would be written into
+    // whichever Drawable's VAO was drawn last.
+    void bindDefaultVertexArray();
+    void bindArrayBuffer(GLuint buffer);
+    // Binds a 2D texture to the given unit
+    void bindTexture(int slot, GLuint texture);
+    // Binds a 2D texture to the active unit, for setting it up
+    void bindTexture(GLuint texture);
+    // Delete GL objects, forgetting them if they are bound so that a
+    // new object reusing the name is not mistaken for bound
+    void deleteBuffer(GLuint buffer);
+    void deleteVertexArray(GLuint vao);
+    void deleteTexture(GLuint texture);
+    // Counts a uniform upload a ShaderProgram made or skipped
+    void countUniform(bool elided);
+    // Counts draw calls drawing the given number of triangles
+    void countDraws(int drawCalls, int64_t triangles);
+    // Counts bytes copied from the CPU into GL buffers
+    void countUpload(int64_t bytes);
+};
@@ -0,0 +1,109 @@
+#include "gpuarena.h"
+#include <algorithm>
+
+GpuArena::GpuArena(OpenGLContext *context, size_t elementSize, size_t initialCapacity)
+    : mp_context(context), m_buffer(0), m_generated(false), m_elementSize(elementSize),
+      m_capacity(initialCapacity), m_used(0), m_free(), m_memory(MEMORY_MESH_GPU)
+{}
+
+GpuArena::~GpuArena() {
+    destroy();
+}
+
+void GpuArena::create() {
+    mp_context->glGenBuffers(1, &m_buffer);
+    m_generated = true;
+    // The copy targets leave the element array binding of whatever
+    // VAO is bound untouched
+    mp_context->glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+    mp_context->glBufferData(GL_COPY_WRITE_BUFFER, m_capacity * m_elementSize, nullptr, GL_DYNAMIC_DRAW);
+    m_free.clear();
+    m_free[0] = m_capacity;
+    m_used = 0;
+    m_memory.set(m_capacity * m_elementSize);
+}
+
+void GpuArena::destroy() {
+    if (m_generated) {
+        mp_context->glState().deleteBuffer(m_buffer);
+        m_generated = false;
+    }
+    m_memory.set(0);
+}
+
+void GpuArena::grow(size_t minCapacity) {
+    size_t capacity = std::max(m_capacity * 2, minCapacity);
+    GLuint buffer;
+    mp_context->glGenBuffers(1, &buffer);
+    mp_context->glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    mp_context->glBufferData(GL_COPY_WRITE_BUFFER, capacity * m_elementSize, nullptr, GL_DYNAMIC_DRAW);
+    mp_context->glBindBuffer(GL_COPY_READ_BUFFER, m_buffer);
+    mp_context->glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, m_capacity * m_elementSize);
+    mp_context->glState().deleteBuffer(m_buffer);
+    m_buffer = buffer;
+    release(m_capacity, capacity - m_capacity);
+    // release() counted the new space as freed from m_used
+    m_used += capacity - m_capacity;
+    m_capacity = capacity;
+    m_memory.set(m_capacity * m_elementSize);
+}
+
+size_t GpuArena::allocate(size_t count, bool *out_grew) {
+    *out_grew = false;
+    auto it = std::find_if(m_free.begin(), m_free.end(),
+                           [count](const std::pair<const size_t, size_t> &r) { return r.second >= count; });
+    if (it == m_free.end()) {
+        grow(m_capacity + count);
+        *out_grew = true;
+        it = std::find_if(m_free.begin(), m_free.end(),
+                          [count](const std::pair<const size_t, size_t> &r) { return r.second >= count; });
+    }
+    size_t offset = it->first;
+    size_t length = it->second;
+    m_free.erase(it);
+    if (length > count) {
+        m_free[offset + count] = length - count;
+    }
+    m_used += count;
+    return offset;
+}
+
+void GpuArena::release(size_t offset, size_t count) {
+    if (count == 0) {
+        return;
+    }
+    m_used -= count;
+    auto next = m_free.lower_bound(offset);
+    // Merge with the following free range
+    if (next != m_free.end() && next->first == offset + count) {
+        count += next->second;
+        next = m_free.erase(next);
+    }
+    // Merge with the preceding free range
+    if (next != m_free.begin()) {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == offset) {
+            prev->second += count;
+            return;
+        }
+    }
+    m_free[offset] = count;
+}
+
+void GpuArena::write(size_t offset, const void *data, size_t count) {
+    mp_context->glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+    mp_context->glBufferSubData(GL_COPY_WRITE_BUFFER, offset * m_elementSize, count * m_elementSize, data);
+    mp_context->glState().countUpload(count * m_elementSize);
+}
+
+GLuint GpuArena::buffer() const {
+    return m_buffer;
+}
+
+size_t GpuArena::capacityBytes() const {
+    return m_capacity * m_elementSize;
+}
+
+size_t GpuArena::usedBytes() const {
+    return m_used * m_elementSize;
+}
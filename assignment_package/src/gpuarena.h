@@ -0,0 +1,43 @@
+#pragma once
+#include "openglcontext.h"
+#include "memorystats.h"
+#include <map>
+
+// One GL buffer shared by many meshes, handed out in ranges of
+// fixed-size elements (vertices or indices). Freed ranges are merged
+// with their neighbors and reused first-fit; when no range is large
+// enough the buffer is reallocated at twice the size and its contents
+// copied over on the GPU.
+class GpuArena {
+private:
+    OpenGLContext *mp_context;
+    GLuint m_buffer;
+    bool m_generated;
+    size_t m_elementSize;
+    // Sizes in elements
+    size_t m_capacity;
+    size_t m_used;
+    // Free ranges, offset to length
+    std::map<size_t, size_t> m_free;
+    // The whole buffer, used or not, as MEMORY_MESH_GPU
+    MemoryAccount m_memory;
+
+    void grow(size_t minCapacity);
+
+public:
+    GpuArena(OpenGLContext *context, size_t elementSize, size_t initialCapacity);
+    ~GpuArena();
+
+    void create();
+    void destroy();
+    // Returns the offset of a range of count elements. Sets *out_grew
+    // if the buffer had to be reallocated, which invalidates any VAO
+    // that points at it.
+    size_t allocate(size_t count, bool *out_grew);
+    void release(size_t offset, size_t count);
+    void write(size_t offset, const void *data, size_t count);
+
+    GLuint buffer() const;
+    size_t capacityBytes() const;
+    size_t usedBytes() const;
+};
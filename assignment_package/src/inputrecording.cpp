@@ -0,0 +1,103 @@
+#include "inputrecording.h"
+#include <limits>
+#include <sstream>
+
+// First line of every recording; bump the version when the line
+// format changes
+#define INPUTRECORDINGHEADER "miniminecraft-input 1"
+
+InputRecorder::InputRecorder()
+    : m_out(), m_path(), m_ticks(0)
+{}
+
+bool InputRecorder::open(const std::string &path) {
+    close();
+    m_out.open(path, std::ios::trunc);
+    if (!m_out) {
+        return false;
+    }
+    m_path = path;
+    m_ticks = 0;
+    m_out.precision(std::numeric_limits<float>::max_digits10);
+    m_out << INPUTRECORDINGHEADER << "\n";
+    return true;
+}
+
+bool InputRecorder::isOpen() const {
+    return m_out.is_open();
+}
+
+void InputRecorder::record(const InputFrame &frame) {
+    if (!m_out.is_open()) {
+        return;
+    }
+    const InputBundle &in = frame.inputs;
+    m_out << frame.deltaMs << " "
+          << in.wPressed << in.aPressed << in.sPressed << in.dPressed << " "
+          << in.spacePressed << in.ePressed << in.qPressed << in.fPressed << in.shiftPressed << " "
+          << in.mouseX << " " << in.mouseY << " "
+          << static_cast<int>(frame.actions) << " " << frame.emote << " "
+          << frame.position.x << " " << frame.position.y << " " << frame.position.z << "\n";
+    m_ticks++;
+}
+
+void InputRecorder::close() {
+    if (m_out.is_open()) {
+        m_out.close();
+    }
+}
+
+const std::string &InputRecorder::path() const {
+    return m_path;
+}
+
+int InputRecorder::ticks() const {
+    return m_ticks;
+}
+
+namespace {
+
+// Reads a run of '0'/'1' digits into the given flags
+bool readFlags(const std::string &digits, std::vector<bool*> flags) {
+    if (digits.size() != flags.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < flags.size(); i++) {
+        if (digits[i] != '0' && digits[i] != '1') {
+            return false;
+        }
+        *flags[i] = digits[i] == '1';
+    }
+    return true;
+}
+
+}
+
+bool loadInputRecording(const std::string &path, std::vector<InputFrame> *frames) {
+    frames->clear();
+    std::ifstream in(path);
+    std::string line;
+    if (!in || !std::getline(in, line) || line != INPUTRECORDINGHEADER) {
+        return false;
+    }
+    while (std::getline(in, line)) {
+        if (line.empty()) {
+            continue;
+        }
+        std::istringstream fields(line);
+        InputFrame f;
+        InputBundle &b = f.inputs;
+        std::string movement, other;
+        int actions;
+        if (!(fields >> f.deltaMs >> movement >> other >> b.mouseX >> b.mouseY >> actions >> f.emote
+                     >> f.position.x >> f.position.y >> f.position.z)
+                || !readFlags(movement, {&b.wPressed, &b.aPressed, &b.sPressed, &b.dPressed})
+                || !readFlags(other, {&b.spacePressed, &b.ePressed, &b.qPressed, &b.fPressed, &b.shiftPressed})) {
+            frames->clear();
+            return false;
+        }
+        f.actions = static_cast<uint8_t>(actions);
+        frames->push_back(f);
+    }
+    return true;
+}
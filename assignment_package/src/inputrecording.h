@@ -0,0 +1,59 @@
+#pragma once
+#include "glm_includes.h"
+#include "scene/entity.h"
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Things the player does at one instant instead of by holding a key.
+// They are queued as they happen and applied at the start of the next
+// tick, so that a replay can apply them at the same point.
+enum PlayerAction : uint8_t {
+    ACTION_REMOVE_BLOCK = 1,
+    ACTION_ADD_BLOCK = 2,
+    ACTION_TOGGLE_VIEW = 4
+};
+
+// Everything one tick of the game took from the player
+struct InputFrame {
+    // Milliseconds of simulation the tick advanced by
+    int deltaMs;
+    // The InputBundle as the tick read it, before the Player consumed
+    // the mouse movement and the flight toggle
+    InputBundle inputs;
+    // PlayerAction flags
+    uint8_t actions;
+    // Emote played, 0 for none
+    int emote;
+    // Where the tick left the player, so that a replay can tell
+    // whether it still follows the recording
+    glm::vec3 position;
+
+    InputFrame() : deltaMs(0), inputs(), actions(0), emote(0), position(0.f) {}
+};
+
+// Writes one line of text per tick. Floats are written with enough
+// digits to read back exactly.
+class InputRecorder {
+private:
+    std::ofstream m_out;
+    std::string m_path;
+    int m_ticks;
+
+public:
+    InputRecorder();
+
+    // Starts a new recording, replacing whatever the file held
+    bool open(const std::string &path);
+    bool isOpen() const;
+    void record(const InputFrame &frame);
+    void close();
+
+    const std::string &path() const;
+    int ticks() const;
+};
+
+// Reads a whole recording; returns false and leaves frames empty if
+// the file is missing or malformed
+bool loadInputRecording(const std::string &path, std::vector<InputFrame> *frames);
@@ -1,8 +1,14 @@
 #include <mainwindow.h>
+#include "renderbenchmark.h"
+#include "memorystats.h"
 
 #include <QApplication>
 #include <QSurfaceFormat>
 #include <QDebug>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 
 void debugFormatVersion()
 {
@@ -19,8 +25,46 @@ void debugFormatVersion()
     printf("  Profile: %s\n", profile);
 }
 
+// Reads the --bench-render options; returns whether --bench-render was given
+bool parseBenchmarkArgs(int argc, char *argv[], RenderBenchmarkOptions *options)
+{
+    bool bench = false;
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--bench-render") == 0) {
+            bench = true;
+        } else if (std::strcmp(argv[i], "--frames") == 0 && hasValue) {
+            options->frames = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--warmup") == 0 && hasValue) {
+            options->warmupFrames = std::max(0, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--size") == 0 && hasValue) {
+            int w, h;
+            if (std::sscanf(argv[++i], "%dx%d", &w, &h) == 2 && w > 0 && h > 0) {
+                options->width = w;
+                options->height = h;
+            }
+        } else if (std::strcmp(argv[i], "--bench-out") == 0 && hasValue) {
+            options->outPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--replay") == 0 && hasValue) {
+            options->replayPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--replay-step") == 0 && hasValue) {
+            options->replayStepMs = std::max(0, std::atoi(argv[++i]));
+        }
+    }
+    return bench;
+}
+
 int main(int argc, char *argv[])
 {
+    RenderBenchmarkOptions benchOptions;
+    bool bench = parseBenchmarkArgs(argc, argv, &benchOptions);
+    // Without a display, render through the offscreen platform (e.g.
+    // Mesa's llvmpipe on a build machine)
+    if (bench && qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")
+            && qEnvironmentVariableIsEmpty("DISPLAY") && qEnvironmentVariableIsEmpty("WAYLAND_DISPLAY")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
     QApplication a(argc, argv);
 
     // Set OpenGL 4.0 and, optionally, 4-sample multisampling
@@ -37,6 +81,17 @@ int main(int argc, char *argv[])
     QSurfaceFormat::setDefaultFormat(format);
     debugFormatVersion();
 
+    // MINIMINECRAFT_MEMORY_BUDGETS=mesh-gpu=512,... sets per-category
+    // budgets in MiB; see MemoryStats::parseBudgets
+    QByteArray budgets = qgetenv("MINIMINECRAFT_MEMORY_BUDGETS");
+    if (!budgets.isEmpty() && !MemoryStats::parseBudgets(budgets.toStdString())) {
+        printf("Ignoring malformed MINIMINECRAFT_MEMORY_BUDGETS\n");
+    }
+
+    if (bench) {
+        return RenderBenchmark(benchOptions).run();
+    }
+
     MainWindow w;
     w.show();
 
@@ -18,6 +18,12 @@ MainWindow::MainWindow(QWidget *parent) :
     connect(ui->mygl, SIGNAL(sig_sendPlayerLook(QString)), &playerInfoWindow, SLOT(slot_setLookText(QString)));
     connect(ui->mygl, SIGNAL(sig_sendPlayerChunk(QString)), &playerInfoWindow, SLOT(slot_setChunkText(QString)));
     connect(ui->mygl, SIGNAL(sig_sendPlayerTerrainZone(QString)), &playerInfoWindow, SLOT(slot_setZoneText(QString)));
+    connect(ui->mygl, SIGNAL(sig_sendRenderStats(QString)), &playerInfoWindow, SLOT(slot_setRenderText(QString)));
+    connect(ui->mygl, SIGNAL(sig_sendViewDistance(QString)), &playerInfoWindow, SLOT(slot_setViewDistanceText(QString)));
+    connect(ui->mygl, SIGNAL(sig_sendShadowStats(QString)), &playerInfoWindow, SLOT(slot_setShadowText(QString)));
+    connect(ui->mygl, SIGNAL(sig_sendFrameProfile(QString)), &playerInfoWindow, SLOT(slot_setProfileText(QString)));
+    connect(ui->mygl, SIGNAL(sig_sendChunkLatency(QString)), &playerInfoWindow, SLOT(slot_setLatencyText(QString)));
+    connect(ui->mygl, SIGNAL(sig_sendMemoryStats(QString)), &playerInfoWindow, SLOT(slot_setMemoryText(QString)));
 }
 
 MainWindow::~MainWindow()
@@ -0,0 +1,160 @@
+#include "memorystats.h"
+#include <array>
+#include <atomic>
+#include <iomanip>
+#include <sstream>
+
+static std::array<std::atomic<int64_t>, MEMORYCATEGORIES> counters{};
+static std::array<std::atomic<int64_t>, MEMORYCATEGORIES> peaks{};
+static std::array<std::atomic<int64_t>, MEMORYCATEGORIES> budgets{};
+
+static double mib(int64_t bytes) {
+    return bytes / (1024.0 * 1024.0);
+}
+
+void MemoryStats::add(MemoryCategory c, int64_t bytes) {
+    int64_t now = counters[c].fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    int64_t peak = peaks[c].load(std::memory_order_relaxed);
+    while (now > peak && !peaks[c].compare_exchange_weak(peak, now, std::memory_order_relaxed)) {
+    }
+}
+
+int64_t MemoryStats::bytes(MemoryCategory c) {
+    return counters[c].load(std::memory_order_relaxed);
+}
+
+int64_t MemoryStats::peak(MemoryCategory c) {
+    return peaks[c].load(std::memory_order_relaxed);
+}
+
+int64_t MemoryStats::total() {
+    int64_t sum = 0;
+    for (int c = 0; c < MEMORYCATEGORIES; c++) {
+        sum += bytes(static_cast<MemoryCategory>(c));
+    }
+    return sum;
+}
+
+const char *MemoryStats::categoryName(MemoryCategory c) {
+    switch (c) {
+    case MEMORY_CHUNK_BLOCKS: return "chunk blocks";
+    case MEMORY_MESH_CPU: return "mesh cpu";
+    case MEMORY_MESH_GPU: return "mesh gpu";
+    case MEMORY_CHUNK_INDEX: return "chunk index";
+    case MEMORY_GENERATION_SCRATCH: return "generation scratch";
+    case MEMORY_JOB_QUEUES: return "job queues";
+    case MEMORY_TEXTURES: return "textures";
+    default: return "?";
+    }
+}
+
+void MemoryStats::setBudget(MemoryCategory c, int64_t bytes) {
+    budgets[c].store(bytes, std::memory_order_relaxed);
+}
+
+int64_t MemoryStats::budget(MemoryCategory c) {
+    return budgets[c].load(std::memory_order_relaxed);
+}
+
+bool MemoryStats::overBudget(MemoryCategory c) {
+    int64_t b = budget(c);
+    return b > 0 && bytes(c) > b;
+}
+
+bool MemoryStats::exceededBudget(MemoryCategory c) {
+    int64_t b = budget(c);
+    return b > 0 && peak(c) > b;
+}
+
+bool MemoryStats::parseBudgets(const std::string &spec) {
+    std::array<int64_t, MEMORYCATEGORIES> parsed;
+    for (int c = 0; c < MEMORYCATEGORIES; c++) {
+        parsed[c] = budget(static_cast<MemoryCategory>(c));
+    }
+    std::istringstream in(spec);
+    std::string entry;
+    while (std::getline(in, entry, ',')) {
+        size_t eq = entry.find('=');
+        if (eq == std::string::npos) {
+            return false;
+        }
+        std::string name = entry.substr(0, eq);
+        for (char &ch : name) {
+            if (ch == '-') {
+                ch = ' ';
+            }
+        }
+        int c = 0;
+        while (c < MEMORYCATEGORIES && name != categoryName(static_cast<MemoryCategory>(c))) {
+            c++;
+        }
+        std::istringstream value(entry.substr(eq + 1));
+        double megabytes;
+        if (c == MEMORYCATEGORIES || !(value >> megabytes) || megabytes < 0.0) {
+            return false;
+        }
+        parsed[c] = static_cast<int64_t>(megabytes * 1024.0 * 1024.0);
+    }
+    for (int c = 0; c < MEMORYCATEGORIES; c++) {
+        setBudget(static_cast<MemoryCategory>(c), parsed[c]);
+    }
+    return true;
+}
+
+std::string MemoryStats::status(int chunks, int compressedChunks, uint64_t compressions,
+                                uint64_t decompressions) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1);
+    out << std::left << std::setw(19) << "category" << std::right << std::setw(9) << "now"
+        << std::setw(9) << "peak" << std::setw(9) << "budget";
+    for (int i = 0; i < MEMORYCATEGORIES; i++) {
+        MemoryCategory c = static_cast<MemoryCategory>(i);
+        out << "\n" << std::left << std::setw(19) << categoryName(c) << std::right
+            << std::setw(9) << mib(bytes(c)) << std::setw(9) << mib(peak(c));
+        if (budget(c) > 0) {
+            out << std::setw(9) << mib(budget(c)) << (overBudget(c) ? " over" : "");
+        } else {
+            out << std::setw(9) << "-";
+        }
+    }
+    out << "\n" << std::left << std::setw(19) << "total" << std::right << std::setw(9) << mib(total())
+        << "\n" << chunks << " chunks, " << compressedChunks << " compressed"
+        << "\n" << compressions << " compressions, " << decompressions << " decompressions";
+    return out.str();
+}
+
+MemoryAccount::MemoryAccount(MemoryCategory category)
+    : m_category(category), m_bytes(0)
+{}
+
+MemoryAccount::MemoryAccount(MemoryAccount &&other) noexcept
+    : m_category(other.m_category), m_bytes(other.m_bytes)
+{
+    other.m_bytes = 0;
+}
+
+MemoryAccount &MemoryAccount::operator=(MemoryAccount &&other) noexcept {
+    if (this != &other) {
+        set(0);
+        m_category = other.m_category;
+        m_bytes = other.m_bytes;
+        other.m_bytes = 0;
+    }
+    return *this;
+}
+
+MemoryAccount::~MemoryAccount() {
+    set(0);
+}
+
+void MemoryAccount::set(size_t bytes) {
+    int64_t delta = static_cast<int64_t>(bytes) - m_bytes;
+    if (delta != 0) {
+        MemoryStats::add(m_category, delta);
+        m_bytes = static_cast<int64_t>(bytes);
+    }
+}
+
+size_t MemoryAccount::bytes() const {
+    return static_cast<size_t>(m_bytes);
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// What the bytes MemoryStats counts are spent on
+enum MemoryCategory {
+    // Block arrays of loaded Chunks, their compressed form and edits
+    MEMORY_CHUNK_BLOCKS,
+    // Meshes on their way from the meshers to the GPU
+    MEMORY_MESH_CPU,
+    // Buffers meshes are uploaded into, as sized by glBufferData
+    MEMORY_MESH_GPU,
+    // The hash table Chunks are looked up in
+    MEMORY_CHUNK_INDEX,
+    // Working space each thread keeps between meshing jobs
+    MEMORY_GENERATION_SCRATCH,
+    // Jobs waiting for or running on the thread pool
+    MEMORY_JOB_QUEUES,
+    // Textures and framebuffer attachments
+    MEMORY_TEXTURES,
+    MEMORYCATEGORIES
+};
+
+// Process-wide byte counters per MemoryCategory, kept up to date by
+// the MemoryAccounts of whatever holds the memory. Counting costs one
+// atomic add per change, from any thread. Each category may have a
+// budget, which only makes overBudget and the reports say so.
+class MemoryStats {
+public:
+    static void add(MemoryCategory c, int64_t bytes);
+    static int64_t bytes(MemoryCategory c);
+    // Highest bytes(c) so far
+    static int64_t peak(MemoryCategory c);
+    static int64_t total();
+    // Lower case, e.g. "mesh gpu"
+    static const char *categoryName(MemoryCategory c);
+
+    // Budget in bytes, 0 for none
+    static void setBudget(MemoryCategory c, int64_t bytes);
+    static int64_t budget(MemoryCategory c);
+    static bool overBudget(MemoryCategory c);
+    // Whether the peak ever went over the budget
+    static bool exceededBudget(MemoryCategory c);
+    // Sets budgets from a list such as "mesh-gpu=512,chunk-blocks=1024",
+    // in MiB, with dashes for the spaces of categoryName. Returns false
+    // and sets nothing if the list is malformed.
+    static bool parseBudgets(const std::string &spec);
+
+    // Current, peak and budget of every category in MiB, then the
+    // given Chunk counts and how often Chunks were compressed and
+    // decompressed
+    static std::string status(int chunks, int compressedChunks, uint64_t compressions, uint64_t decompressions);
+};
+
+// The bytes one object holds in one MemoryCategory. The object sets it
+// whenever that changes, and whatever is left is given back when the
+// account is destroyed. Moving an account moves its bytes with it.
+class MemoryAccount {
+private:
+    MemoryCategory m_category;
+    int64_t m_bytes;
+
+public:
+    explicit MemoryAccount(MemoryCategory category);
+    MemoryAccount(MemoryAccount &&other) noexcept;
+    MemoryAccount &operator=(MemoryAccount &&other) noexcept;
+    MemoryAccount(const MemoryAccount &) = delete;
+    MemoryAccount &operator=(const MemoryAccount &) = delete;
+    ~MemoryAccount();
+
+    void set(size_t bytes);
+    size_t bytes() const;
+};
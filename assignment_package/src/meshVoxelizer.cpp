@@ -1,5 +1,7 @@
-#include "mygl.h"
+#include "meshVoxelizer.h"
 #include "tinyobj/tiny_obj_loader.h"
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 
 void project(std::vector<glm::vec3> points, glm::vec3 axis,
@@ -59,59 +61,46 @@ bool voxelTriangleIntersection(int x, int y, int z, std::vector<glm::vec3> trian
     return true;
 }
 
-void createFromOBJ(const char* filename, Terrain *t)
+std::vector<glm::ivec3> voxelizeTriangles(const std::vector<std::vector<int>> &faces,
+                                          const std::vector<float> &positions, glm::vec3 initialPos)
 {
-    std::vector<tinyobj::shape_t> shapes; std::vector<tinyobj::material_t> materials;
-    std::vector<std::vector<int>> faces;
-    std::vector<float> positions;
-    std::string errors = tinyobj::LoadObj(shapes, materials, faces, positions, filename);
-    std::cout << errors << std::endl;
-    if(errors.size() == 0)
+    std::vector<glm::ivec3> voxels;
+    for(const std::vector<int> &face: faces)
     {
-        std::map<Chunk*, bool> chunks;
-        for(const std::vector<int> &face: faces)
-        {
-            glm::vec3 initialPos = glm::vec3(117.f, 100.f, 197.f);
-            float scale = 1.f;
-            glm::vec3 vert1 = glm::vec3(scale * positions[3 * face[0]] + initialPos.x, scale * positions[3 * face[0] + 1] + initialPos.y, scale * positions[3 * face[0] + 2] + initialPos.z);
-            glm::vec3 vert2 = glm::vec3(scale * positions[3 * face[1]] + initialPos.x, scale * positions[3 * face[1] + 1] + initialPos.y, scale * positions[3 * face[1] + 2] + initialPos.z);
-            glm::vec3 vert3 = glm::vec3(scale * positions[3 * face[2]] + initialPos.x, scale * positions[3 * face[2] + 1] + initialPos.y, scale * positions[3 * face[2] + 2] + initialPos.z);
-            int minx = glm::floor(std::min({vert1.x, vert2.x, vert3.x}));
-            int maxx = glm::ceil(std::max({vert1.x, vert2.x, vert3.x}));
-            int miny = glm::floor(std::min({vert1.y, vert2.y, vert3.y}));
-            int maxy = glm::ceil(std::max({vert1.y, vert2.y, vert3.y}));
-            int minz = glm::floor(std::min({vert1.z, vert2.z, vert3.z}));
-            int maxz = glm::ceil(std::max({vert1.z, vert2.z, vert3.z}));
-            for (int z = minz; z <= maxz; z++){
-                for (int y = miny; y <= maxy; y++){
-                    for (int x = minx; x <= maxx; x++){
-                        if (voxelTriangleIntersection(x, y, z, {vert1, vert2, vert3})){
-                            Chunk *chunk = t->getChunkAt(x, z).get();
-                            if (chunks.find(chunk) == chunks.end()){
-                                chunks[chunk] = true;
-                            }
-                            t->setBlockAt(x, y, z, DUNE);
-                        }else{
-                            //std::cout << "no intersection" << std::endl;
-                        }
+        float scale = 1.f;
+        glm::vec3 vert1 = glm::vec3(scale * positions[3 * face[0]] + initialPos.x, scale * positions[3 * face[0] + 1] + initialPos.y, scale * positions[3 * face[0] + 2] + initialPos.z);
+        glm::vec3 vert2 = glm::vec3(scale * positions[3 * face[1]] + initialPos.x, scale * positions[3 * face[1] + 1] + initialPos.y, scale * positions[3 * face[1] + 2] + initialPos.z);
+        glm::vec3 vert3 = glm::vec3(scale * positions[3 * face[2]] + initialPos.x, scale * positions[3 * face[2] + 1] + initialPos.y, scale * positions[3 * face[2] + 2] + initialPos.z);
+        int minx = glm::floor(std::min({vert1.x, vert2.x, vert3.x}));
+        int maxx = glm::ceil(std::max({vert1.x, vert2.x, vert3.x}));
+        int miny = glm::floor(std::min({vert1.y, vert2.y, vert3.y}));
+        int maxy = glm::ceil(std::max({vert1.y, vert2.y, vert3.y}));
+        int minz = glm::floor(std::min({vert1.z, vert2.z, vert3.z}));
+        int maxz = glm::ceil(std::max({vert1.z, vert2.z, vert3.z}));
+        for (int z = minz; z <= maxz; z++){
+            for (int y = miny; y <= maxy; y++){
+                for (int x = minx; x <= maxx; x++){
+                    if (voxelTriangleIntersection(x, y, z, {vert1, vert2, vert3})){
+                        voxels.push_back(glm::ivec3(x, y, z));
                     }
                 }
             }
         }
-        for (auto const& x : chunks){
-            Chunk* chunk = x.first;
-            chunk->createVBOdata();
-            chunk->sendVBOdata();
-        }
     }
-    else
+    return voxels;
+}
+
+std::vector<glm::ivec3> voxelizeOBJ(const char* filename, glm::vec3 initialPos)
+{
+    std::vector<tinyobj::shape_t> shapes; std::vector<tinyobj::material_t> materials;
+    std::vector<std::vector<int>> faces;
+    std::vector<float> positions;
+    std::string errors = tinyobj::LoadObj(shapes, materials, faces, positions, filename);
+    if(errors.size() != 0)
     {
         //An error loading the OBJ occurred!
         std::cout << errors << std::endl;
+        return {};
     }
+    return voxelizeTriangles(faces, positions, initialPos);
 }
-
-void MyGL::createVoxels(){
-    createFromOBJ(":/objs/statue.obj", &m_terrain);
-}
-
@@ -0,0 +1,15 @@
+#pragma once
+#include "glm_includes.h"
+#include <string>
+#include <vector>
+
+// Separating axis test between the unit voxel at (x, y, z) and a triangle
+bool voxelTriangleIntersection(int x, int y, int z, std::vector<glm::vec3> triangle);
+// Every voxel the triangles of an OBJ mesh pass through, with the mesh
+// moved by initialPos. A voxel touched by several triangles is listed
+// once for each of them.
+std::vector<glm::ivec3> voxelizeTriangles(const std::vector<std::vector<int>> &faces,
+                                          const std::vector<float> &positions, glm::vec3 initialPos);
+// Loads an OBJ file and returns the voxels its surface passes through,
+// or nothing if it could not be loaded. Safe to call from any thread.
+std::vector<glm::ivec3> voxelizeOBJ(const char* filename, glm::vec3 initialPos);
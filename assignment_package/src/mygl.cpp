@@ -6,18 +6,45 @@
 #include <QKeyEvent>
 #include <QDateTime>
 #include <QDebug>
+#include <QElapsedTimer>
+#include <QOpenGLContext>
+#include "trace.h"
 
 
-MyGL::MyGL(QWidget *parent)
-    : OpenGLContext(parent),
+MyGL::MyGL(QWidget *parent, bool interactive)
+    : OpenGLContext(parent), m_interactive(interactive), m_tracePath(), m_recorder(),
       m_worldAxes(this),
       m_progLambert(this), m_progFlat(this), m_progInstanced(this), m_progSky(this), m_progShadow(this), m_progPlayer(this),
-      m_terrain(this), m_player(glm::vec3(117.f, 160.f, 197.f), m_terrain),
+      m_terrain(this), m_player(glm::vec3(117.f, 160.f, 197.f), m_terrain), m_inputs(), m_pendingActions(0), m_pendingEmote(0),
       m_time(QDateTime::currentMSecsSinceEpoch()), m_shaderTime(0), m_timeElapsed(0.f), m_timeStep(1.f),
+      m_viewDistance(NUMZONETODRAW, MINZONETODRAW, MAXZONETODRAW), m_paintMs(0.f), m_overBudget(0),
+      m_startup(), m_statue(),
       m_texture(nullptr), postFrameBuffer(this, this->width(), this->height(), this->devicePixelRatio()),
-      depthFrameBuffer(this, this->width(), this->height(), this->devicePixelRatio()), sunViewProj(),
+      depthFrameBuffer(this, this->width(), this->height(), this->devicePixelRatio()), m_shadowCascades(),
       m_postprocessShaders(), mp_progPostprocessCurrent(nullptr), quad(this), m_displayedBlock(this), m_displayedPlayer(this, glm::vec3(0, 0, 0))
 {
+    Tracer::setThreadName("GL thread");
+    // MINIMINECRAFT_TRACE=<file> traces the whole session into that file
+    QByteArray tracePath = qgetenv("MINIMINECRAFT_TRACE");
+    if (!tracePath.isEmpty()) {
+        m_tracePath = tracePath.toStdString();
+        Tracer::setEnabled(true);
+    }
+    if (!m_interactive) {
+        // Driven frame by frame instead; see RenderBenchmark
+        m_viewDistance.setEnabled(false);
+        return;
+    }
+    // MINIMINECRAFT_RECORD=<file> records every tick's input into that
+    // file, for --bench-render --replay
+    QByteArray recordPath = qgetenv("MINIMINECRAFT_RECORD");
+    if (!recordPath.isEmpty()) {
+        if (m_recorder.open(recordPath.toStdString())) {
+            std::cout << "Recording input to " << m_recorder.path() << std::endl;
+        } else {
+            std::cerr << "Could not record input to " << recordPath.toStdString() << std::endl;
+        }
+    }
     // Connect the timer to a function so that when the timer ticks the function is executed
     connect(&m_timer, SIGNAL(timeout()), this, SLOT(tick()));
     // Tell the timer to redraw 60 times per second
@@ -29,8 +56,23 @@ MyGL::MyGL(QWidget *parent)
 }
 
 MyGL::~MyGL() {
-    makeCurrent();
+    // Workers hold pointers into m_terrain, which saves its Chunks
+    // when it is destroyed
+    QThreadPool::globalInstance()->waitForDone();
+    if (m_recorder.isOpen()) {
+        m_recorder.close();
+        std::cout << m_recorder.ticks() << " ticks of input recorded to " << m_recorder.path() << std::endl;
+    }
+    if (!m_tracePath.empty() && Tracer::enabled()) {
+        Tracer::write(m_tracePath);
+    }
+    // A RenderBenchmark keeps its own context current instead
+    if (m_interactive) {
+        makeCurrent();
+    }
     glDeleteVertexArrays(1, &vao);
+    uniforms().destroy();
+    profiler().destroy();
 }
 
 
@@ -38,8 +80,17 @@ void MyGL::moveMouseToCenter() {
     QCursor::setPos(this->mapToGlobal(QPoint(width() / 2, height() / 2)));
 }
 
+void MyGL::createVoxels(){
+    m_statue.startVoxelizing(":/objs/statue.obj", glm::vec3(117.f, 100.f, 197.f));
+}
+
 void MyGL::initializeGL()
 {
+    // From MyGL's construction until Qt had a window and context ready
+    m_startup.mark("window");
+    // The OBJ is voxelized on a thread of its own while the rest starts
+    createVoxels();
+
     // Create an OpenGL context using Qt's QOpenGLFunctions_3_2_Core class
     // If you were programming in a non-Qt context you might use GLEW (GL Extension Wrangler)instead
     initializeOpenGLFunctions();
@@ -56,57 +107,87 @@ void MyGL::initializeGL()
 
     printGLErrorLog();
 
-    // Create a Vertex Attribute Object
+    // Create a Vertex Attribute Object. Every Drawable draws through
+    // a VAO of its own; this one is bound while buffers are uploaded.
     glGenVertexArrays(1, &vao);
+    glState().setDefaultVertexArray(vao);
+    glState().bindDefaultVertexArray();
+    uniforms().create();
+    profiler().create();
 
     //Create the instance of the world axes
     m_worldAxes.createVBOdata();
 
 
-    // Set up all shader programs
+    // Set up all shader programs. The driver may compile them while
+    // the textures load and the spawn zone is generated below.
     loadProcessShader();
-
-    // Set a color with which to draw geometry.
-    // This will ultimately not be used when you change
-    // your program to render Chunks with vertex colors
-    // and UV coordinates
-    m_progLambert.setGeometryColor(glm::vec4(0,1,0,1));
-
-
-    // We have to have a VAO bound in OpenGL 3.2 Core. But if we're not
-    // using multiple VAOs, we can just bind one once.
-    glBindVertexArray(vao);
+    m_startup.mark("shaders issued");
 
     // Initialize frame buffer and quad
     postFrameBuffer.createPost();
-    depthFrameBuffer.createDepth();
+    depthFrameBuffer.createDepth(2 * SHADOWMAPSIZE);
     quad.createVBOdata();
 
     m_texture = mkU<Texture>(this);
     m_texture->create(":/textures/minecraft_textures_all.png");
     m_texture->load(0);
-
+    m_startup.mark("textures");
+
+    // MINIMINECRAFT_SAVE_DIR=<directory> saves the world there, whole
+    // Chunks as they are generated, and reads revisited zones back
+    // instead of generating them; without it nothing is saved.
+    // MINIMINECRAFT_SAVE_MODE=deltas only saves the player's changes to
+    // the generated world.
+    // Benchmarks need the generated world, not whatever was saved last,
+    // and so does a recording that is to be replayed by one
+    QByteArray saveDir = qgetenv("MINIMINECRAFT_SAVE_DIR");
+    if (m_interactive && !m_recorder.isOpen() && !saveDir.isEmpty()) {
+        m_terrain.enablePersistence(saveDir.toStdString(),
+                                    qgetenv("MINIMINECRAFT_SAVE_MODE") == "deltas" ? SAVE_EDIT_DELTAS : SAVE_FULL_CHUNKS);
+        std::cout << "Saving the world to " << saveDir.toStdString() << std::endl;
+    }
+    m_terrain.createDrawArena();
     m_terrain.CreateInitialScene(m_player.mcr_position);
-    moveMouseToCenter();
+    m_startup.mark("spawn chunk");
 
-    createVoxels();
+    finishShaders();
+    m_startup.mark("shaders linked");
+    // Set a color with which to draw geometry.
+    // This will ultimately not be used when you change
+    // your program to render Chunks with vertex colors
+    // and UV coordinates
+    m_progLambert.setGeometryColor(glm::vec4(0,1,0,1));
+
+    if (m_interactive) {
+        moveMouseToCenter();
+    }
     m_displayedPlayer.createVBOdata();
     //m_terrain.setBlockAt(100, 200, 100, DIRT);
 
+    if (!m_interactive) {
+        // A RenderBenchmark, and a replay above all, starts from the
+        // whole scene rather than however far the workers got. Each pass
+        // waits for the workers, so two passes in a row with nothing to
+        // mesh or upload mean no zone is in flight and the pending ones
+        // will never finish.
+        int idlePasses = 0;
+        while (m_terrain.pendingZoneCount() > 0 || idlePasses == 0) {
+            idlePasses = streamTerrain() > 0 ? 0 : idlePasses + 1;
+            if (idlePasses == 2 && m_terrain.pendingZoneCount() > 0) {
+                std::cout << m_terrain.pendingZoneCount() << " zones of the initial scene never finished" << std::endl;
+                break;
+            }
+            QThreadPool::globalInstance()->waitForDone();
+        }
+        checkStartup();
+    }
 }
 
 void MyGL::resizeGL(int w, int h) {
     //This code sets the concatenated view and perspective projection matrices used for
     //our scene's camera view.
     m_player.setCameraWidthHeight(static_cast<unsigned int>(w), static_cast<unsigned int>(h));
-    glm::mat4 viewproj = m_player.mcr_camera.getViewProj();
-
-    // Upload the view-projection matrix to our shaders (i.e. onto the graphics card)
-
-    m_progLambert.setViewProjMatrix(viewproj);
-    m_progFlat.setViewProjMatrix(viewproj);
-    m_progSky.setViewProjMatrix(glm::inverse(viewproj));
-    m_progSky.setDimension(width(), height());
 
     for(std::shared_ptr<PostProcessShader> p : m_postprocessShaders)
     {
@@ -126,19 +207,75 @@ void MyGL::resizeGL(int w, int h) {
 // all per-frame actions here, such as performing physics updates on all
 // entities in the scene.
 void MyGL::tick() {
+    TRACE_SCOPE("tick");
+    QElapsedTimer tickTimer;
+    tickTimer.start();
     quint64 deltaTime = QDateTime::currentMSecsSinceEpoch() - m_time;
     m_time = QDateTime::currentMSecsSinceEpoch();
-    m_player.tick(deltaTime/100.f, this->m_inputs);
+    InputFrame frame;
+    frame.deltaMs = static_cast<int>(deltaTime);
+    frame.inputs = m_inputs;
+    frame.actions = m_pendingActions;
+    frame.emote = m_pendingEmote;
+    m_pendingActions = 0;
+    m_pendingEmote = 0;
+    stepPlayer(m_inputs, frame.actions, frame.emote, frame.deltaMs);
+    if (m_recorder.isOpen()) {
+        frame.position = m_player.mcr_position;
+        m_recorder.record(frame);
+    }
+
+    int uploadBacklog = streamTerrain();
+    // The new radius applies from the next tick's expansion check on
+    float frameMs = tickTimer.nsecsElapsed() / 1e6f + m_paintMs;
+    m_terrain.setViewDistance(m_viewDistance.update(frameMs, uploadBacklog, m_terrain.pendingZoneCount(), currentMSecs()));
+    checkMemoryBudgets();
+    checkStartup();
+
+    m_displayedBlock.updateBlock(m_player.getLookAtBlock());
+    m_progPlayer.setAnimation(m_player.m_animation.getCurrAnimation(), m_player.m_animation.getCurrFrame());
+
+    update(); // Calls paintGL() as part of a larger QOpenGLWidget pipeline
+    sendPlayerDataToGUI(); // Updates the info in the secondary window displaying player data
+
+}
+
+void MyGL::stepPlayer(InputBundle &inputs, uint8_t actions, int emote, int deltaMs) {
+    {
+        ProfileScope input(profiler(), STAGE_INPUT);
+        if (actions & ACTION_TOGGLE_VIEW) {
+            m_player.toggleFirstPersonOnOff();
+        }
+        if (emote != 0) {
+            m_player.playEmote(emote);
+        }
+        if (actions & ACTION_REMOVE_BLOCK) {
+            m_player.removeBlock();
+        }
+        if (actions & ACTION_ADD_BLOCK) {
+            m_player.addBlock();
+        }
+        m_player.applyInputs(inputs);
+    }
+    {
+        ProfileScope physics(profiler(), STAGE_PHYSICS);
+        m_player.simulate(deltaMs / 100.f);
+    }
+}
 
+int MyGL::streamTerrain() {
+    ProfileScope expansion(profiler(), STAGE_EXPANSION);
     std::vector<int64_t> terrainsNotExpanded = m_terrain.checkExpansion(m_player.mcr_position);
 
     std::vector<std::vector<Chunk*>> terrainsChunks;
     for (unsigned int i = 0; i < terrainsNotExpanded.size(); i++) {
+        m_terrain.markZonePending(terrainsNotExpanded.at(i));
         std::vector<Chunk*> localChunks;
         for (int x = 0; x < 4; x++) {
             for (int z = 0; z < 4; z++) {
                 glm:: ivec2 tz_coords = toCoords(terrainsNotExpanded.at(i));
                 Chunk* c = m_terrain.createChunkAt(tz_coords.x + 16 * x, tz_coords.y + 16 * z);
+                c->stampPipeline(STAMP_REQUESTED);
                 localChunks.push_back(c);
             }
         }
@@ -155,6 +292,8 @@ void MyGL::tick() {
     }
 
     m_terrain.m_chunksWithOnlyBlockDataLock.lock();
+    int uploadBacklog = m_terrain.m_chunksWithOnlyBlockData.size();
+    Tracer::counter("chunks to mesh", uploadBacklog);
     for (Chunk *c : m_terrain.m_chunksWithOnlyBlockData) {
         VBOWorker *vboWorker = new VBOWorker(
                                              &m_terrain.m_chunksWithVBOData,
@@ -164,21 +303,54 @@ void MyGL::tick() {
     }
     m_terrain.m_chunksWithOnlyBlockData.clear();
     m_terrain.m_chunksWithOnlyBlockDataLock.unlock();
+    expansion.end();
 
+    ProfileScope uploads(profiler(), STAGE_UPLOADS);
     m_terrain.m_chunksWithVBODataLock.lock();
-    for (ChunkVBOData c: m_terrain.m_chunksWithVBOData) {
-        c.associated_chunk->sendVBOdata();
+    uploadBacklog += m_terrain.m_chunksWithVBOData.size();
+    Tracer::counter("chunks to upload", m_terrain.m_chunksWithVBOData.size());
+    Tracer::counter("zones pending", m_terrain.pendingZoneCount());
+    for (ChunkVBOData &c: m_terrain.m_chunksWithVBOData) {
+        TRACE_SCOPE("upload chunk");
+        m_terrain.uploadChunk(c);
+        m_terrain.markChunkUploaded(c.associated_chunk);
     }
     m_terrain.m_chunksWithVBOData.clear();
     m_terrain.m_chunksWithVBODataLock.unlock();
+    uploads.end();
+
+    ProfileScope upkeep(profiler(), STAGE_UPKEEP);
+    m_terrain.unloadZones(m_player.mcr_position);
+    m_terrain.compressColdChunks();
+    m_terrain.saveDirtyChunks(false);
+    m_terrain.updateLOD(m_player.mcr_position);
+    // Without a window nothing else happens meanwhile, so there is no
+    // point in not waiting for the voxels
+    m_statue.place(&m_terrain, !m_interactive);
+    return uploadBacklog;
+}
 
-    m_displayedBlock.updateBlock(m_player.getLookAtBlock());
-    m_progPlayer.setAnimation(m_player.m_animation.getCurrAnimation());
-    m_progPlayer.setCurrFrame(m_player.m_animation.getCurrFrame());
-
-    update(); // Calls paintGL() as part of a larger QOpenGLWidget pipeline
-    sendPlayerDataToGUI(); // Updates the info in the secondary window displaying player data
+void MyGL::checkMemoryBudgets() {
+    for (int i = 0; i < MEMORYCATEGORIES; i++) {
+        MemoryCategory c = static_cast<MemoryCategory>(i);
+        int bit = 1 << i;
+        bool over = MemoryStats::overBudget(c);
+        if (over == ((m_overBudget & bit) != 0)) {
+            continue;
+        }
+        m_overBudget ^= bit;
+        std::cout << "Memory " << (over ? "over" : "back within") << " budget: " << MemoryStats::categoryName(c)
+                  << " " << MemoryStats::bytes(c) / (1024 * 1024) << " of " << MemoryStats::budget(c) / (1024 * 1024)
+                  << " MiB" << std::endl;
+    }
+}
 
+void MyGL::checkStartup() {
+    if (m_startup.reported() || m_terrain.pendingZoneCount() > 0) {
+        return;
+    }
+    m_startup.mark("zones streamed");
+    std::cout << "Startup (ms):" << std::endl << m_startup.report() << std::endl;
 }
 
 void MyGL::sendPlayerDataToGUI() const {
@@ -191,15 +363,35 @@ void MyGL::sendPlayerDataToGUI() const {
     glm::ivec2 zone(64 * glm::ivec2(glm::floor(pPos / 64.f)));
     emit sig_sendPlayerChunk(QString::fromStdString("( " + std::to_string(chunk.x) + ", " + std::to_string(chunk.y) + " )"));
     emit sig_sendPlayerTerrainZone(QString::fromStdString("( " + std::to_string(zone.x) + ", " + std::to_string(zone.y) + " )"));
+    int drawCalls = m_terrain.drawStats(false).drawCalls + m_terrain.drawStats(true).drawCalls;
+    emit sig_sendRenderStats(QString::fromStdString(std::to_string(drawCalls) + " draws, "
+                                                    + std::to_string(glState().lastFrame().elided()) + " binds skipped, "
+                                                    + std::to_string(m_terrain.drawStats(false).lodColumns) + " LOD columns"));
+    emit sig_sendViewDistance(QString::fromStdString(m_viewDistance.status()));
+    emit sig_sendShadowStats(QString::fromStdString(m_shadowCascades.status()));
+    emit sig_sendFrameProfile(QString::fromStdString(profiler().status()));
+    emit sig_sendChunkLatency(QString::fromStdString(m_terrain.pipelineLatency().status()));
+    emit sig_sendMemoryStats(QString::fromStdString(MemoryStats::status(m_terrain.chunkCount(),
+                                                                        m_terrain.compressedChunkCount(),
+                                                                        Chunk::compressionCount(),
+                                                                        Chunk::decompressionCount())));
 }
 
 // This function is called whenever update() is called.
 // MyGL's constructor links update() to a timer that fires 60 times per second,
 // so paintGL() called at a rate of 60 frames per second.
 void MyGL::paintGL() {
+    TRACE_SCOPE("paint");
+    QElapsedTimer paintTimer;
+    paintTimer.start();
+    glState().beginFrame();
+    updateFrameUniforms();
     // shadow map rendering
-    depthRendering();
-    setDepthFrameBufferTexture();
+    {
+        ProfileScope shadows(profiler(), STAGE_SHADOWS);
+        depthRendering();
+        setDepthFrameBufferTexture();
+    }
 
     // prepare framebuffer
     postFrameBuffer.bindFrameBuffer();
@@ -207,21 +399,7 @@ void MyGL::paintGL() {
     postFrameBuffer.clearFramebuffer();
 
     glm::mat4 viewproj = m_player.mcr_camera.getViewProj();
-    // flat shader setup
-    m_progFlat.setViewProjMatrix(viewproj);
-    // lambert shader setup
-    m_progLambert.setViewProjMatrix(viewproj);
-    m_progLambert.setShadowViewProjMatrix(sunViewProj);
     m_progLambert.setModelMatrix(glm::mat4());
-    m_progLambert.setTime(m_shaderTime);
-    m_progLambert.setTimeElp(m_timeElapsed);
-    // skybox shader setup
-    m_progSky.setViewProjMatrix(glm::inverse(viewproj));
-    m_progSky.setEye(m_player.mcr_camera.mcr_position);
-    m_progSky.setTime(m_shaderTime);
-    m_progSky.setTimeElp(m_timeElapsed);
-
-    m_progLambert.setCameraPos(m_player.mcr_camera.mcr_position);
     mp_progPostprocessCurrent->setTime(m_shaderTime);
 
     m_shaderTime++;
@@ -229,38 +407,54 @@ void MyGL::paintGL() {
 
     m_texture->bind(0);
 
-    m_progSky.draw(quad);
-    renderTerrain(&m_progLambert, false);
+    {
+        ProfileScope sky(profiler(), STAGE_SKY);
+        m_progSky.draw(quad);
+    }
+    renderTerrain(&m_progLambert, viewproj, false);
 
-    renderThirdPersonPlayer();
-    performPostprocessRenderPass();
+    {
+        ProfileScope player(profiler(), STAGE_PLAYER);
+        renderThirdPersonPlayer();
+    }
+    {
+        ProfileScope postprocess(profiler(), STAGE_POSTPROCESS);
+        performPostprocessRenderPass();
+    }
 
     if (m_displayedBlock.getBlock().display)
     {
+        ProfileScope highlight(profiler(), STAGE_BLOCK_HIGHLIGHT);
         glDisable(GL_DEPTH_TEST);
         m_progFlat.setModelMatrix(glm::mat4());
-        m_progFlat.setViewProjMatrix(m_player.mcr_camera.getViewProj());
         m_displayedBlock.createVBOdata();
         m_progFlat.draw(m_displayedBlock);
         glEnable(GL_DEPTH_TEST);
     }
-
+    m_paintMs = paintTimer.nsecsElapsed() / 1e6f;
+    profiler().endFrame();
+    if (!m_startup.reported() && !m_startup.hasStep("first frame")) {
+        m_startup.mark("first frame");
+        std::cout << "First frame after " << m_startup.elapsedMs() << " ms" << std::endl;
+    }
 }
 
 // TODO: Change this so it renders the nine zones of generated
 // terrain that surround the player (refer to Terrain::m_generatedTerrain
 // for more info)
-void MyGL::renderTerrain(ShaderProgram* shader, bool isShadow) {
+void MyGL::renderTerrain(ShaderProgram* shader, const glm::mat4 &viewProj, bool isShadow) {
     int xFloor = static_cast<int>(glm::floor(m_player.mcr_position.x / 16.f));
     int zFloor = static_cast<int>(glm::floor(m_player.mcr_position.z / 16.f));
     int x = 16 * xFloor;
     int z = 16 * zFloor;
 
-    m_terrain.draw(x - 64 * NUMZONETODRAW, x + 64 * NUMZONETODRAW, z - 64 * NUMZONETODRAW, z + 64 * NUMZONETODRAW, shader, isShadow);
+    int r = 64 * m_terrain.drawRadius();
+    m_terrain.draw(x - r, x + r, z - r, z + r,
+                   viewProj, m_player.mcr_camera.mcr_position, shader, isShadow);
 }
 
 void MyGL::performPostprocessRenderPass() {
-    glBindFramebuffer(GL_FRAMEBUFFER, this->defaultFramebufferObject());
+    glBindFramebuffer(GL_FRAMEBUFFER, targetFramebuffer());
     glViewport(0, 0, this->width() * this->devicePixelRatio(), this->height() * this->devicePixelRatio());
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     postFrameBuffer.bindToTextureSlot(1);
@@ -319,17 +513,49 @@ void MyGL::keyPressEvent(QKeyEvent *e) {
     } else if (e->key() == Qt::Key_P) {
         m_timeStep = 60.f / m_timeStep;
     } else if (e->key() == Qt::Key_M){
-        m_player.toggleFirstPersonOnOff();
+        m_pendingActions |= ACTION_TOGGLE_VIEW;
     } else if (e->key() == Qt::Key_F1){
-        m_player.playEmote(2);
+        m_pendingEmote = 2;
     } else if (e->key() == Qt::Key_F2){
-        m_player.playEmote(3);
+        m_pendingEmote = 3;
     } else if (e->key() == Qt::Key_F3){
-        m_player.playEmote(4);
+        m_pendingEmote = 4;
     } else if (e->key() == Qt::Key_F4){
-        m_player.playEmote(5);
+        m_pendingEmote = 5;
     } else if (e->key() == Qt::Key_F5){
-        m_player.playEmote(6);
+        m_pendingEmote = 6;
+    } else if (e->key() == Qt::Key_O){
+        m_terrain.setOcclusionCulling(!m_terrain.occlusionCulling());
+        std::cout << "Occlusion culling " << (m_terrain.occlusionCulling() ? "on" : "off") << std::endl;
+    } else if (e->key() == Qt::Key_L){
+        m_terrain.setDepthOcclusion(!m_terrain.depthOcclusion());
+        std::cout << "Occluder depth buffer " << (m_terrain.depthOcclusion() ? "on" : "off") << std::endl;
+    } else if (e->key() == Qt::Key_K){
+        m_terrain.setLODEnabled(!m_terrain.lodEnabled());
+        std::cout << "Distant terrain " << (m_terrain.lodEnabled() ? "on" : "off") << std::endl;
+    } else if (e->key() == Qt::Key_V){
+        m_viewDistance.setEnabled(!m_viewDistance.enabled());
+        std::cout << "Adaptive view distance " << (m_viewDistance.enabled() ? "on" : "off") << std::endl;
+    } else if (e->key() == Qt::Key_T){
+        // Starts tracing, or writes out what was traced and stops
+        if (!Tracer::enabled()) {
+            Tracer::setEnabled(true);
+            std::cout << "Tracing" << std::endl;
+        } else {
+            std::string path = m_tracePath.empty() ? TRACEDEFAULTPATH : m_tracePath;
+            Tracer::setEnabled(false);
+            if (Tracer::write(path)) {
+                std::cout << "Trace written to " << path << std::endl;
+            }
+        }
+    } else if (e->key() == Qt::Key_H){
+        if (m_terrain.pipelineLatency().writeCSV(LATENCYCSVPATH)) {
+            std::cout << "Chunk latency histograms written to " << LATENCYCSVPATH << std::endl;
+        }
+    } else if (e->key() == Qt::Key_C){
+        if (profiler().writeCSV(PROFILECSVPATH)) {
+            std::cout << "Frame profile written to " << PROFILECSVPATH << std::endl;
+        }
     }
 }
 
@@ -365,45 +591,74 @@ void MyGL::mouseMoveEvent(QMouseEvent *e) {
 void MyGL::mousePressEvent(QMouseEvent *e) {
     // TODO
     if (e->button() == Qt::LeftButton){
-        m_player.removeBlock();
+        m_pendingActions |= ACTION_REMOVE_BLOCK;
     }else if (e->button() == Qt::RightButton){
-        m_player.addBlock();
+        m_pendingActions |= ACTION_ADD_BLOCK;
     }
 }
 
 void MyGL::loadProcessShader() {
+    // Without GL_KHR_parallel_shader_compile (or its ARB twin) a driver
+    // may still compile in the background, but need not
+    QOpenGLContext *ctx = QOpenGLContext::currentContext();
+    const std::pair<const char*, const char*> parallelCompile[] = {
+        {"GL_KHR_parallel_shader_compile", "glMaxShaderCompilerThreadsKHR"},
+        {"GL_ARB_parallel_shader_compile", "glMaxShaderCompilerThreadsARB"}
+    };
+    for (const auto &p : parallelCompile) {
+        if (!ctx->hasExtension(QByteArray(p.first))) {
+            continue;
+        }
+        typedef void (QOPENGLF_APIENTRYP MaxShaderCompilerThreads)(GLuint);
+        MaxShaderCompilerThreads maxThreads = reinterpret_cast<MaxShaderCompilerThreads>(ctx->getProcAddress(p.second));
+        if (maxThreads) {
+            // As many threads as the driver likes
+            maxThreads(0xFFFFFFFF);
+            break;
+        }
+    }
+
     // render shaders
     // Create and set up the diffuse shader
-    m_progLambert.create(":/glsl/lambert.vert.glsl", ":/glsl/lambert.frag.glsl");
+    m_progLambert.compile(":/glsl/lambert.vert.glsl", ":/glsl/lambert.frag.glsl");
     // Create and set up the flat lighting shader
-    m_progFlat.create(":/glsl/flat.vert.glsl", ":/glsl/flat.frag.glsl");
+    m_progFlat.compile(":/glsl/flat.vert.glsl", ":/glsl/flat.frag.glsl");
     //m_progInstanced.create(":/glsl/instanced.vert.glsl", ":/glsl/lambert.frag.glsl");
     // skybox shader
-    m_progSky.create(":/glsl/sky.vert.glsl", ":/glsl/sky.frag.glsl");
+    m_progSky.compile(":/glsl/sky.vert.glsl", ":/glsl/sky.frag.glsl");
     // shadow map shader
-    m_progShadow.create(":/glsl/shadow.vert.glsl", ":/glsl/shadow.frag.glsl");
-    m_progPlayer.create(":/glsl/player.vert.glsl", ":/glsl/player.frag.glsl");
+    m_progShadow.compile(":/glsl/shadow.vert.glsl", ":/glsl/shadow.frag.glsl");
+    m_progPlayer.compile(":/glsl/player.vert.glsl", ":/glsl/player.frag.glsl");
 
     // post-process shaders
     std::shared_ptr<PostProcessShader> noOp = std::make_shared<PostProcessShader>(this);
-    noOp->create(":/glsl/passthrough.vert.glsl", ":/glsl/noOp.frag.glsl");
+    noOp->compile(":/glsl/passthrough.vert.glsl", ":/glsl/noOp.frag.glsl");
     m_postprocessShaders.push_back(noOp);
 
     std::shared_ptr<PostProcessShader> water = std::make_shared<PostProcessShader>(this);
-    water->create(":/glsl/passthrough.vert.glsl", ":/glsl/water.frag.glsl");
+    water->compile(":/glsl/passthrough.vert.glsl", ":/glsl/water.frag.glsl");
     m_postprocessShaders.push_back(water);
 
     std::shared_ptr<PostProcessShader> lava = std::make_shared<PostProcessShader>(this);
-    lava->create(":/glsl/passthrough.vert.glsl", ":/glsl/lava.frag.glsl");
+    lava->compile(":/glsl/passthrough.vert.glsl", ":/glsl/lava.frag.glsl");
     m_postprocessShaders.push_back(lava);
 
     std::shared_ptr<PostProcessShader> sobel = std::make_shared<PostProcessShader>(this);
-    sobel->create(":/glsl/passthrough.vert.glsl", ":/glsl/sobel.frag.glsl");
+    sobel->compile(":/glsl/passthrough.vert.glsl", ":/glsl/sobel.frag.glsl");
     m_postprocessShaders.push_back(sobel);
 
     mp_progPostprocessCurrent = noOp.get();
 }
 
+void MyGL::finishShaders() {
+    for (ShaderProgram *p : {&m_progLambert, &m_progFlat, &m_progSky, &m_progShadow, &m_progPlayer}) {
+        p->finishCreate();
+    }
+    for (const std::shared_ptr<PostProcessShader> &p : m_postprocessShaders) {
+        p->finishCreate();
+    }
+}
+
 void MyGL::setCurPostProcessShader() {
     glm::vec3 pos = m_player.mcr_camera.mcr_position;
     if (!m_terrain.hasChunkAt(pos[0], pos[2])) {
@@ -427,22 +682,72 @@ void MyGL::setCurPostProcessShader() {
     }
 }
 
+void MyGL::updateFrameUniforms() {
+    glm::vec3 sunDir = glm::normalize(getSunLocation());
+    glm::vec2 pPos(m_player.mcr_position.x, m_player.mcr_position.z);
+    glm::ivec2 drawOrigin(16 * glm::ivec2(glm::floor(pPos / 16.f)));
+    // Shadows reach about as far as the full-detail Chunks do
+    float shadowDistance = 64.f * (m_terrain.drawRadius() + 0.5f);
+    m_shadowCascades.update(m_player.mcr_camera, m_player.mcr_camera.mcr_position, sunDir, shadowDistance,
+                            drawOrigin, m_terrain);
+
+    FrameUniforms &frame = uniforms().frame();
+    glm::mat4 viewproj = m_player.mcr_camera.getViewProj();
+    frame.viewProj = viewproj;
+    frame.invViewProj = glm::inverse(viewproj);
+    for (int i = 0; i < SHADOWCASCADES; i++) {
+        frame.cascadeViewProj[i] = m_shadowCascades.cascade(i).viewProj;
+    }
+    frame.cascadeSplits = m_shadowCascades.splits();
+    frame.cameraPos = m_player.mcr_camera.mcr_position;
+    frame.time = m_shaderTime;
+    frame.timeElapsed = m_timeElapsed;
+    frame.dimensions = glm::ivec2(width(), height());
+    // Push the fog out to the edge of the distant terrain when it is drawn
+    if (m_terrain.lod() && m_terrain.lodEnabled()) {
+        float radius = m_terrain.lod()->radiusBlocks();
+        frame.fogRange = glm::vec2(0.7f * radius, radius);
+    } else {
+        frame.fogRange = glm::vec2(75.f, 100.f) * float(m_terrain.drawRadius());
+    }
+    uniforms().uploadFrame();
+}
+
 void MyGL::depthRendering() {
+    // The lambert shader ignores the shadow map at night
+    float time = glm::mod(m_timeElapsed, 216000.f) / 216000.f;
+    if (time >= 0.25f && time <= 0.75f) {
+        return;
+    }
+
     depthFrameBuffer.bindFrameBuffer();
-    glViewport(0, 0, 1024, 1024);
-    depthFrameBuffer.clearFramebuffer();
-    glm::mat4 depthProjectionMatrix = glm::ortho<float>(-1000,1000,-1000,1000,300,10000);
-    glm::mat4 depthViewMatrix = glm::lookAt(getSunLocation(), glm::vec3(0.f, 0.f, 0.f), glm::vec3(0.f, 1.f, 0.f));
-    glm::mat4 depthViewProj = depthProjectionMatrix * depthViewMatrix;
-    sunViewProj = depthViewProj;
-    m_progShadow.setViewProjMatrix(depthViewProj);
-    m_progShadow.setModelMatrix(glm::mat4());
-    renderTerrain(&m_progShadow, true);
-    renderThirdPersonPlayerShadow(&m_progShadow);
+    glEnable(GL_SCISSOR_TEST);
+    for (int i = 0; i < SHADOWCASCADES; i++) {
+        const ShadowCascade &cascade = m_shadowCascades.cascade(i);
+        if (!cascade.render) {
+            continue;
+        }
+        QElapsedTimer cascadeTimer;
+        cascadeTimer.start();
+        // Only this cascade's tile of the atlas is cleared and drawn to
+        glm::ivec2 offset = ShadowCascades::atlasOffset(i);
+        glViewport(offset.x, offset.y, SHADOWMAPSIZE, SHADOWMAPSIZE);
+        glScissor(offset.x, offset.y, SHADOWMAPSIZE, SHADOWMAPSIZE);
+        glClear(GL_DEPTH_BUFFER_BIT);
+        uniforms().setCascade(i);
+        m_progShadow.setModelMatrix(glm::mat4());
+        renderTerrain(&m_progShadow, cascade.viewProj, true);
+        // The player moves every frame, so it would keep cached cascades stale
+        if (i < FIRSTCACHEDCASCADE) {
+            renderThirdPersonPlayerShadow(&m_progShadow);
+        }
+        m_shadowCascades.rendered(i, cascadeTimer.nsecsElapsed() / 1e6f);
+    }
+    glDisable(GL_SCISSOR_TEST);
 }
 
 void MyGL::setDepthFrameBufferTexture() {
-    glBindFramebuffer(GL_FRAMEBUFFER, this->defaultFramebufferObject());
+    glBindFramebuffer(GL_FRAMEBUFFER, targetFramebuffer());
     glViewport(0, 0, this->width() * this->devicePixelRatio(), this->height() * this->devicePixelRatio());
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     depthFrameBuffer.bindToTextureSlot(1);
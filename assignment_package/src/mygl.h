@@ -22,11 +22,24 @@
 
 #include "scene/blockdisplay.h"
 #include "scene/playerdisplay.h"
+#include "viewdistancecontroller.h"
+#include "shadowcascades.h"
+#include "inputrecording.h"
+#include "objstatue.h"
+#include "startuptimings.h"
 
 class MyGL : public OpenGLContext
 {
     Q_OBJECT
 private:
+    // False when a RenderBenchmark drives frames instead of the timer
+    // and the player: nothing is saved and the mouse is left alone
+    bool m_interactive;
+    // Where the trace is written on exit, if MINIMINECRAFT_TRACE was set
+    std::string m_tracePath;
+    // Logs every tick's input if MINIMINECRAFT_RECORD was set; see
+    // RenderBenchmark for replaying it
+    InputRecorder m_recorder;
     WorldAxes m_worldAxes; // A wireframe representation of the world axes. It is hard-coded to sit centered at (32, 128, 32).
     ShaderProgram m_progLambert;// A shader program that uses lambertian reflection
     ShaderProgram m_progFlat;// A shader program that uses "flat" reflection (no shadowing at all)
@@ -41,16 +54,30 @@ private:
     Terrain m_terrain; // All of the Chunks that currently comprise the world.
     Player m_player; // The entity controlled by the user. Contains a camera to display what it sees as well.
     InputBundle m_inputs; // A collection of variables to be updated in keyPressEvent, mouseMoveEvent, mousePressEvent, etc.
+    // PlayerAction flags and emote taken since the last tick
+    uint8_t m_pendingActions;
+    int m_pendingEmote;
     QTimer m_timer; // Timer linked to tick(). Fires approximately 60 times per second.
     quint64 m_time;
     int m_shaderTime;
     float m_timeElapsed;
     float m_timeStep;
+    // Adapts the Terrain's draw and work radius to the frame time
+    ViewDistanceController m_viewDistance;
+    // CPU time of the last paintGL, in milliseconds
+    float m_paintMs;
+    // Bit per MemoryCategory that was over its budget at the last check
+    int m_overBudget;
+    // Logged once the zones around the spawn point are all meshed
+    StartupTimings m_startup;
+    // Voxelized while the game starts, placed once its zones are meshed
+    OBJStatue m_statue;
 
     uPtr<Texture> m_texture;
     FrameBuffer postFrameBuffer;
     FrameBuffer depthFrameBuffer;
-    glm::mat4 sunViewProj;
+    // Which shadow cascades depthRendering redraws into depthFrameBuffer
+    ShadowCascades m_shadowCascades;
     std::vector<std::shared_ptr<PostProcessShader>> m_postprocessShaders;
     PostProcessShader* mp_progPostprocessCurrent;
     Quad quad;
@@ -59,13 +86,33 @@ private:
                               // your mouse stays within the screen bounds and is always read.
 
     void sendPlayerDataToGUI() const;
+    // Prints a line whenever a MemoryCategory goes over its budget or
+    // back under it
+    void checkMemoryBudgets();
+    // Logs the StartupTimings once no zone is pending any more
+    void checkStartup();
+    // Applies one tick of player input: the actions first, as if they
+    // had happened between ticks, then the InputBundle, which the
+    // Player consumes, then deltaMs of physics
+    void stepPlayer(InputBundle &inputs, uint8_t actions, int emote, int deltaMs);
+    // Starts generating the zones the player approaches and uploads
+    // finished Chunk meshes and LOD tiles. Returns how many Chunks were
+    // waiting to be meshed or uploaded.
+    int streamTerrain();
     void performPostprocessRenderPass();
+    // Hands every shader program to the driver to compile;
+    // finishShaders waits for them
     void loadProcessShader();
+    void finishShaders();
     void setCurPostProcessShader();
+    // Fits the shadow cascades and uploads the FrameUniforms block
+    // every shader program reads the camera, sun, time and fog from
+    void updateFrameUniforms();
     void depthRendering();
     void setDepthFrameBufferTexture();
     glm::vec3 getSunLocation();
 
+    // Starts voxelizing the statue; streamTerrain places it
     void createVoxels();
     void renderThirdPersonPlayer();
     void renderThirdPersonPlayerShadow(ShaderProgram *shader);
@@ -74,7 +121,7 @@ private:
     PlayerDisplay m_displayedPlayer;
 
 public:
-    explicit MyGL(QWidget *parent = nullptr);
+    explicit MyGL(QWidget *parent = nullptr, bool interactive = true);
     ~MyGL();
 
     // Called once when MyGL is initialized.
@@ -90,7 +137,7 @@ public:
 
     // Called from paintGL().
     // Calls Terrain::draw().
-    void renderTerrain(ShaderProgram* shader, bool isShadow);
+    void renderTerrain(ShaderProgram* shader, const glm::mat4 &viewProj, bool isShadow);
 
 protected:
     // Automatically invoked when the user
@@ -104,6 +151,8 @@ protected:
     // presses a mouse button
     void mousePressEvent(QMouseEvent *e);
 
+    friend class RenderBenchmark;
+
 private slots:
     void tick(); // Slot that gets called ~60 times per second by m_timer firing.
 
@@ -114,6 +163,12 @@ signals:
     void sig_sendPlayerLook(QString) const;
     void sig_sendPlayerChunk(QString) const;
     void sig_sendPlayerTerrainZone(QString) const;
+    void sig_sendRenderStats(QString) const;
+    void sig_sendViewDistance(QString) const;
+    void sig_sendShadowStats(QString) const;
+    void sig_sendFrameProfile(QString) const;
+    void sig_sendChunkLatency(QString) const;
+    void sig_sendMemoryStats(QString) const;
 };
 
 
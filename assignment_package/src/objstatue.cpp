@@ -0,0 +1,52 @@
+#include "objstatue.h"
+#include "scene/terrain.h"
+#include "trace.h"
+#include <chrono>
+
+OBJStatue::OBJStatue()
+    : m_voxelizing(), m_voxels(), m_zones(), m_voxelized(false), m_placed(false)
+{}
+
+void OBJStatue::startVoxelizing(const char* filename, glm::vec3 initialPos) {
+    m_voxelizing = std::async(std::launch::async, [filename, initialPos]() {
+        TRACE_SCOPE("voxelize OBJ");
+        return voxelizeOBJ(filename, initialPos);
+    });
+}
+
+void OBJStatue::place(Terrain *t, bool wait) {
+    if (m_placed || (!m_voxelizing.valid() && !m_voxelized)) {
+        return;
+    }
+    if (!m_voxelized) {
+        if (!wait && m_voxelizing.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            return;
+        }
+        m_voxels = m_voxelizing.get();
+        for (const glm::ivec3 &v : m_voxels) {
+            m_zones.insert(toZoneKey(v.x, v.z));
+        }
+        m_voxelized = true;
+    }
+    for (int64_t zone : m_zones) {
+        if (!t->isZoneMeshed(zone)) {
+            return;
+        }
+    }
+
+    std::set<Chunk*> chunks;
+    for (const glm::ivec3 &v : m_voxels) {
+        chunks.insert(t->getChunkAt(v.x, v.z).get());
+        t->setBlockAt(v.x, v.y, v.z, DUNE);
+    }
+    for (Chunk *c : chunks) {
+        t->remeshChunk(c);
+    }
+    m_voxels.clear();
+    m_voxels.shrink_to_fit();
+    m_placed = true;
+}
+
+bool OBJStatue::isPlaced() const {
+    return m_placed;
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include "meshVoxelizer.h"
+#include <future>
+#include <set>
+
+class Terrain;
+
+// An OBJ mesh built out of DUNE blocks. It is voxelized on a thread of
+// its own, and the blocks are only set once every zone they fall in
+// has been generated and meshed, so that neither generation nor a
+// worker's mesh can lose them.
+class OBJStatue {
+private:
+    std::future<std::vector<glm::ivec3>> m_voxelizing;
+    std::vector<glm::ivec3> m_voxels;
+    // Zone keys the voxels fall in
+    std::set<int64_t> m_zones;
+    bool m_voxelized;
+    bool m_placed;
+
+public:
+    OBJStatue();
+
+    void startVoxelizing(const char* filename, glm::vec3 initialPos);
+    // Sets the blocks and remeshes their Chunks if the voxels and their
+    // zones are ready. With wait set it first waits for the voxels.
+    // Only call from the GL thread.
+    void place(Terrain *t, bool wait);
+    // Whether the blocks are set, or there turned out to be none
+    bool isPlaced() const;
+};
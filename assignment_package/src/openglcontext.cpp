@@ -8,12 +8,40 @@
 
 
 OpenGLContext::OpenGLContext(QWidget *parent)
-    : QOpenGLWidget(parent)
+    : QOpenGLWidget(parent), m_glState(this), m_uniforms(this, &m_glState), m_profiler(this), m_offscreenFramebuffer(0)
 {}
 
 OpenGLContext::~OpenGLContext()
 {}
 
+GLStateCache &OpenGLContext::glState() {
+    return m_glState;
+}
+
+const GLStateCache &OpenGLContext::glState() const {
+    return m_glState;
+}
+
+UniformBlocks &OpenGLContext::uniforms() {
+    return m_uniforms;
+}
+
+FrameProfiler &OpenGLContext::profiler() {
+    return m_profiler;
+}
+
+const FrameProfiler &OpenGLContext::profiler() const {
+    return m_profiler;
+}
+
+GLuint OpenGLContext::targetFramebuffer() const {
+    return m_offscreenFramebuffer != 0 ? m_offscreenFramebuffer : defaultFramebufferObject();
+}
+
+void OpenGLContext::setTargetFramebuffer(GLuint framebuffer) {
+    m_offscreenFramebuffer = framebuffer;
+}
+
 inline const char *glGS(GLenum e)
 {
     return reinterpret_cast<const char *>(glGetString(e));
@@ -21,7 +49,8 @@ inline const char *glGS(GLenum e)
 
 void OpenGLContext::debugContextVersion()
 {
-    QOpenGLContext *ctx = context();
+    // The widget has no context of its own when rendering offscreen
+    QOpenGLContext *ctx = QOpenGLContext::currentContext();
     QSurfaceFormat form = format();
     QSurfaceFormat ctxform = ctx->format();
     QSurfaceFormat::OpenGLContextProfile prof = ctxform.profile();
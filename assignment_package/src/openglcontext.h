@@ -3,6 +3,9 @@
 #include <QOpenGLWidget>
 #include <QTimer>
 #include <QOpenGLExtraFunctions>
+#include "glstatecache.h"
+#include "uniformblocks.h"
+#include "frameprofiler.h"
 
 
 class OpenGLContext
@@ -18,4 +21,25 @@ public:
     void printGLErrorLog();
     void printLinkInfoLog(int prog);
     void printShaderInfoLog(int shader);
+
+    // Skips redundant binds; see GLStateCache
+    GLStateCache &glState();
+    const GLStateCache &glState() const;
+    // Uniform blocks shared by every ShaderProgram; see UniformBlocks
+    UniformBlocks &uniforms();
+    // Per-stage CPU and GPU frame timings; see FrameProfiler
+    FrameProfiler &profiler();
+    const FrameProfiler &profiler() const;
+
+    // The framebuffer finished frames go to: the widget's own, unless
+    // an offscreen one was set for rendering without a window
+    GLuint targetFramebuffer() const;
+    // Pass 0 to go back to the widget's framebuffer
+    void setTargetFramebuffer(GLuint framebuffer);
+
+private:
+    GLStateCache m_glState;
+    UniformBlocks m_uniforms;
+    FrameProfiler m_profiler;
+    GLuint m_offscreenFramebuffer;
 };
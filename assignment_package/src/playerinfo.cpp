@@ -36,3 +36,27 @@ void PlayerInfo::slot_setZoneText(QString s) {
     ui->zoneLabel->setText(s);
 }
 
+void PlayerInfo::slot_setRenderText(QString s) {
+    ui->renderLabel->setText(s);
+}
+
+void PlayerInfo::slot_setViewDistanceText(QString s) {
+    ui->viewDistanceLabel->setText(s);
+}
+
+void PlayerInfo::slot_setShadowText(QString s) {
+    ui->shadowLabel->setText(s);
+}
+
+void PlayerInfo::slot_setProfileText(QString s) {
+    ui->profileLabel->setText(s);
+}
+
+void PlayerInfo::slot_setLatencyText(QString s) {
+    ui->latencyLabel->setText(s);
+}
+
+void PlayerInfo::slot_setMemoryText(QString s) {
+    ui->memoryLabel->setText(s);
+}
+
@@ -20,6 +20,12 @@ public slots:
     void slot_setLookText(QString);
     void slot_setChunkText(QString);
     void slot_setZoneText(QString);
+    void slot_setRenderText(QString);
+    void slot_setViewDistanceText(QString);
+    void slot_setShadowText(QString);
+    void slot_setProfileText(QString);
+    void slot_setLatencyText(QString);
+    void slot_setMemoryText(QString);
 
 private:
     Ui::PlayerInfo *ui;
@@ -12,6 +12,11 @@ PostProcessShader::~PostProcessShader()
 {}
 
 void PostProcessShader::create(const char *vertfile, const char *fragfile) {
+    compile(vertfile, fragfile);
+    finishCreate();
+}
+
+void PostProcessShader::compile(const char *vertfile, const char *fragfile) {
     // Allocate space on our GPU for a vertex shader and a fragment shader and a shader program to manage the two
     vertShader = context->glCreateShader(GL_VERTEX_SHADER);
     fragShader = context->glCreateShader(GL_FRAGMENT_SHADER);
@@ -32,6 +37,17 @@ void PostProcessShader::create(const char *vertfile, const char *fragfile) {
     // Tell OpenGL to compile the shader text stored above
     context->glCompileShader(vertShader);
     context->glCompileShader(fragShader);
+
+    // Tell prog that it manages these particular vertex and fragment shaders
+    context->glAttachShader(prog, vertShader);
+    context->glAttachShader(prog, fragShader);
+    // Same locations as ShaderProgram, so the Quad's VAO works with both
+    context->glBindAttribLocation(prog, ATTR_LOC_POS, "vs_Pos");
+    context->glBindAttribLocation(prog, ATTR_LOC_UV, "vs_UV");
+    context->glLinkProgram(prog);
+}
+
+void PostProcessShader::finishCreate() {
     // Check if everything compiled OK
     GLint compiled;
     context->glGetShaderiv(vertShader, GL_COMPILE_STATUS, &compiled);
@@ -43,11 +59,6 @@ void PostProcessShader::create(const char *vertfile, const char *fragfile) {
         printShaderInfoLog(fragShader);
     }
 
-    // Tell prog that it manages these particular vertex and fragment shaders
-    context->glAttachShader(prog, vertShader);
-    context->glAttachShader(prog, fragShader);
-    context->glLinkProgram(prog);
-
     // Check for linking success
     GLint linked;
     context->glGetProgramiv(prog, GL_LINK_STATUS, &linked);
@@ -64,7 +75,7 @@ void PostProcessShader::create(const char *vertfile, const char *fragfile) {
 }
 
 void PostProcessShader::useMe() {
-    context->glUseProgram(prog);
+    context->glState().useProgram(prog);
 }
 
 void PostProcessShader::setTime(int t) {
@@ -83,27 +94,9 @@ void PostProcessShader::draw(Drawable& d, int textureSlot = 0)
     // Set our "renderedTexture" sampler to user Texture Unit 0
     context->glUniform1i(unifSampler2D, textureSlot);
 
-    // Each of the following blocks checks that:
-    //   * This shader has this attribute, and
-    //   * This Drawable has a vertex buffer for this attribute.
-    // If so, it binds the appropriate buffers to each attribute.
-
-    if (attrPos != -1 && d.bindPos()) {
-        context->glEnableVertexAttribArray(attrPos);
-        context->glVertexAttribPointer(attrPos, 4, GL_FLOAT, false, 0, nullptr);
-    }
-    if (attrUV != -1 && d.bindUV()) {
-        context->glEnableVertexAttribArray(attrUV);
-        context->glVertexAttribPointer(attrUV, 2, GL_FLOAT, false, 0, nullptr);
-    }
-
-    // Bind the index buffer and then draw shapes from it.
-    // This invokes the shader program, which accesses the vertex buffers.
-    d.bindIdx();
+    d.bindVAO(LAYOUT_SEPARATE);
     context->glDrawElements(d.drawMode(), d.elemCount(), GL_UNSIGNED_INT, 0);
-
-    if (attrPos != -1) context->glDisableVertexAttribArray(attrPos);
-    if (attrUV != -1) context->glDisableVertexAttribArray(attrUV);
+    context->glState().countDraws(1, d.elemCount() / 3);
 
     context->printGLErrorLog();
 }
@@ -22,6 +22,9 @@ public:
 
     // Sets up the requisite GL data and shaders from the given .glsl files
     void create(const char *vertfile, const char *fragfile);
+    // create() in two halves, as in ShaderProgram
+    void compile(const char *vertfile, const char *fragfile);
+    void finishCreate();
     // Tells our OpenGL context to use this shader to draw things
     void useMe();
     // Draw the given object to our screen using this ShaderProgram's shaders
@@ -0,0 +1,310 @@
+#include "renderbenchmark.h"
+#include "mygl.h"
+#include "scene/lodterrain.h"
+#include "memorystats.h"
+#include <QElapsedTimer>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QThreadPool>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+// Passes of the chunk pipeline allowed per frame before the frame is
+// drawn with whatever has arrived
+#define BENCHMAXSTREAMPASSES 200
+// Time of day the benchmark is drawn at, in ticks of a 216000 tick day
+#define BENCHTIMEOFDAY 21600.f
+
+namespace {
+
+// Camera path control points: a loop of about 100 blocks radius around
+// the spawn point, rising and falling over the terrain
+const std::array<glm::vec3, 8> pathPoints = {
+    glm::vec3(213.f, 165.f, 197.f), glm::vec3(185.f, 172.f, 265.f),
+    glm::vec3(117.f, 158.f, 290.f), glm::vec3(50.f, 150.f, 262.f),
+    glm::vec3(25.f, 168.f, 197.f), glm::vec3(52.f, 175.f, 130.f),
+    glm::vec3(117.f, 160.f, 105.f), glm::vec3(185.f, 152.f, 128.f)
+};
+
+glm::vec3 catmullRom(glm::vec3 p0, glm::vec3 p1, glm::vec3 p2, glm::vec3 p3, float u) {
+    return 0.5f * (2.f * p1 + (p2 - p0) * u
+                   + (2.f * p0 - 5.f * p1 + 4.f * p2 - p3) * u * u
+                   + (3.f * p1 - p0 - 3.f * p2 + p3) * u * u * u);
+}
+
+struct Summary {
+    double mean, p50, p90, p99, max;
+};
+
+Summary summarize(std::vector<double> values) {
+    Summary s = {0, 0, 0, 0, 0};
+    if (values.empty()) {
+        return s;
+    }
+    std::sort(values.begin(), values.end());
+    for (double v : values) {
+        s.mean += v;
+    }
+    s.mean /= values.size();
+    // Nearest rank
+    auto percentile = [&values](double p) {
+        size_t rank = static_cast<size_t>(std::ceil(p * values.size()));
+        return values[std::min(values.size(), std::max<size_t>(rank, 1)) - 1];
+    };
+    s.p50 = percentile(0.5);
+    s.p90 = percentile(0.9);
+    s.p99 = percentile(0.99);
+    s.max = values.back();
+    return s;
+}
+
+void writeSummary(std::ostream &out, const char *name, const Summary &s) {
+    out << "    \"" << name << "\": {\"mean\": " << s.mean << ", \"p50\": " << s.p50
+        << ", \"p90\": " << s.p90 << ", \"p99\": " << s.p99 << ", \"max\": " << s.max << "}";
+}
+
+std::string jsonEscape(const std::string &s) {
+    std::string escaped;
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+        }
+        if (static_cast<unsigned char>(c) >= 0x20) {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+}
+
+RenderBenchmark::RenderBenchmark(const RenderBenchmarkOptions &options)
+    : m_options(options), m_frames(), m_replay(), m_firstDivergentTick(-1), m_renderer(), m_drawRadius(0)
+{}
+
+glm::vec3 RenderBenchmark::pathPosition(float t) {
+    int n = static_cast<int>(pathPoints.size());
+    float f = t * n;
+    int i = static_cast<int>(std::floor(f));
+    float u = f - i;
+    auto at = [n](int k) { return pathPoints[((k % n) + n) % n]; };
+    return catmullRom(at(i - 1), at(i), at(i + 1), at(i + 2), u);
+}
+
+glm::vec3 RenderBenchmark::pathDirection(float t) {
+    glm::vec3 tangent = pathPosition(t + 0.001f) - pathPosition(t);
+    tangent.y = 0.f;
+    // Look slightly down so that the view is mostly terrain
+    return glm::normalize(glm::normalize(tangent) + glm::vec3(0.f, -0.3f, 0.f));
+}
+
+int RenderBenchmark::run() {
+    bool replay = !m_options.replayPath.empty();
+    if (replay) {
+        if (!loadInputRecording(m_options.replayPath, &m_replay) || m_replay.empty()) {
+            std::cerr << "bench-render: could not read the recording " << m_options.replayPath << std::endl;
+            return 1;
+        }
+        m_options.frames = static_cast<int>(m_replay.size());
+        m_options.warmupFrames = std::min(m_options.warmupFrames, m_options.frames - 1);
+    }
+
+    QOpenGLContext context;
+    context.setFormat(QSurfaceFormat::defaultFormat());
+    if (!context.create()) {
+        std::cerr << "bench-render: could not create an OpenGL context" << std::endl;
+        return 1;
+    }
+    QOffscreenSurface surface;
+    surface.setFormat(context.format());
+    surface.create();
+    if (!surface.isValid() || !context.makeCurrent(&surface)) {
+        std::cerr << "bench-render: could not make the offscreen surface current" << std::endl;
+        return 1;
+    }
+    QOpenGLExtraFunctions *gl = context.extraFunctions();
+    int w = m_options.width, h = m_options.height;
+
+    // Stands in for the window's default framebuffer
+    GLuint framebuffer, color, depth;
+    gl->glGenFramebuffers(1, &framebuffer);
+    gl->glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    gl->glGenRenderbuffers(1, &color);
+    gl->glBindRenderbuffer(GL_RENDERBUFFER, color);
+    gl->glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, w, h);
+    gl->glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+    gl->glGenRenderbuffers(1, &depth);
+    gl->glBindRenderbuffer(GL_RENDERBUFFER, depth);
+    gl->glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, w, h);
+    gl->glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+    if (gl->glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "bench-render: offscreen framebuffer is incomplete" << std::endl;
+        return 1;
+    }
+    m_renderer = reinterpret_cast<const char *>(gl->glGetString(GL_RENDERER));
+
+    // A 32-bit result wraps after 4.3 seconds of GPU time. The 64-bit
+    // getter is core since GL 3.3 but QOpenGLExtraFunctions lacks it.
+    typedef void (QOPENGLF_APIENTRYP GetQueryObjectui64v)(GLuint, GLenum, GLuint64*);
+    GetQueryObjectui64v getQueryObjectui64v = reinterpret_cast<GetQueryObjectui64v>(
+                context.getProcAddress("glGetQueryObjectui64v"));
+    if (!getQueryObjectui64v) {
+        std::cerr << "bench-render: the context has no glGetQueryObjectui64v" << std::endl;
+        return 1;
+    }
+    GLuint query;
+    gl->glGenQueries(1, &query);
+
+    {
+        MyGL mygl(nullptr, false);
+        mygl.resize(w, h);
+        mygl.setTargetFramebuffer(framebuffer);
+        mygl.initializeGL();
+        mygl.resizeGL(w, h);
+        // Its per-stage queries cannot run inside the whole frame's query
+        mygl.profiler().setGpuTiming(false);
+        mygl.m_timeElapsed = BENCHTIMEOFDAY;
+        mygl.m_timeStep = 0.f;
+        m_drawRadius = mygl.m_viewDistance.radius();
+
+        // A replay's warmup is the start of the recording
+        int total = replay ? m_options.frames : m_options.warmupFrames + m_options.frames;
+        m_frames.clear();
+        m_frames.reserve(m_options.frames);
+        m_firstDivergentTick = -1;
+        for (int frame = 0; frame < total; frame++) {
+            float simMs = 0.f;
+            if (replay) {
+                InputFrame tick = m_replay[frame];
+                QElapsedTimer simTimer;
+                simTimer.start();
+                mygl.stepPlayer(tick.inputs, tick.actions, tick.emote,
+                                m_options.replayStepMs > 0 ? m_options.replayStepMs : tick.deltaMs);
+                simMs = simTimer.nsecsElapsed() / 1e6f;
+                if (m_firstDivergentTick < 0 && m_options.replayStepMs == 0
+                        && mygl.m_player.mcr_position != tick.position) {
+                    m_firstDivergentTick = frame;
+                }
+            } else {
+                float t = static_cast<float>(frame) / total;
+                mygl.m_player.setPose(pathPosition(t), pathDirection(t));
+            }
+
+            int64_t uploadBytes = mygl.glState().currentFrame().uploadBytes;
+            for (int pass = 0; pass < BENCHMAXSTREAMPASSES; pass++) {
+                int backlog = mygl.streamTerrain();
+                const LODTerrain *lod = mygl.m_terrain.lod();
+                if (backlog == 0 && mygl.m_terrain.pendingZoneCount() == 0 && (!lod || lod->pendingCount() == 0)) {
+                    break;
+                }
+                QThreadPool::globalInstance()->waitForDone();
+            }
+            uploadBytes = mygl.glState().currentFrame().uploadBytes - uploadBytes;
+
+            QElapsedTimer timer;
+            timer.start();
+            gl->glBeginQuery(GL_TIME_ELAPSED, query);
+            mygl.paintGL();
+            gl->glEndQuery(GL_TIME_ELAPSED);
+            float cpuMs = timer.nsecsElapsed() / 1e6f;
+            gl->glFinish();
+            GLuint64 gpuNs = 0;
+            getQueryObjectui64v(query, GL_QUERY_RESULT, &gpuNs);
+
+            if (frame < m_options.warmupFrames) {
+                continue;
+            }
+            const GLStateStats &stats = mygl.glState().currentFrame();
+            m_frames.push_back({simMs, cpuMs, gpuNs / 1e6f, stats.drawCalls, stats.triangles,
+                                uploadBytes + stats.uploadBytes});
+        }
+        QThreadPool::globalInstance()->waitForDone();
+    }
+
+    gl->glDeleteQueries(1, &query);
+    gl->glDeleteRenderbuffers(1, &color);
+    gl->glDeleteRenderbuffers(1, &depth);
+    gl->glDeleteFramebuffers(1, &framebuffer);
+    context.doneCurrent();
+
+    std::ofstream out(m_options.outPath);
+    if (!out) {
+        std::cerr << "bench-render: could not write " << m_options.outPath << std::endl;
+        return 1;
+    }
+    out << report();
+    std::cout << "bench-render: " << m_frames.size() << " frames written to " << m_options.outPath << std::endl;
+    if (m_firstDivergentTick >= 0) {
+        // The recording saw a different world, e.g. one whose Chunks
+        // had not all arrived yet where the player went
+        std::cout << "bench-render: the replay left the recorded path at tick " << m_firstDivergentTick << std::endl;
+    }
+    int status = 0;
+    for (int i = 0; i < MEMORYCATEGORIES; i++) {
+        MemoryCategory c = static_cast<MemoryCategory>(i);
+        if (MemoryStats::exceededBudget(c)) {
+            std::cerr << "bench-render: " << MemoryStats::categoryName(c) << " peaked over its memory budget" << std::endl;
+            status = 1;
+        }
+    }
+    return status;
+}
+
+std::string RenderBenchmark::report() const {
+    std::vector<double> sim, cpu, gpu, draws, triangles, uploads;
+    int64_t uploadTotal = 0;
+    for (const RenderBenchmarkFrame &f : m_frames) {
+        sim.push_back(f.simMs);
+        cpu.push_back(f.cpuMs);
+        gpu.push_back(f.gpuMs);
+        draws.push_back(f.drawCalls);
+        triangles.push_back(static_cast<double>(f.triangles));
+        uploads.push_back(static_cast<double>(f.uploadBytes));
+        uploadTotal += f.uploadBytes;
+    }
+
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(3);
+    out << "{\n";
+    out << "  \"frames\": " << m_frames.size() << ",\n";
+    out << "  \"warmupFrames\": " << m_options.warmupFrames << ",\n";
+    out << "  \"width\": " << m_options.width << ",\n";
+    out << "  \"height\": " << m_options.height << ",\n";
+    out << "  \"renderer\": \"" << jsonEscape(m_renderer) << "\",\n";
+    out << "  \"drawRadiusZones\": " << m_drawRadius << ",\n";
+    if (!m_replay.empty()) {
+        out << "  \"replay\": {\"path\": \"" << jsonEscape(m_options.replayPath) << "\", \"stepMs\": "
+            << m_options.replayStepMs << ", \"firstDivergentTick\": " << m_firstDivergentTick << "},\n";
+    }
+    out << "  \"perFrame\": {\n";
+    if (!m_replay.empty()) {
+        writeSummary(out, "simMs", summarize(sim));
+        out << ",\n";
+    }
+    writeSummary(out, "cpuMs", summarize(cpu));
+    out << ",\n";
+    writeSummary(out, "gpuMs", summarize(gpu));
+    out << ",\n";
+    writeSummary(out, "drawCalls", summarize(draws));
+    out << ",\n";
+    writeSummary(out, "triangles", summarize(triangles));
+    out << ",\n";
+    writeSummary(out, "uploadBytes", summarize(uploads));
+    out << "\n  },\n";
+    out << "  \"uploadBytesTotal\": " << uploadTotal << ",\n";
+    // Peaks over the whole run, in bytes; budgets of 0 are unset
+    out << "  \"memory\": {\n";
+    for (int i = 0; i < MEMORYCATEGORIES; i++) {
+        MemoryCategory c = static_cast<MemoryCategory>(i);
+        out << "    \"" << MemoryStats::categoryName(c) << "\": {\"peak\": " << MemoryStats::peak(c)
+            << ", \"budget\": " << MemoryStats::budget(c) << "}" << (i + 1 < MEMORYCATEGORIES ? "," : "") << "\n";
+    }
+    out << "  }\n";
+    out << "}\n";
+    return out.str();
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include "glm_includes.h"
+#include "inputrecording.h"
+#include <string>
+#include <vector>
+
+// What --bench-render was asked to do
+struct RenderBenchmarkOptions {
+    // Frames measured, after warmupFrames that are drawn but not measured
+    int frames;
+    int warmupFrames;
+    int width, height;
+    // Where the JSON report is written
+    std::string outPath;
+    // Input recording to replay instead of flying the camera path; each
+    // tick of it is one frame, and frames is ignored
+    std::string replayPath;
+    // Milliseconds every replayed tick advances by, or 0 for the
+    // recorded deltas
+    int replayStepMs;
+
+    RenderBenchmarkOptions()
+        : frames(600), warmupFrames(30), width(1280), height(720), outPath("bench_render.json"),
+          replayPath(), replayStepMs(0)
+    {}
+};
+
+// Measurements of one benchmark frame
+struct RenderBenchmarkFrame {
+    // Player input and physics, when replaying
+    float simMs;
+    float cpuMs;
+    float gpuMs;
+    int drawCalls;
+    int64_t triangles;
+    int64_t uploadBytes;
+};
+
+// Renders MyGL into an offscreen framebuffer along a fixed camera path
+// and reports how long frames took. Before each frame the chunk
+// pipeline is run until it is idle, so every run draws exactly the
+// same world from exactly the same viewpoints whatever the machine,
+// and the numbers only measure drawing. Nothing is loaded from or
+// saved to disk and the time of day is held still.
+//
+// With a replay, the player is driven by a recording made with
+// MINIMINECRAFT_RECORD instead, one recorded tick per frame with no
+// regard for the clock, so the same session of flying, digging and
+// building plays out identically on every run.
+class RenderBenchmark {
+private:
+    RenderBenchmarkOptions m_options;
+    std::vector<RenderBenchmarkFrame> m_frames;
+    std::vector<InputFrame> m_replay;
+    // First replayed tick that left the player somewhere other than
+    // the recording did, or -1
+    int m_firstDivergentTick;
+    std::string m_renderer;
+    int m_drawRadius;
+
+    // Closed Catmull-Rom spline through a ring of points around the
+    // spawn point; t in [0, 1) covers the whole loop
+    static glm::vec3 pathPosition(float t);
+    static glm::vec3 pathDirection(float t);
+    std::string report() const;
+
+public:
+    RenderBenchmark(const RenderBenchmarkOptions &options);
+
+    // Runs the benchmark on a context of its own and writes the report.
+    // Returns the process exit code.
+    int run();
+};
@@ -0,0 +1,43 @@
+#include "blockcodec.h"
+
+// Visits blocks column by column, bottom to top
+static inline int columnIndex(int i) {
+    int y = i & 255;
+    int column = i >> 8;
+    int x = column & 15;
+    int z = column >> 4;
+    return x + 16 * y + 16 * 256 * z;
+}
+
+void encodeBlocksRLE(const BlockType *blocks, std::vector<unsigned char> *out) {
+    BlockType run = blocks[columnIndex(0)];
+    int length = 0;
+    for (int i = 0; i <= 65536; i++) {
+        if (i < 65536 && blocks[columnIndex(i)] == run) {
+            length++;
+            continue;
+        }
+        out->push_back(run);
+        out->push_back((length - 1) & 0xff);
+        out->push_back(((length - 1) >> 8) & 0xff);
+        if (i < 65536) {
+            run = blocks[columnIndex(i)];
+            length = 1;
+        }
+    }
+}
+
+bool decodeBlocksRLE(const unsigned char *data, size_t size, BlockType *blocks) {
+    int i = 0;
+    for (size_t p = 0; p + 2 < size; p += 3) {
+        BlockType t = static_cast<BlockType>(data[p]);
+        int length = (data[p + 1] | (data[p + 2] << 8)) + 1;
+        if (i + length > 65536) {
+            return false;
+        }
+        for (int end = i + length; i < end; i++) {
+            blocks[columnIndex(i)] = t;
+        }
+    }
+    return i == 65536;
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include "texturehelp.h"
+#include <vector>
+
+// Run-length coding of a Chunk's 16 x 256 x 16 block array.
+// Runs are taken down each vertical column rather than in memory
+// order, because generated terrain is strongly layered along Y:
+// a typical column is only a handful of runs (bedrock, lava,
+// stone, dirt, grass, air).
+// The encoding is a sequence of (BlockType, run length - 1) records,
+// where the run length is stored as a little-endian 16-bit value.
+
+// Appends the encoding of the 65536 blocks to out
+void encodeBlocksRLE(const BlockType *blocks, std::vector<unsigned char> *out);
+// Decodes an encoding that starts at data into blocks.
+// Returns false if the data does not describe exactly 65536 blocks.
+bool decodeBlocksRLE(const unsigned char *data, size_t size, BlockType *blocks);
@@ -1,32 +1,53 @@
 #include "blocktypeworker.h"
+#include "river.h"
 #include "iostream"
+#include "trace.h"
 
-BlockTypeWorker::BlockTypeWorker(Terrain * terrain,
+BlockTypeWorker::BlockTypeWorker(World * terrain,
                                  int64_t Coord,
                                  std::vector<Chunk*> terrainsChunk,
                                  std::vector<Chunk*> *mp_chunksWithOnlyBlockData,
                                  QMutex* mutex)
-    :mp_terrain(terrain), coord(Coord), terrainsChunk(terrainsChunk), mp_chunksWithOnlyBlockData(mp_chunksWithOnlyBlockData), mutex(mutex)
+    :mp_terrain(terrain), coord(Coord), terrainsChunk(terrainsChunk), mp_chunksWithOnlyBlockData(mp_chunksWithOnlyBlockData), mutex(mutex),
+      m_memory(MEMORY_JOB_QUEUES)
 {
+    m_memory.set(sizeof(BlockTypeWorker) + this->terrainsChunk.capacity() * sizeof(Chunk*));
 }
 
 void BlockTypeWorker::run() {
+    TRACE_SCOPE("generate zone");
 
     int x = toCoords(coord).x;
     int z = toCoords(coord).y;
 
-    try {
-        mp_terrain->createTerrainZone(x, z, false);
+    // A zone saved in full already has its rivers and edits
+    bool loaded = mp_terrain->loadZone(x, z);
+    if (!loaded) {
+        try {
+            mp_terrain->createTerrainZone(x, z);
+        }
+        catch(std::out_of_range &e) {
+            std::cout << "BlockTypeWorkerOutRange";
+        }
     }
-    catch(std::out_of_range &e) {
-        std::cout << "BlockTypeWorkerOutRange";
+    for (Chunk *c : terrainsChunk) {
+        c->stampPipeline(STAMP_GENERATED);
     }
 
-    River river = River(mp_terrain, x, z);
+    if (!loaded) {
+        {
+            TRACE_SCOPE("river");
+            River river = River(mp_terrain, x, z);
 
-    double random = ((double) rand() / (RAND_MAX));
-    if (random < 0.15)
-        river.draw();
+            if (river.random() < 0.15)
+                river.draw();
+        }
+        // Edits go on top of the river, which is always drawn the same
+        mp_terrain->applyZoneEdits(x, z);
+    }
+    for (Chunk *c : terrainsChunk) {
+        c->stampPipeline(STAMP_RIVER);
+    }
 
 
     mutex->lock();
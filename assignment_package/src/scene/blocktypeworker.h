@@ -3,21 +3,23 @@
 
 #include <QRunnable>
 #include <QMutex>
-#include <scene/terrain.h>
+#include <scene/world.h>
 using namespace std;
 
 class BlockTypeWorker : public QRunnable
 {
 private:
-    Terrain *mp_terrain;
+    World *mp_terrain;
     int64_t coord;
     std::vector<Chunk*> terrainsChunk;
     std::vector<Chunk*> *mp_chunksWithOnlyBlockData;
     QMutex *mutex;
+    // This job while it waits for or runs on the thread pool
+    MemoryAccount m_memory;
 
 public:
 
-    BlockTypeWorker(Terrain * terrain,
+    BlockTypeWorker(World * terrain,
                     int64_t Coord,
                     std::vector<Chunk*> terrainsChunk,
                     std::vector<Chunk*> *mp_chunksWithOnlyBlockData,
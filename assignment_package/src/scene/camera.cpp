@@ -33,5 +33,13 @@ void Camera::tick(float dT, InputBundle &input) {
 }
 
 glm::mat4 Camera::getViewProj() const {
-    return glm::perspective(glm::radians(m_fovy), m_aspect, m_near_clip, m_far_clip) * glm::lookAt(m_position, m_position + m_forward, m_up);
+    return getViewProj(m_near_clip, m_far_clip);
+}
+
+glm::mat4 Camera::getViewProj(float nearClip, float farClip) const {
+    return glm::perspective(glm::radians(m_fovy), m_aspect, nearClip, farClip) * glm::lookAt(m_position, m_position + m_forward, m_up);
+}
+
+float Camera::getNearClip() const {
+    return m_near_clip;
 }
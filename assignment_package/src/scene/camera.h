@@ -21,6 +21,10 @@ public:
     void tick(float dT, InputBundle &input) override;
 
     glm::mat4 getViewProj() const;
+    // The same view with the clip planes moved, e.g. to cover one
+    // shadow cascade's slice of the view frustum
+    glm::mat4 getViewProj(float nearClip, float farClip) const;
+    float getNearClip() const;
 
     friend class Player;
 };
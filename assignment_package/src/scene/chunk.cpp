@@ -1,14 +1,38 @@
 #include "chunk.h"
+#include "blockcodec.h"
+#include <algorithm>
 #include <iostream>
 
 
-Chunk::Chunk(OpenGLContext* context, int x, int z) : Drawable(context),m_blocks(), minX(x), minZ(z), m_neighbors{{XPOS, nullptr}, {XNEG, nullptr}, {ZPOS, nullptr}, {ZNEG, nullptr}}
+static std::atomic<uint64_t> compressions(0);
+static std::atomic<uint64_t> decompressions(0);
+
+// Frees a vector's heap storage, which clear() alone would keep
+template <typename T>
+static void releaseVector(std::vector<T> &v) {
+    std::vector<T>().swap(v);
+}
+
+Chunk::Chunk(int x, int z) : m_blocks(65536, EMPTY),
+    m_compressedBlocks(), m_compressed(false), m_compressionLock(), minX(x), minZ(z), m_neighbors{{XPOS, nullptr}, {XNEG, nullptr}, {ZPOS, nullptr}, {ZNEG, nullptr}},
+    m_lastVisible(0),
+    m_edits(), m_trackEdits(false), m_recordEdits(false), m_editsDirty(false), mp_renderData(nullptr),
+    m_blockMemory(MEMORY_CHUNK_BLOCKS), m_meshMemory(MEMORY_MESH_CPU),
+    m_VBOdataMinY(0.f), m_VBOdataMaxY(-1.f)
 {
-    std::fill_n(m_blocks.begin(), 65536, EMPTY);
+    m_pipelineStamps.fill(0);
+    m_VBOdataConnectivity.fill(ALL_FACES_CONNECTED);
+    m_VBOdataOccluders.fill(glm::vec2(0.f));
+    accountBlocks();
 }
-Chunk::~Chunk(){}
+Chunk::~Chunk()
+{}
+
 // Does bounds checking with at()
 BlockType Chunk::getBlockAt(unsigned int x, unsigned int y, unsigned int z) const {
+    if (m_compressed.load(std::memory_order_acquire)) {
+        ensureResident();
+    }
     return m_blocks.at(x + 16 * y + 16 * 256 * z);
 }
 
@@ -19,7 +43,177 @@ BlockType Chunk::getBlockAt(int x, int y, int z) const {
 
 // Does bounds checking with at()
 void Chunk::setBlockAt(unsigned int x, unsigned int y, unsigned int z, BlockType t) {
-    m_blocks.at(x + 16 * y + 16 * 256 * z) = t;
+    if (m_compressed.load(std::memory_order_acquire)) {
+        ensureResident();
+    }
+    unsigned int i = x + 16 * y + 16 * 256 * z;
+    m_blocks.at(i) = t;
+    if (m_trackEdits) {
+        m_editsDirty = true;
+        if (m_recordEdits) {
+            m_edits[i] = t;
+            accountBlocks();
+        }
+    }
+}
+
+void Chunk::accountBlocks() const {
+    // A std::map node is roughly three pointers plus the key and value
+    m_blockMemory.set(m_blocks.capacity() * sizeof(BlockType) + m_compressedBlocks.capacity()
+                      + m_edits.size() * 4 * sizeof(void*));
+}
+
+bool Chunk::compress() {
+    if (m_compressed.load(std::memory_order_acquire)) {
+        return false;
+    }
+    std::vector<unsigned char> encoded;
+    encodeBlocksRLE(m_blocks.data(), &encoded);
+    encoded.shrink_to_fit();
+    m_compressedBlocks.swap(encoded);
+    releaseVector(m_blocks);
+    m_compressed.store(true, std::memory_order_release);
+    accountBlocks();
+    compressions++;
+    return true;
+}
+
+bool Chunk::isCompressed() const {
+    return m_compressed.load(std::memory_order_acquire);
+}
+
+void Chunk::ensureResident() const {
+    QMutexLocker locker(&m_compressionLock);
+    // Another thread may have decompressed while we waited
+    if (!m_compressed.load(std::memory_order_acquire)) {
+        return;
+    }
+    m_blocks.resize(65536);
+    decodeBlocksRLE(m_compressedBlocks.data(), m_compressedBlocks.size(), m_blocks.data());
+    releaseVector(m_compressedBlocks);
+    m_compressed.store(false, std::memory_order_release);
+    accountBlocks();
+    decompressions++;
+}
+
+void Chunk::clearBlocks() {
+    QMutexLocker locker(&m_compressionLock);
+    m_blocks.assign(65536, EMPTY);
+    releaseVector(m_compressedBlocks);
+    m_compressed.store(false, std::memory_order_release);
+    accountBlocks();
+}
+
+uint64_t Chunk::compressionCount() {
+    return compressions;
+}
+
+uint64_t Chunk::decompressionCount() {
+    return decompressions;
+}
+
+void Chunk::stampPipeline(PipelineStamp stamp) {
+    if (stamp == STAMP_REQUESTED) {
+        m_pipelineStamps.fill(0);
+    }
+    m_pipelineStamps[stamp] = pipelineNowNs();
+}
+
+const std::array<int64_t, PIPELINESTAMPS> &Chunk::pipelineStamps() const {
+    return m_pipelineStamps;
+}
+
+void Chunk::clearPipelineStamps() {
+    m_pipelineStamps.fill(0);
+}
+
+// Version byte at the start of every save payload
+static const unsigned char CHUNK_PAYLOAD_RLE = 1;
+static const unsigned char CHUNK_PAYLOAD_EDITS = 2;
+
+void Chunk::serialize(std::vector<unsigned char> *out) {
+    out->clear();
+    out->push_back(CHUNK_PAYLOAD_RLE);
+    // A compressed Chunk already holds its encoding
+    if (isCompressed()) {
+        out->insert(out->end(), m_compressedBlocks.begin(), m_compressedBlocks.end());
+    } else {
+        encodeBlocksRLE(m_blocks.data(), out);
+    }
+    m_editsDirty = false;
+}
+
+bool Chunk::deserialize(const std::vector<unsigned char> &payload) {
+    if (payload.empty() || payload[0] != CHUNK_PAYLOAD_RLE) {
+        return false;
+    }
+    std::vector<BlockType> blocks(65536);
+    if (!decodeBlocksRLE(payload.data() + 1, payload.size() - 1, blocks.data())) {
+        return false;
+    }
+    QMutexLocker locker(&m_compressionLock);
+    m_blocks.swap(blocks);
+    releaseVector(m_compressedBlocks);
+    m_compressed.store(false, std::memory_order_release);
+    accountBlocks();
+    m_editsDirty = false;
+    return true;
+}
+
+bool Chunk::isFullPayload(const std::vector<unsigned char> &payload) {
+    return !payload.empty() && payload[0] == CHUNK_PAYLOAD_RLE;
+}
+
+void Chunk::trackEdits(bool recordDeltas) {
+    m_trackEdits = true;
+    m_recordEdits = recordDeltas;
+}
+
+bool Chunk::hasUnsavedEdits() const {
+    return m_editsDirty;
+}
+
+void Chunk::markUnsaved() {
+    m_editsDirty = true;
+}
+
+// Layout: version, uint32 count, count x (uint16 index, BlockType),
+// little-endian with indices in increasing order
+void Chunk::serializeEdits(std::vector<unsigned char> *out) {
+    out->clear();
+    out->reserve(5 + 3 * m_edits.size());
+    out->push_back(CHUNK_PAYLOAD_EDITS);
+    uint32_t count = m_edits.size();
+    for (int i = 0; i < 4; i++) {
+        out->push_back((count >> (8 * i)) & 0xff);
+    }
+    for (const auto &e : m_edits) {
+        out->push_back(e.first & 0xff);
+        out->push_back(e.first >> 8);
+        out->push_back(e.second);
+    }
+    m_editsDirty = false;
+}
+
+bool Chunk::applyEdits(const std::vector<unsigned char> &payload) {
+    if (payload.size() < 5 || payload[0] != CHUNK_PAYLOAD_EDITS) {
+        return false;
+    }
+    uint32_t count = payload[1] | (payload[2] << 8) | (payload[3] << 16)
+            | (static_cast<uint32_t>(payload[4]) << 24);
+    if (payload.size() != 5 + 3 * static_cast<size_t>(count)) {
+        return false;
+    }
+    ensureResident();
+    for (size_t p = 5; p < payload.size(); p += 3) {
+        uint16_t i = payload[p] | (payload[p + 1] << 8);
+        BlockType t = static_cast<BlockType>(payload[p + 2]);
+        m_blocks[i] = t;
+        m_edits[i] = t;
+    }
+    m_editsDirty = false;
+    accountBlocks();
+    return true;
 }
 
 
@@ -38,21 +232,104 @@ void Chunk::linkNeighbor(uPtr<Chunk> &neighbor, Direction dir) {
         neighbor->m_neighbors[oppositeDirection.at(dir)] = this;
     }
 }
-GLenum Chunk::drawMode(){
-    return GL_TRIANGLES;
+void Chunk::unlinkNeighbors() {
+    for (auto &n : m_neighbors) {
+        if (n.second != nullptr) {
+            n.second->m_neighbors[oppositeDirection.at(n.first)] = nullptr;
+            n.second = nullptr;
+        }
+    }
+}
+
+size_t Chunk::memoryFootprint() const {
+    return sizeof(Chunk) + (mp_renderData ? mp_renderData->memoryFootprint() : 0)
+            + m_blockMemory.bytes() + m_meshMemory.bytes();
+}
+
+ChunkRenderData *Chunk::renderData() const {
+    return mp_renderData.get();
+}
+
+void Chunk::setRenderData(uPtr<ChunkRenderData> data) {
+    mp_renderData = std::move(data);
 }
 
+// Per-thread scratch space for createVBOdata. Each VBOWorker thread keeps
+// its own vectors between chunks, so once they have grown to a typical
+// chunk's size, meshing no longer reallocates while faces are appended.
+struct MeshScratch {
+    std::vector<glm::vec4> all;
+    std::vector<glm::vec4> transAll;
+    std::vector<uint32_t> idx;
+    std::vector<uint32_t> transIdx;
+    MemoryAccount memory;
+
+    // 3 vec4s per vertex, 4 vertices and 6 indices per face
+    MeshScratch() : memory(MEMORY_GENERATION_SCRATCH) {
+        all.reserve(2048 * 12);
+        idx.reserve(2048 * 6);
+        transAll.reserve(512 * 12);
+        transIdx.reserve(512 * 6);
+        account();
+    }
+
+    void account() {
+        memory.set((all.capacity() + transAll.capacity()) * sizeof(glm::vec4)
+                   + (idx.capacity() + transIdx.capacity()) * sizeof(uint32_t));
+    }
+
+    void clear() {
+        all.clear();
+        transAll.clear();
+        idx.clear();
+        transIdx.clear();
+    }
+};
+
+static thread_local MeshScratch meshScratch;
+
+
 const static std::unordered_map<BlockType, bool> transBlocks = {{EMPTY, 1}, {WATER, 1}};
 const static std::unordered_map<BlockType, bool> animatableBlocks = {{WATER, 1}, {LAVA, 1}};
 
+// Blocks that hide whatever is behind them
+static inline bool isOpaqueBlock(BlockType t) {
+    return t != EMPTY && t != WATER;
+}
+
+// In each column, finds the run of opaque blocks under the highest
+// one; a quarter's slab is where the runs of all its columns overlap
+static void computeOccluderSlabs(const std::vector<BlockType> &blocks, std::array<glm::vec2, 4> *out) {
+    for (int q = 0; q < 4; q++) {
+        int lo = 0, hi = 256;
+        for (int z = 8 * (q >> 1); z < 8 * (q >> 1) + 8 && lo < hi; z++) {
+            for (int x = 8 * (q & 1); x < 8 * (q & 1) + 8 && lo < hi; x++) {
+                const BlockType *column = &blocks[x + 4096 * z];
+                int top = 255;
+                while (top >= 0 && !isOpaqueBlock(column[16 * top])) {
+                    top--;
+                }
+                int bottom = top;
+                while (bottom > 0 && isOpaqueBlock(column[16 * (bottom - 1)])) {
+                    bottom--;
+                }
+                lo = std::max(lo, bottom);
+                hi = std::min(hi, top + 1);
+            }
+        }
+        (*out)[q] = lo < hi ? glm::vec2(lo, hi) : glm::vec2(0.f);
+    }
+}
+
 void Chunk::createVBOdata() {
     int num_count = 0; //num increased by 4 every time for index vbo
     int num_countTrans = 0; //num increased by 4 every time for index vbo
 
-    std::vector<glm::vec4> all;
-    std::vector<glm::vec4> transAll;
-    std::vector<GLuint> idx;
-    std::vector<GLuint> transIdx;
+    meshScratch.clear();
+    std::vector<glm::vec4> &all = meshScratch.all;
+    std::vector<glm::vec4> &transAll = meshScratch.transAll;
+    std::vector<uint32_t> &idx = meshScratch.idx;
+    std::vector<uint32_t> &transIdx = meshScratch.transIdx;
 
     std::vector<glm::vec4> *used;
 
@@ -461,33 +738,44 @@ void Chunk::createVBOdata() {
     }
     **/
     }
-    this->m_VBOdataIdx = idx;
-    this->m_VBOdataAll = all;
-    this->m_VBOdataTransIdx = transIdx;
-    this->m_VBOdataTransAll = transAll;
+    // Copy out of the scratch vectors exactly once, into right-sized storage
+    this->m_VBOdataIdx.assign(idx.begin(), idx.end());
+    this->m_VBOdataAll.assign(all.begin(), all.end());
+    this->m_VBOdataTransIdx.assign(transIdx.begin(), transIdx.end());
+    this->m_VBOdataTransAll.assign(transAll.begin(), transAll.end());
+    meshScratch.account();
+    m_meshMemory.set((m_VBOdataAll.capacity() + m_VBOdataTransAll.capacity()) * sizeof(glm::vec4)
+                     + (m_VBOdataIdx.capacity() + m_VBOdataTransIdx.capacity()) * sizeof(uint32_t));
+
+    // Every third vec4 is a world-space position
+    float minY = 256.f, maxY = -1.f;
+    for (const std::vector<glm::vec4> *v : {&all, &transAll}) {
+        for (size_t i = 0; i < v->size(); i += 3) {
+            minY = std::min(minY, (*v)[i].y);
+            maxY = std::max(maxY, (*v)[i].y);
+        }
+    }
+    this->m_VBOdataMinY = minY;
+    this->m_VBOdataMaxY = maxY;
 
+    ensureResident();
+    computeSectionConnectivity(m_blocks.data(), &m_VBOdataConnectivity);
+    computeOccluderSlabs(m_blocks, &m_VBOdataOccluders);
 }
 
-
-
-void Chunk::sendVBOdata() {
-    m_count = m_VBOdataIdx.size();
-
-    generateIdx();
-    bindIdx();
-    mp_context->glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_VBOdataIdx.size() * sizeof(GLuint), m_VBOdataIdx.data(), GL_STATIC_DRAW);
-
-    generateAll();
-    bindAll();
-    mp_context->glBufferData(GL_ARRAY_BUFFER, m_VBOdataAll.size() * sizeof(glm::vec4), m_VBOdataAll.data(), GL_STATIC_DRAW);
-
-    m_transCount = m_VBOdataTransAll.size();
-
-    generateTransIdx();
-    bindTransIdx();
-    mp_context->glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_VBOdataTransIdx.size() * sizeof(GLuint), m_VBOdataTransIdx.data(), GL_STATIC_DRAW);
-
-    generateTransAll();
-    bindTransAll();
-    mp_context->glBufferData(GL_ARRAY_BUFFER, m_VBOdataTransAll.size() * sizeof(glm::vec4), m_VBOdataTransAll.data(), GL_STATIC_DRAW);
+ChunkVBOData Chunk::takeVBOdata() {
+    ChunkVBOData data;
+    data.associated_chunk = this;
+    data.idx_data = std::move(m_VBOdataIdx);
+    data.vertex_data = std::move(m_VBOdataAll);
+    data.trans_idx_data = std::move(m_VBOdataTransIdx);
+    data.trans_vertex_data = std::move(m_VBOdataTransAll);
+    data.minY = m_VBOdataMinY;
+    data.maxY = m_VBOdataMaxY;
+    data.connectivity = m_VBOdataConnectivity;
+    data.occluders = m_VBOdataOccluders;
+    data.memory.set(m_meshMemory.bytes());
+    m_meshMemory.set(0);
+    return data;
 }
+
@@ -2,10 +2,16 @@
 #include "smartpointerhelp.h"
 #include "glm_includes.h"
 #include <array>
+#include <atomic>
+#include <map>
 #include <unordered_map>
 #include <cstddef>
-#include "drawable.h"
+#include <cstdint>
 #include "texturehelp.h"
+#include "visibilitygraph.h"
+#include "pipelinelatency.h"
+#include "memorystats.h"
+#include <QMutex>
 
 
 //using namespace std;
@@ -17,36 +23,171 @@
 // render all the world at once, while also not having
 // to render the world block by block.
 
-// TODO have Chunk inherit from Drawable
-class Chunk : public Drawable {
+class Chunk;
+
+// The mesh of one Chunk on its way from a VBOWorker to the GL thread.
+// It is move-only so the vertex data is handed off rather than copied;
+// once ChunkDrawable::upload has sent it to the GPU the vectors are released.
+struct ChunkVBOData {
+    Chunk *associated_chunk;
+    std::vector<glm::vec4> vertex_data;
+    std::vector<uint32_t> idx_data;
+    std::vector<glm::vec4> trans_vertex_data;
+    std::vector<uint32_t> trans_idx_data;
+    // World-space Y range covered by the vertices; minY > maxY if there are none
+    float minY, maxY;
+    // Face connectivity of each 16-high section, for occlusion culling
+    std::array<SectionConnectivity, 16> connectivity;
+    // Solid Y spans of each 8 x 8 quarter, see ChunkDrawable::occluderSlabs
+    std::array<glm::vec2, 4> occluders;
+    // The vectors' storage, counted as MEMORY_MESH_CPU
+    MemoryAccount memory;
+
+    ChunkVBOData() : associated_chunk(nullptr), minY(0.f), maxY(-1.f), memory(MEMORY_MESH_CPU) {
+        connectivity.fill(ALL_FACES_CONNECTED);
+        occluders.fill(glm::vec2(0.f));
+    }
+    ChunkVBOData(ChunkVBOData &&) = default;
+    ChunkVBOData &operator=(ChunkVBOData &&) = default;
+    ChunkVBOData(const ChunkVBOData &) = delete;
+    ChunkVBOData &operator=(const ChunkVBOData &) = delete;
+};
+
+// Whatever the rendering layer keeps for a Chunk once its mesh is on
+// the GPU (see ChunkDrawable). The Chunk only owns it, so that it goes
+// away with the Chunk, and asks it how much memory it holds.
+class ChunkRenderData {
+public:
+    virtual ~ChunkRenderData() {}
+    // Approximate RAM plus VRAM held, in bytes
+    virtual size_t memoryFootprint() const = 0;
+};
+
+// The block data and CPU-side mesh of a Chunk. It knows nothing about
+// OpenGL: uploading and drawing the mesh is up to the rendering layer.
+class Chunk {
 private:
-    // All of the blocks contained within this Chunk
-    std::array<BlockType, 65536> m_blocks;
+    // All of the blocks contained within this Chunk.
+    // Empty while the Chunk is compressed.
+    mutable std::vector<BlockType> m_blocks;
+    // Run-length encoding of the blocks down each column (see
+    // blockcodec.h), only held while the Chunk is compressed
+    mutable std::vector<unsigned char> m_compressedBlocks;
+    mutable std::atomic<bool> m_compressed;
+    // Serializes decompression, which may be triggered from any thread
+    mutable QMutex m_compressionLock;
     int minX, minZ;
     // This Chunk's four neighbors to the north, south, east, and west
     // The third input to this map just lets us use a Direction as
     // a key for this map.
     // These allow us to properly determine
     std::unordered_map<Direction, Chunk*, EnumHash> m_neighbors;
+    // Milliseconds timestamp of the last frame this Chunk was drawn in,
+    // used to pick least-recently-visible Chunks for unloading. Zero
+    // until it is drawn or compressColdChunks first sees it.
+    int64_t m_lastVisible;
+    // When this Chunk passed each PipelineStamp since it was last
+    // requested, from pipelineNowNs; 0 for stamps it has not passed
+    std::array<int64_t, PIPELINESTAMPS> m_pipelineStamps;
+    // Blocks set after the terrain generator finished with this Chunk,
+    // keyed by block index, for edit-delta saves
+    std::map<uint16_t, BlockType> m_edits;
+    // Whether setBlockAt counts as an edit; off while generating
+    bool m_trackEdits;
+    // Whether edits are also recorded into m_edits, which only
+    // edit-delta saves need
+    bool m_recordEdits;
+    // Whether the blocks have been edited since they were last saved
+    // or loaded. Generation only counts through markUnsaved.
+    bool m_editsDirty;
+    // Null until the rendering layer attaches its state
+    uPtr<ChunkRenderData> mp_renderData;
+    // The blocks in either form plus the edits, and the mesh built by
+    // createVBOdata until takeVBOdata hands it on
+    mutable MemoryAccount m_blockMemory;
+    MemoryAccount m_meshMemory;
+
+    // Brings m_blockMemory up to date
+    void accountBlocks() const;
 
 public:
-    Chunk(OpenGLContext* context, int x, int z);
+    Chunk(int x, int z);
     ~Chunk();
-    void createVBOdata() override;
-
-    GLenum drawMode() override;
+    // Builds the mesh on the calling thread; takeVBOdata hands it over
+    void createVBOdata();
 
     BlockType getBlockAt(unsigned int x, unsigned int y, unsigned int z) const;
     BlockType getBlockAt(int x, int y, int z) const;
     void setBlockAt(unsigned int x, unsigned int y, unsigned int z, BlockType t);
+
+    // Frees the block array, keeping only its run-length encoding.
+    // Only call from the GL thread while no worker is using this Chunk
+    // or its neighbors. Returns false if the Chunk was already compressed.
+    bool compress();
+    bool isCompressed() const;
+    // Sets every block to EMPTY, compressed or not
+    void clearBlocks();
+    // Decompresses the blocks if they are compressed. getBlockAt and
+    // setBlockAt do this on their own; safe to call from any thread.
+    void ensureResident() const;
+    // Number of compress() and decompress operations over all Chunks
+    static uint64_t compressionCount();
+    static uint64_t decompressionCount();
+
+    // Stamping STAMP_REQUESTED clears the other stamps. Each stamp is
+    // taken by whichever thread holds the Chunk at that stage.
+    void stampPipeline(PipelineStamp stamp);
+    const std::array<int64_t, PIPELINESTAMPS> &pipelineStamps() const;
+    // Forgets the stamps, so that later re-meshes are not recorded
+    void clearPipelineStamps();
+
     void linkNeighbor(uPtr<Chunk>& neighbor, Direction dir);
-    void sendVBOdata();
-    void sendTransVBOdata();
+    // Clears the pointers between this Chunk and its neighbors so
+    // that this Chunk can be deleted without leaving them dangling
+    void unlinkNeighbors();
+    // Approximate RAM plus VRAM held by this Chunk, in bytes
+    size_t memoryFootprint() const;
+    // Moves the mesh built by createVBOdata out of this Chunk
+    ChunkVBOData takeVBOdata();
+
+    ChunkRenderData *renderData() const;
+    void setRenderData(uPtr<ChunkRenderData> data);
+
+    // Encodes the blocks into a save payload and clears the unsaved flag
+    void serialize(std::vector<unsigned char> *out);
+    // Replaces the blocks with a payload made by serialize.
+    // Returns false, leaving the blocks untouched, if it is malformed.
+    bool deserialize(const std::vector<unsigned char> &payload);
+
+    // Whether payload holds whole blocks, from serialize, rather than
+    // edits from serializeEdits
+    static bool isFullPayload(const std::vector<unsigned char> &payload);
+
+    // From now on block changes are edits on top of generated terrain:
+    // they make hasUnsavedEdits true and, with recordDeltas, are kept
+    // for serializeEdits
+    void trackEdits(bool recordDeltas);
+    // Whether there are edits neither serialize nor serializeEdits has
+    // written out yet
+    bool hasUnsavedEdits() const;
+    // Makes hasUnsavedEdits true, so that freshly generated blocks are
+    // saved too
+    void markUnsaved();
+    // Encodes the recorded edits as a sorted (index, BlockType) list
+    // and clears the unsaved flag
+    void serializeEdits(std::vector<unsigned char> *out);
+    // Applies edits made by serializeEdits on top of the current blocks.
+    // Returns false, leaving the blocks untouched, if it is malformed.
+    bool applyEdits(const std::vector<unsigned char> &payload);
 
-    std::vector<GLuint> m_VBOdataIdx;
+    std::vector<uint32_t> m_VBOdataIdx;
     std::vector<glm::vec4> m_VBOdataAll;
-    std::vector<GLuint> m_VBOdataTransIdx;
+    std::vector<uint32_t> m_VBOdataTransIdx;
     std::vector<glm::vec4> m_VBOdataTransAll;
+    float m_VBOdataMinY, m_VBOdataMaxY;
+    std::array<SectionConnectivity, 16> m_VBOdataConnectivity;
+    std::array<glm::vec2, 4> m_VBOdataOccluders;
 
+    friend class World;
     friend class Terrain;
 };
@@ -0,0 +1,137 @@
+#include "chunkdrawable.h"
+#include <atomic>
+
+static std::atomic<uint64_t> meshChanges(0);
+
+// Frees a vector's heap storage, which clear() alone would keep
+template <typename T>
+static void releaseVector(std::vector<T> &v) {
+    std::vector<T>().swap(v);
+}
+
+ChunkDrawable::ChunkDrawable(OpenGLContext *context, TerrainArena *arena, Chunk *chunk, int x, int z)
+    : Drawable(context), mp_chunk(chunk), m_minX(x), m_minZ(z), m_gpuBytes(0), m_meshMinY(0.f), m_meshMaxY(-1.f),
+      m_meshStamp(0), mp_arena(arena), m_ownBufferMemory(MEMORY_MESH_GPU)
+{
+    m_count = 0;
+    m_transCount = 0;
+    m_sectionConnectivity.fill(ALL_FACES_CONNECTED);
+    m_occluderSlabs.fill(glm::vec2(0.f));
+}
+
+ChunkDrawable::~ChunkDrawable() {
+    // Unloading a zone deletes its Chunks, and with them their meshes
+    destroyVBOdata();
+}
+
+ChunkDrawable *ChunkDrawable::of(const Chunk *chunk) {
+    return static_cast<ChunkDrawable*>(chunk->renderData());
+}
+
+void ChunkDrawable::createVBOdata() {
+    mp_chunk->createVBOdata();
+    ChunkVBOData data = mp_chunk->takeVBOdata();
+    upload(data);
+}
+
+void ChunkDrawable::destroyVBOdata() {
+    if (mp_arena) {
+        mp_arena->release(&m_slices[LAYER_OPAQUE], LAYER_OPAQUE);
+        mp_arena->release(&m_slices[LAYER_TRANSLUCENT], LAYER_TRANSLUCENT);
+    }
+    Drawable::destroyVBOdata();
+    m_gpuBytes = 0;
+    m_ownBufferMemory.set(0);
+    m_meshMinY = 0.f;
+    m_meshMaxY = -1.f;
+    m_meshStamp = ++meshChanges;
+}
+
+GLenum ChunkDrawable::drawMode() {
+    return GL_TRIANGLES;
+}
+
+void ChunkDrawable::upload(ChunkVBOData &data) {
+    m_count = data.idx_data.size();
+    m_meshMinY = data.minY;
+    m_meshMaxY = data.maxY;
+    m_sectionConnectivity = data.connectivity;
+    m_occluderSlabs = data.occluders;
+    m_transCount = data.trans_idx_data.size();
+    m_gpuBytes = (data.idx_data.size() + data.trans_idx_data.size()) * sizeof(GLuint)
+            + (data.vertex_data.size() + data.trans_vertex_data.size()) * sizeof(glm::vec4);
+    m_meshStamp = ++meshChanges;
+
+    if (mp_arena) {
+        // Re-meshing frees the old slices before allocating new ones
+        mp_arena->upload(&m_slices[LAYER_OPAQUE], LAYER_OPAQUE, data.vertex_data, data.idx_data);
+        mp_arena->upload(&m_slices[LAYER_TRANSLUCENT], LAYER_TRANSLUCENT, data.trans_vertex_data, data.trans_idx_data);
+    } else {
+        uploadOwnBuffers(data);
+    }
+
+    // The GPU owns the mesh now, so there is no reason to keep it in RAM
+    releaseVector(data.idx_data);
+    releaseVector(data.vertex_data);
+    releaseVector(data.trans_idx_data);
+    releaseVector(data.trans_vertex_data);
+    data.memory.set(0);
+}
+
+void ChunkDrawable::uploadOwnBuffers(const ChunkVBOData &data) {
+    // Re-meshing an existing Chunk reuses its buffers instead of leaking them
+    if (!m_idxGenerated) generateIdx();
+    bindIdx();
+    mp_context->glBufferData(GL_ELEMENT_ARRAY_BUFFER, data.idx_data.size() * sizeof(GLuint), data.idx_data.data(), GL_STATIC_DRAW);
+
+    if (!m_allGenerated) generateAll();
+    bindAll();
+    mp_context->glBufferData(GL_ARRAY_BUFFER, data.vertex_data.size() * sizeof(glm::vec4), data.vertex_data.data(), GL_STATIC_DRAW);
+
+    if (!m_transIdxGenerated) generateTransIdx();
+    bindTransIdx();
+    mp_context->glBufferData(GL_ELEMENT_ARRAY_BUFFER, data.trans_idx_data.size() * sizeof(GLuint), data.trans_idx_data.data(), GL_STATIC_DRAW);
+
+    if (!m_transAllGenerated) generateTransAll();
+    bindTransAll();
+    mp_context->glBufferData(GL_ARRAY_BUFFER, data.trans_vertex_data.size() * sizeof(glm::vec4), data.trans_vertex_data.data(), GL_STATIC_DRAW);
+    mp_context->glState().countUpload((data.idx_data.size() + data.trans_idx_data.size()) * sizeof(GLuint)
+                                      + (data.vertex_data.size() + data.trans_vertex_data.size()) * sizeof(glm::vec4));
+    m_ownBufferMemory.set(m_gpuBytes);
+}
+
+size_t ChunkDrawable::memoryFootprint() const {
+    return sizeof(ChunkDrawable) + m_gpuBytes;
+}
+
+uint64_t ChunkDrawable::meshRevision() {
+    return meshChanges;
+}
+
+uint64_t ChunkDrawable::meshStamp() const {
+    return m_meshStamp;
+}
+
+bool ChunkDrawable::hasMesh() const {
+    return m_meshMinY <= m_meshMaxY;
+}
+
+glm::vec3 ChunkDrawable::boundsMin() const {
+    return glm::vec3(m_minX, m_meshMinY, m_minZ);
+}
+
+glm::vec3 ChunkDrawable::boundsMax() const {
+    return glm::vec3(m_minX + 16, m_meshMaxY, m_minZ + 16);
+}
+
+const std::array<SectionConnectivity, 16> &ChunkDrawable::sectionConnectivity() const {
+    return m_sectionConnectivity;
+}
+
+const std::array<glm::vec2, 4> &ChunkDrawable::occluderSlabs() const {
+    return m_occluderSlabs;
+}
+
+const ArenaSlice &ChunkDrawable::slice(TerrainLayer layer) const {
+    return m_slices[layer];
+}
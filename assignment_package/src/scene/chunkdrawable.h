@@ -0,0 +1,69 @@
+#pragma once
+#include "drawable.h"
+#include "chunk.h"
+#include "terrainarena.h"
+#include <array>
+#include <cstdint>
+
+// The GPU side of a Chunk: its mesh, either in a TerrainArena or in
+// buffers of its own, and what Terrain culls it with. Terrain attaches
+// one to a Chunk when the Chunk's first mesh is uploaded, and the Chunk
+// deletes it along with itself.
+class ChunkDrawable : public Drawable, public ChunkRenderData {
+private:
+    Chunk *mp_chunk;
+    int m_minX, m_minZ;
+    // Bytes currently held by this Chunk's GPU buffers
+    size_t m_gpuBytes;
+    // Y range of the uploaded mesh, used to tighten the culling bounds
+    float m_meshMinY, m_meshMaxY;
+    // meshRevision() right after the mesh was last uploaded or freed
+    uint64_t m_meshStamp;
+    // Section connectivity matching the uploaded mesh
+    std::array<SectionConnectivity, 16> m_sectionConnectivity;
+    std::array<glm::vec2, 4> m_occluderSlabs;
+    // Shared buffers the mesh is uploaded to, or null to give this
+    // Chunk buffers of its own
+    TerrainArena *mp_arena;
+    // The opaque and translucent meshes' place in mp_arena
+    ArenaSlice m_slices[2];
+    // m_gpuBytes while they are in buffers of its own; the arena
+    // counts its own buffers
+    MemoryAccount m_ownBufferMemory;
+
+    // Uploads the mesh to this Chunk's own buffers when it has no arena
+    void uploadOwnBuffers(const ChunkVBOData &data);
+
+public:
+    ChunkDrawable(OpenGLContext *context, TerrainArena *arena, Chunk *chunk, int x, int z);
+    ~ChunkDrawable();
+    // The ChunkDrawable attached to a Chunk, or null if it has none yet
+    static ChunkDrawable *of(const Chunk *chunk);
+
+    // Meshes the Chunk on the calling thread and uploads the result
+    void createVBOdata() override;
+    void destroyVBOdata() override;
+    GLenum drawMode() override;
+    // Uploads a mesh handed over by a VBOWorker and frees it
+    void upload(ChunkVBOData &data);
+
+    size_t memoryFootprint() const override;
+    // Increases whenever any Chunk's mesh is uploaded or freed, or a
+    // ChunkDrawable is deleted, so callers can tell when cached bounds
+    // are stale
+    static uint64_t meshRevision();
+    uint64_t meshStamp() const;
+
+    // Whether a mesh with at least one face has been uploaded
+    bool hasMesh() const;
+    // Bounding box of the uploaded mesh. Empty (min.y > max.y) when
+    // the Chunk has no faces.
+    glm::vec3 boundsMin() const;
+    glm::vec3 boundsMax() const;
+    const std::array<SectionConnectivity, 16> &sectionConnectivity() const;
+    // For each 8 x 8 quarter of the Chunk (x offset 8 * (i & 1), z offset
+    // 8 * (i >> 1)), a Y range [x, y) in which every block is opaque,
+    // for use as an occluder. Empty when x >= y.
+    const std::array<glm::vec2, 4> &occluderSlabs() const;
+    const ArenaSlice &slice(TerrainLayer layer) const;
+};
@@ -0,0 +1,72 @@
+#include "frustum.h"
+
+void AABBList::clear() {
+    minX.clear();
+    minY.clear();
+    minZ.clear();
+    maxX.clear();
+    maxY.clear();
+    maxZ.clear();
+}
+
+void AABBList::push(glm::vec3 min, glm::vec3 max) {
+    minX.push_back(min.x);
+    minY.push_back(min.y);
+    minZ.push_back(min.z);
+    maxX.push_back(max.x);
+    maxY.push_back(max.y);
+    maxZ.push_back(max.z);
+}
+
+size_t AABBList::size() const {
+    return minX.size();
+}
+
+Frustum::Frustum(const glm::mat4 &viewProj)
+    : m_planes()
+{
+    // glm matrices are column-major, so row i is (m[0][i], m[1][i], m[2][i], m[3][i])
+    glm::vec4 row0(viewProj[0][0], viewProj[1][0], viewProj[2][0], viewProj[3][0]);
+    glm::vec4 row1(viewProj[0][1], viewProj[1][1], viewProj[2][1], viewProj[3][1]);
+    glm::vec4 row2(viewProj[0][2], viewProj[1][2], viewProj[2][2], viewProj[3][2]);
+    glm::vec4 row3(viewProj[0][3], viewProj[1][3], viewProj[2][3], viewProj[3][3]);
+    m_planes[0] = row3 + row0; // left
+    m_planes[1] = row3 - row0; // right
+    m_planes[2] = row3 + row1; // bottom
+    m_planes[3] = row3 - row1; // top
+    m_planes[4] = row3 + row2; // near
+    m_planes[5] = row3 - row2; // far
+    for (glm::vec4 &p : m_planes) {
+        p /= glm::length(glm::vec3(p));
+    }
+}
+
+bool Frustum::intersectsAABB(glm::vec3 min, glm::vec3 max) const {
+    for (const glm::vec4 &p : m_planes) {
+        // The corner furthest along the plane normal
+        glm::vec3 v(p.x >= 0 ? max.x : min.x,
+                    p.y >= 0 ? max.y : min.y,
+                    p.z >= 0 ? max.z : min.z);
+        if (glm::dot(glm::vec3(p), v) + p.w < 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void Frustum::cullAABBs(const AABBList &boxes, std::vector<unsigned char> *out_visible) const {
+    size_t n = boxes.size();
+    out_visible->assign(n, 1);
+    unsigned char *visible = out_visible->data();
+    for (const glm::vec4 &p : m_planes) {
+        // Picking the furthest corner per plane rather than per box
+        // keeps the inner loop free of branches
+        const float *vx = p.x >= 0 ? boxes.maxX.data() : boxes.minX.data();
+        const float *vy = p.y >= 0 ? boxes.maxY.data() : boxes.minY.data();
+        const float *vz = p.z >= 0 ? boxes.maxZ.data() : boxes.minZ.data();
+        for (size_t i = 0; i < n; i++) {
+            float d = p.x * vx[i] + p.y * vy[i] + p.z * vz[i] + p.w;
+            visible[i] &= static_cast<unsigned char>(d >= 0);
+        }
+    }
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include "glm_includes.h"
+#include <array>
+#include <vector>
+
+// A batch of axis-aligned bounding boxes stored as one array per
+// coordinate, so that Frustum::cullAABBs can test many of them with
+// straight-line loops the compiler can vectorize
+struct AABBList {
+    std::vector<float> minX, minY, minZ;
+    std::vector<float> maxX, maxY, maxZ;
+
+    void clear();
+    void push(glm::vec3 min, glm::vec3 max);
+    size_t size() const;
+};
+
+// The six clip planes of a view-projection matrix, pointing inward,
+// extracted with the Gribb-Hartmann method. A point p is inside the
+// frustum when dot(plane.xyz, p) + plane.w >= 0 for every plane.
+class Frustum {
+private:
+    std::array<glm::vec4, 6> m_planes;
+
+public:
+    Frustum(const glm::mat4 &viewProj);
+
+    // Conservative test: may keep boxes near a corner of the frustum
+    // that are actually outside it, but never rejects a visible box
+    bool intersectsAABB(glm::vec3 min, glm::vec3 max) const;
+    // Sets (*out_visible)[i] to 1 if box i passes intersectsAABB, 0 otherwise
+    void cullAABBs(const AABBList &boxes, std::vector<unsigned char> *out_visible) const;
+};
@@ -0,0 +1,283 @@
+#include "lodterrain.h"
+#include "lodworker.h"
+#include "terrain.h"
+#include "texturehelp.h"
+#include <QThreadPool>
+#include <algorithm>
+
+LODTerrain::LODTerrain(Terrain *terrain, TerrainArena *arena)
+    : mp_terrain(terrain), mp_arena(arena), m_tiles(), m_pending(), m_finished(),
+      m_finishedLock(), m_center(0), m_order(), m_gpuBytes(0)
+{
+    const int maxRadius = MAXZONETODRAW + LODRINGS * LODRINGWIDTH;
+    for (int z = -maxRadius; z <= maxRadius; z++) {
+        for (int x = -maxRadius; x <= maxRadius; x++) {
+            m_order.push_back(glm::ivec2(x, z));
+        }
+    }
+    std::sort(m_order.begin(), m_order.end(), [](glm::ivec2 a, glm::ivec2 b) {
+        return a.x * a.x + a.y * a.y < b.x * b.x + b.y * b.y;
+    });
+}
+
+LODTerrain::~LODTerrain() {
+    clear();
+}
+
+int LODTerrain::distanceTo(int64_t zone) const {
+    glm::ivec2 d = glm::abs(toCoords(zone) / 64 - m_center);
+    return std::max(d.x, d.y);
+}
+
+int LODTerrain::zoneRadius() const {
+    return mp_terrain->drawRadius() + LODRINGS * LODRINGWIDTH;
+}
+
+int LODTerrain::desiredLevel(int64_t zone) const {
+    int d = distanceTo(zone);
+    if (d > zoneRadius()) {
+        return -1;
+    }
+    // Zones this close are always inside the draw range, so they only
+    // need a stand-in until their Chunks are meshed
+    int drawRadius = mp_terrain->drawRadius();
+    if (d < drawRadius && mp_terrain->isZoneMeshed(zone)) {
+        return -1;
+    }
+    return std::max(d - drawRadius - 1, 0) / LODRINGWIDTH;
+}
+
+const LODTile *LODTerrain::tileFor(int64_t zone) const {
+    auto it = m_tiles.find(zone);
+    if (it == m_tiles.end()) {
+        return nullptr;
+    }
+    int want = desiredLevel(zone);
+    if (want >= 0 && it->second[want]) {
+        return it->second[want].get();
+    }
+    for (const uPtr<LODTile> &tile : it->second) {
+        if (tile) {
+            return tile.get();
+        }
+    }
+    return nullptr;
+}
+
+const std::unordered_map<int64_t, std::array<uPtr<LODTile>, LODRINGS>> &LODTerrain::tiles() const {
+    return m_tiles;
+}
+
+void LODTerrain::releaseTile(uPtr<LODTile> &tile) {
+    if (!tile) {
+        return;
+    }
+    for (int c = 0; c < 16; c++) {
+        for (int layer = 0; layer < 2; layer++) {
+            ArenaSlice &slice = tile->slices[c][layer];
+            m_gpuBytes -= slice.vertexCount * sizeof(glm::vec4) * 3 + slice.indexCount * sizeof(GLuint);
+            mp_arena->release(&slice, static_cast<TerrainLayer>(layer));
+        }
+    }
+    tile.reset();
+}
+
+void LODTerrain::uploadTile(LODZoneMesh &mesh) {
+    uPtr<LODTile> &tile = m_tiles[mesh.zone][mesh.level];
+    releaseTile(tile);
+    tile = mkU<LODTile>();
+    for (int c = 0; c < 16; c++) {
+        LODColumnMesh &column = mesh.columns[c];
+        for (int layer = 0; layer < 2; layer++) {
+            mp_arena->upload(&tile->slices[c][layer], static_cast<TerrainLayer>(layer),
+                             column.vertices[layer], column.indices[layer]);
+            m_gpuBytes += column.vertices[layer].size() * sizeof(glm::vec4) + column.indices[layer].size() * sizeof(GLuint);
+        }
+        tile->yRange[c] = column.yRange;
+    }
+}
+
+void LODTerrain::update(glm::vec3 position) {
+    m_center = glm::ivec2(glm::floor(glm::vec2(position.x, position.z) / 64.f));
+
+    std::vector<LODZoneMesh> finished;
+    m_finishedLock.lock();
+    finished.swap(m_finished);
+    m_finishedLock.unlock();
+    // Zones out to the radius get tiles; one zone further they are kept but
+    // not queued, so tiles do not churn while the player walks along a zone edge
+    int radius = zoneRadius();
+    for (LODZoneMesh &mesh : finished) {
+        m_pending.erase(std::make_pair(mesh.zone, mesh.level));
+        if (distanceTo(mesh.zone) <= radius + 1) {
+            uploadTile(mesh);
+        }
+    }
+
+    for (auto it = m_tiles.begin(); it != m_tiles.end();) {
+        int d = distanceTo(it->first);
+        if (d > radius + 1) {
+            for (uPtr<LODTile> &tile : it->second) {
+                releaseTile(tile);
+            }
+            it = m_tiles.erase(it);
+            continue;
+        }
+        if (d <= radius) {
+            int want = desiredLevel(it->first);
+            // Other levels are only kept until the desired one is ready
+            if (want < 0 || it->second[want]) {
+                for (int level = 0; level < LODRINGS; level++) {
+                    if (level != want) {
+                        releaseTile(it->second[level]);
+                    }
+                }
+            }
+        }
+        ++it;
+    }
+
+    for (glm::ivec2 offset : m_order) {
+        if (static_cast<int>(m_pending.size()) >= MAXLODJOBS) {
+            break;
+        }
+        if (std::max(std::abs(offset.x), std::abs(offset.y)) > radius) {
+            continue;
+        }
+        glm::ivec2 z = 64 * (m_center + offset);
+        int64_t zone = toKey(z.x, z.y);
+        int want = desiredLevel(zone);
+        if (want < 0 || m_pending.count(std::make_pair(zone, want))) {
+            continue;
+        }
+        auto it = m_tiles.find(zone);
+        if (it != m_tiles.end() && it->second[want]) {
+            continue;
+        }
+        m_pending.insert(std::make_pair(zone, want));
+        // Below the Chunk workers, which feed the full-detail zones
+        QThreadPool::globalInstance()->start(new LODWorker(mp_terrain, zone, want, &m_finished, &m_finishedLock), -1);
+    }
+}
+
+void LODTerrain::clear() {
+    for (auto &zone : m_tiles) {
+        for (uPtr<LODTile> &tile : zone.second) {
+            releaseTile(tile);
+        }
+    }
+    m_tiles.clear();
+    // Meshes still being built are uploaded by the next update
+}
+
+int LODTerrain::radiusBlocks() const {
+    return 64 * zoneRadius();
+}
+
+size_t LODTerrain::gpuBytes() const {
+    return m_gpuBytes;
+}
+
+int LODTerrain::pendingCount() const {
+    return static_cast<int>(m_pending.size());
+}
+
+// Appends a quad whose corners are in the same order as the UVs the
+// Chunk mesher gives each face: the first two along the bottom edge of
+// the texture, the last two along the top
+static void pushQuad(LODColumnMesh *column, TerrainLayer layer, const glm::vec3 corners[4],
+                     glm::vec4 nor, glm::vec2 uv, float animatable) {
+    std::vector<glm::vec4> &verts = column->vertices[layer];
+    std::vector<GLuint> &idx = column->indices[layer];
+    const glm::vec2 uvs[4] = {uv, uv + glm::vec2(BLK_UV, 0.f), uv + glm::vec2(BLK_UV, BLK_UV), uv + glm::vec2(0.f, BLK_UV)};
+    GLuint base = static_cast<GLuint>(verts.size() / 3);
+    for (int i = 0; i < 4; i++) {
+        verts.push_back(glm::vec4(corners[i], 1.f));
+        verts.push_back(nor);
+        verts.push_back(glm::vec4(uvs[i], 0.f, animatable));
+        column->yRange.x = std::min(column->yRange.x, corners[i].y);
+        column->yRange.y = std::max(column->yRange.y, corners[i].y);
+    }
+    for (GLuint i : {0u, 1u, 2u, 0u, 2u, 3u}) {
+        idx.push_back(base + i);
+    }
+}
+
+void LODTerrain::buildMesh(Terrain *terrain, int64_t zone, int level, LODZoneMesh *out) {
+    const int step = 2 << level;
+    const int cells = 64 / step;
+    // Samples cover the zone's cells plus a one-cell border
+    const int stride = cells + 2;
+    glm::ivec2 origin = toCoords(zone);
+    std::vector<int> heights(stride * stride);
+    std::vector<BlockType> types(stride * stride);
+    for (int j = -1; j <= cells; j++) {
+        for (int i = -1; i <= cells; i++) {
+            int s = (i + 1) + stride * (j + 1);
+            // Each cell takes the column at its center
+            types[s] = terrain->generatedSurfaceAt(origin.x + i * step + step / 2, origin.y + j * step + step / 2, &heights[s]);
+        }
+    }
+
+    out->zone = zone;
+    out->level = level;
+    for (LODColumnMesh &column : out->columns) {
+        column = LODColumnMesh();
+        column.yRange = glm::vec2(256.f, 0.f);
+    }
+    const int cellsPerColumn = 16 / step;
+    const glm::ivec2 dirs[4] = {glm::ivec2(1, 0), glm::ivec2(-1, 0), glm::ivec2(0, 1), glm::ivec2(0, -1)};
+    const Direction faces[4] = {XPOS, XNEG, ZPOS, ZNEG};
+    for (int j = 0; j < cells; j++) {
+        for (int i = 0; i < cells; i++) {
+            int s = (i + 1) + stride * (j + 1);
+            LODColumnMesh &column = out->columns[i / cellsPerColumn + 4 * (j / cellsPerColumn)];
+            BlockType t = types[s];
+            float x0 = origin.x + i * step, z0 = origin.y + j * step;
+            float x1 = x0 + step, z1 = z0 + step;
+            float top = heights[s] + 1.f;
+
+            const glm::vec3 topFace[4] = {glm::vec3(x0, top, z0), glm::vec3(x1, top, z0),
+                                          glm::vec3(x1, top, z1), glm::vec3(x0, top, z1)};
+            pushQuad(&column, LAYER_OPAQUE, topFace, glm::vec4(0, 1, 0, 0), blockFaceUVs.at(t).at(YPOS), 0.f);
+            // Generated water fills every column up to y = 131
+            if (heights[s] < 131) {
+                const glm::vec3 waterFace[4] = {glm::vec3(x0, 132.f, z0), glm::vec3(x1, 132.f, z0),
+                                                glm::vec3(x1, 132.f, z1), glm::vec3(x0, 132.f, z1)};
+                pushQuad(&column, LAYER_TRANSLUCENT, waterFace, glm::vec4(0, 1, 0, 0), blockFaceUVs.at(WATER).at(YPOS), 1.f);
+            }
+
+            for (int d = 0; d < 4; d++) {
+                int ni = i + dirs[d].x, nj = j + dirs[d].y;
+                float bottom = heights[(ni + 1) + stride * (nj + 1)] + 1.f;
+                // A neighbor in another column may be drawn at another
+                // level or in full detail, so edges always get a skirt
+                bool edge = ni / cellsPerColumn != i / cellsPerColumn || nj / cellsPerColumn != j / cellsPerColumn
+                        || ni < 0 || nj < 0;
+                if (edge) {
+                    bottom = std::min(bottom, top - LODSKIRT);
+                }
+                if (bottom >= top) {
+                    continue;
+                }
+                glm::vec3 a, b;
+                switch (faces[d]) {
+                case XPOS: a = glm::vec3(x1, 0, z0); b = glm::vec3(x1, 0, z1); break;
+                case XNEG: a = glm::vec3(x0, 0, z1); b = glm::vec3(x0, 0, z0); break;
+                case ZPOS: a = glm::vec3(x1, 0, z1); b = glm::vec3(x0, 0, z1); break;
+                default:   a = glm::vec3(x0, 0, z0); b = glm::vec3(x1, 0, z0); break;
+                }
+                const glm::vec3 wall[4] = {glm::vec3(a.x, bottom, a.z), glm::vec3(b.x, bottom, b.z),
+                                           glm::vec3(b.x, top, b.z), glm::vec3(a.x, top, a.z)};
+                pushQuad(&column, LAYER_OPAQUE, wall, glm::vec4(dirs[d].x, 0, dirs[d].y, 0), blockFaceUVs.at(t).at(faces[d]), 0.f);
+            }
+        }
+    }
+    size_t bytes = 0;
+    for (const LODColumnMesh &column : out->columns) {
+        for (int layer = 0; layer < 2; layer++) {
+            bytes += column.vertices[layer].capacity() * sizeof(glm::vec4) + column.indices[layer].capacity() * sizeof(GLuint);
+        }
+    }
+    out->memory.set(bytes);
+}
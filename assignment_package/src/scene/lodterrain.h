@@ -0,0 +1,108 @@
+#pragma once
+#include "glm_includes.h"
+#include "smartpointerhelp.h"
+#include "memorystats.h"
+#include "terrainarena.h"
+#include <QMutex>
+#include <array>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+// Distant terrain is drawn as LODRINGS rings of zones around the
+// full-detail ones, each LODRINGWIDTH zones wide. Ring i samples the
+// height of every (2 << i)th column, i.e. it is decimated 2x, 4x, 8x...
+#define LODRINGS 3
+#define LODRINGWIDTH 3
+// At most this many LOD tiles are built on worker threads at once
+#define MAXLODJOBS 4
+// How far the walls on the edges of a LOD Chunk column reach below its
+// surface, to hide cracks against neighbors of another level
+#define LODSKIRT 8
+
+class Terrain;
+
+// The decimated mesh of one 16 x 16 Chunk column
+struct LODColumnMesh {
+    // Opaque and translucent layer
+    std::vector<glm::vec4> vertices[2];
+    std::vector<GLuint> indices[2];
+    // World-space Y range covered by the vertices; x > y if there are none
+    glm::vec2 yRange;
+
+    LODColumnMesh() : yRange(0.f, -1.f) {}
+};
+
+// The decimated mesh of one terrain generation zone, built by a LODWorker
+struct LODZoneMesh {
+    int64_t zone;
+    int level;
+    // Indexed (x / 16) + 4 * (z / 16) within the zone
+    std::array<LODColumnMesh, 16> columns;
+    // The columns' storage, counted as MEMORY_MESH_CPU
+    MemoryAccount memory;
+
+    LODZoneMesh() : zone(0), level(0), columns(), memory(MEMORY_MESH_CPU) {}
+};
+
+// One level of a zone uploaded to the TerrainArena
+struct LODTile {
+    ArenaSlice slices[16][2];
+    std::array<glm::vec2, 16> yRange;
+};
+
+// Streams heightfield meshes of the zones beyond the full-detail draw
+// distance, generated straight from ProGen's height and biome functions
+// without creating any Chunks. Tiles share Terrain's arena, so Terrain
+// can draw them in the same multi-draw calls as its Chunks, column by
+// column wherever no Chunk mesh covers the ground yet.
+class LODTerrain {
+private:
+    Terrain *mp_terrain;
+    TerrainArena *mp_arena;
+    // Uploaded tiles of each zone, one slot per ring level
+    std::unordered_map<int64_t, std::array<uPtr<LODTile>, LODRINGS>> m_tiles;
+    // (zone, level) of the tiles being built on worker threads
+    std::set<std::pair<int64_t, int>> m_pending;
+    std::vector<LODZoneMesh> m_finished;
+    QMutex m_finishedLock;
+    // Zone coordinates (in zones, not blocks) of the last update
+    glm::ivec2 m_center;
+    // Zone offsets within the outer ring, nearest first
+    std::vector<glm::ivec2> m_order;
+    size_t m_gpuBytes;
+
+    int distanceTo(int64_t zone) const;
+    // Zones per side covered by the outer ring, which follows the
+    // full-detail draw radius
+    int zoneRadius() const;
+    void releaseTile(uPtr<LODTile> &tile);
+    void uploadTile(LODZoneMesh &mesh);
+
+public:
+    LODTerrain(Terrain *terrain, TerrainArena *arena);
+    ~LODTerrain();
+
+    // Uploads the tiles finished since the last call, drops the ones
+    // that left the rings or were replaced by their desired level, and
+    // queues the nearest missing ones. Call on the GL thread.
+    void update(glm::vec3 position);
+    // Frees every tile
+    void clear();
+
+    // The level zone should be drawn at from the last update's
+    // position, or -1 if it needs no tile
+    int desiredLevel(int64_t zone) const;
+    // The uploaded tile of zone closest to its desired level, or null
+    const LODTile *tileFor(int64_t zone) const;
+    const std::unordered_map<int64_t, std::array<uPtr<LODTile>, LODRINGS>> &tiles() const;
+
+    // Distance in blocks from the player's zone to the edge of the
+    // outer ring
+    int radiusBlocks() const;
+    size_t gpuBytes() const;
+    int pendingCount() const;
+
+    // Builds the mesh of zone at the given level; safe to call from any thread
+    static void buildMesh(Terrain *terrain, int64_t zone, int level, LODZoneMesh *out);
+};
@@ -0,0 +1,28 @@
+#include "lodworker.h"
+#include "trace.h"
+
+LODWorker::LODWorker(Terrain *terrain,
+                     int64_t zone,
+                     int level,
+                     std::vector<LODZoneMesh> *mp_finished,
+                     QMutex *mutex)
+    :
+    mp_terrain(terrain),
+    m_zone(zone),
+    m_level(level),
+    mp_finished(mp_finished),
+    mp_mutex(mutex),
+    m_memory(MEMORY_JOB_QUEUES)
+{
+    m_memory.set(sizeof(LODWorker));
+}
+
+void LODWorker::run() {
+    TRACE_SCOPE("mesh LOD tile");
+    LODZoneMesh mesh;
+    LODTerrain::buildMesh(mp_terrain, m_zone, m_level, &mesh);
+
+    mp_mutex->lock();
+    mp_finished->push_back(std::move(mesh));
+    mp_mutex->unlock();
+}
@@ -0,0 +1,29 @@
+#ifndef LODWORKER_H
+#define LODWORKER_H
+
+#include <QRunnable>
+#include <QMutex>
+#include <scene/lodterrain.h>
+
+// Builds one LOD tile's mesh off the GL thread
+class LODWorker : public QRunnable
+{
+private:
+    Terrain *mp_terrain;
+    int64_t m_zone;
+    int m_level;
+    std::vector<LODZoneMesh> *mp_finished;
+    QMutex *mp_mutex;
+    // This job while it waits for or runs on the thread pool
+    MemoryAccount m_memory;
+
+public:
+
+    LODWorker(Terrain *terrain,
+              int64_t zone,
+              int level,
+              std::vector<LODZoneMesh> *mp_finished,
+              QMutex *mutex);
+    void run() override;
+};
+#endif // LODWORKER_H
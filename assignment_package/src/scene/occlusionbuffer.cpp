@@ -0,0 +1,147 @@
+#include "occlusionbuffer.h"
+#include <algorithm>
+
+// Clip-space w below which a corner counts as behind the camera
+static const float NEAR_W = 0.1f;
+
+// The 12 triangles of a box, as indices into the corners from projectBox
+static const int BOX_TRIANGLES[12][3] = {
+    {0, 1, 3}, {0, 3, 2}, {4, 6, 7}, {4, 7, 5}, // x = min, x = max
+    {0, 4, 5}, {0, 5, 1}, {2, 3, 7}, {2, 7, 6}, // y = min, y = max
+    {0, 2, 6}, {0, 6, 4}, {1, 5, 7}, {1, 7, 3}  // z = min, z = max
+};
+
+OcclusionBuffer::OcclusionBuffer()
+    : m_viewProj(), m_depth(WIDTH * HEIGHT, 1.f), m_occluders(0), m_pool()
+{
+    m_pool.setMaxThreadCount(BANDS);
+}
+
+void OcclusionBuffer::begin(const glm::mat4 &viewProj) {
+    m_viewProj = viewProj;
+    for (int v = 0; v < 3; v++) {
+        m_x[v].clear();
+        m_y[v].clear();
+        m_z[v].clear();
+    }
+    m_occluders = 0;
+}
+
+bool OcclusionBuffer::projectBox(glm::vec3 min, glm::vec3 max, glm::vec3 *out_corners) const {
+    // Corner i has x from bit 2, y from bit 1 and z from bit 0
+    for (int i = 0; i < 8; i++) {
+        glm::vec4 p(i & 4 ? max.x : min.x, i & 2 ? max.y : min.y, i & 1 ? max.z : min.z, 1.f);
+        glm::vec4 clip = m_viewProj * p;
+        if (clip.w < NEAR_W) {
+            return false;
+        }
+        glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        out_corners[i] = glm::vec3((ndc.x * 0.5f + 0.5f) * WIDTH,
+                                   (ndc.y * 0.5f + 0.5f) * HEIGHT,
+                                   ndc.z * 0.5f + 0.5f);
+    }
+    return true;
+}
+
+void OcclusionBuffer::addOccluder(glm::vec3 min, glm::vec3 max) {
+    glm::vec3 corners[8];
+    if (!projectBox(min, max, corners)) {
+        return;
+    }
+    m_occluders++;
+    for (const int *t : BOX_TRIANGLES) {
+        for (int v = 0; v < 3; v++) {
+            m_x[v].push_back(corners[t[v]].x);
+            m_y[v].push_back(corners[t[v]].y);
+            m_z[v].push_back(corners[t[v]].z);
+        }
+    }
+}
+
+void OcclusionBuffer::rasterize() {
+    std::fill(m_depth.begin(), m_depth.end(), 1.f);
+    if (m_x[0].empty()) {
+        return;
+    }
+    for (int band = 1; band < BANDS; band++) {
+        m_pool.start([this, band]() { rasterizeBand(band); });
+    }
+    rasterizeBand(0);
+    m_pool.waitForDone();
+}
+
+void OcclusionBuffer::rasterizeBand(int band) {
+    const int bandMinY = band * HEIGHT / BANDS;
+    const int bandMaxY = (band + 1) * HEIGHT / BANDS;
+    size_t n = m_x[0].size();
+    for (size_t t = 0; t < n; t++) {
+        float x0 = m_x[0][t], y0 = m_y[0][t], z0 = m_z[0][t];
+        float x1 = m_x[1][t], y1 = m_y[1][t], z1 = m_z[1][t];
+        float x2 = m_x[2][t], y2 = m_y[2][t], z2 = m_z[2][t];
+        float area = (x1 - x0) * (y2 - y0) - (x2 - x0) * (y1 - y0);
+        if (std::abs(area) < 1e-6f) {
+            continue;
+        }
+        int minX = std::max(static_cast<int>(std::floor(std::min({x0, x1, x2}))), 0);
+        int maxX = std::min(static_cast<int>(std::ceil(std::max({x0, x1, x2}))), WIDTH - 1);
+        int minY = std::max(static_cast<int>(std::floor(std::min({y0, y1, y2}))), bandMinY);
+        int maxY = std::min(static_cast<int>(std::ceil(std::max({y0, y1, y2}))), bandMaxY - 1);
+        if (minX > maxX || minY > maxY) {
+            continue;
+        }
+        // Edge functions normalized so they are positive inside and
+        // sum to one, which makes them barycentric weights for depth
+        float inv = 1.f / area;
+        for (int y = minY; y <= maxY; y++) {
+            float py = y + 0.5f;
+            float *row = &m_depth[y * WIDTH];
+            for (int x = minX; x <= maxX; x++) {
+                float px = x + 0.5f;
+                float w0 = ((x1 - px) * (y2 - py) - (x2 - px) * (y1 - py)) * inv;
+                float w1 = ((x2 - px) * (y0 - py) - (x0 - px) * (y2 - py)) * inv;
+                float w2 = 1.f - w0 - w1;
+                float z = w0 * z0 + w1 * z1 + w2 * z2;
+                // Select rather than branch so the loop vectorizes
+                bool inside = w0 >= 0 && w1 >= 0 && w2 >= 0;
+                row[x] = inside ? std::min(row[x], z) : row[x];
+            }
+        }
+    }
+}
+
+bool OcclusionBuffer::isVisible(glm::vec3 min, glm::vec3 max) const {
+    glm::vec3 corners[8];
+    if (!projectBox(min, max, corners)) {
+        return true;
+    }
+    glm::vec3 lo = corners[0], hi = corners[0];
+    for (const glm::vec3 &c : corners) {
+        lo = glm::min(lo, c);
+        hi = glm::max(hi, c);
+    }
+    // Every pixel the box's footprint touches
+    int minX = std::max(static_cast<int>(std::floor(lo.x)), 0);
+    int maxX = std::min(static_cast<int>(std::ceil(hi.x)), WIDTH - 1);
+    int minY = std::max(static_cast<int>(std::floor(lo.y)), 0);
+    int maxY = std::min(static_cast<int>(std::ceil(hi.y)), HEIGHT - 1);
+    if (minX > maxX || minY > maxY) {
+        return true;
+    }
+    for (int y = minY; y <= maxY; y++) {
+        const float *row = &m_depth[y * WIDTH];
+        for (int x = minX; x <= maxX; x++) {
+            if (row[x] >= lo.z) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+int OcclusionBuffer::occluderCount() const {
+    return m_occluders;
+}
+
+int OcclusionBuffer::triangleCount() const {
+    return m_x[0].size();
+}
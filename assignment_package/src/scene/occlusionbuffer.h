@@ -0,0 +1,49 @@
+#pragma once
+#include "glm_includes.h"
+#include <QThreadPool>
+#include <vector>
+
+// A small software depth buffer for occlusion culling on the CPU.
+// Each frame, large boxes known to be completely solid (see
+// Chunk::occluderSlabs) are rasterized into it, and then the bounding
+// boxes of Chunks can be tested against it: a box whose nearest point
+// is behind the occluders over its whole screen footprint is hidden.
+// Rasterization splits the screen into horizontal bands that are
+// filled in parallel.
+class OcclusionBuffer {
+public:
+    static const int WIDTH = 256;
+    static const int HEIGHT = 128;
+    static const int BANDS = 4;
+
+private:
+    glm::mat4 m_viewProj;
+    // Depth in [0, 1] per pixel, row-major from the bottom-left
+    std::vector<float> m_depth;
+    // Screen-space triangles waiting to be rasterized, one array per
+    // vertex component so that setup stays in straight-line loops
+    std::vector<float> m_x[3], m_y[3], m_z[3];
+    int m_occluders;
+    QThreadPool m_pool;
+
+    // Projects a box's corners to screen space. Returns false if any
+    // corner is behind the near plane.
+    bool projectBox(glm::vec3 min, glm::vec3 max, glm::vec3 *out_corners) const;
+    void rasterizeBand(int band);
+
+public:
+    OcclusionBuffer();
+
+    // Starts a new frame seen through viewProj, dropping all occluders
+    void begin(const glm::mat4 &viewProj);
+    // Queues a box that is entirely solid. Boxes crossing the near
+    // plane are skipped, which is always safe.
+    void addOccluder(glm::vec3 min, glm::vec3 max);
+    // Rasterizes every queued occluder into the depth buffer
+    void rasterize();
+    // Whether any part of the box might be in front of the occluders
+    bool isVisible(glm::vec3 min, glm::vec3 max) const;
+
+    int occluderCount() const;
+    int triangleCount() const;
+};
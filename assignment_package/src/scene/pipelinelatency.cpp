@@ -0,0 +1,128 @@
+#include "pipelinelatency.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+int64_t pipelineNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+LatencyHistogram::LatencyHistogram()
+    : m_counts(), m_count(0), m_sumMs(0.0), m_maxMs(0.f)
+{}
+
+void LatencyHistogram::add(float ms) {
+    int bucket = 0;
+    while (bucket < LATENCYBUCKETS - 1 && ms > bucketUpperMs(bucket)) {
+        bucket++;
+    }
+    m_counts[bucket]++;
+    m_count++;
+    m_sumMs += ms;
+    m_maxMs = std::max(m_maxMs, ms);
+}
+
+uint64_t LatencyHistogram::count() const {
+    return m_count;
+}
+
+uint64_t LatencyHistogram::bucketCount(int bucket) const {
+    return m_counts[bucket];
+}
+
+float LatencyHistogram::meanMs() const {
+    return m_count == 0 ? 0.f : static_cast<float>(m_sumMs / m_count);
+}
+
+float LatencyHistogram::maxMs() const {
+    return m_maxMs;
+}
+
+float LatencyHistogram::percentileMs(float p) const {
+    if (m_count == 0) {
+        return 0.f;
+    }
+    uint64_t rank = static_cast<uint64_t>(p * m_count + 0.5f);
+    uint64_t seen = 0;
+    for (int i = 0; i < LATENCYBUCKETS - 1; i++) {
+        seen += m_counts[i];
+        if (seen >= rank) {
+            return std::min(bucketUpperMs(i), m_maxMs);
+        }
+    }
+    return m_maxMs;
+}
+
+float LatencyHistogram::bucketUpperMs(int bucket) {
+    return LATENCYFIRSTBUCKETMS * static_cast<float>(1 << bucket);
+}
+
+PipelineLatency::PipelineLatency()
+    : m_steps(), m_endToEnd()
+{}
+
+void PipelineLatency::record(const std::array<int64_t, PIPELINESTAMPS> &stamps) {
+    for (int i = 0; i < PIPELINESTAMPS - 1; i++) {
+        m_steps[i].add((stamps[i + 1] - stamps[i]) / 1e6f);
+    }
+    m_endToEnd.add((stamps[STAMP_UPLOADED] - stamps[STAMP_REQUESTED]) / 1e6f);
+}
+
+const LatencyHistogram &PipelineLatency::endToEnd() const {
+    return m_endToEnd;
+}
+
+std::string PipelineLatency::status() const {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1);
+    out << std::left << std::setw(10) << "step" << std::right << std::setw(6) << "n"
+        << std::setw(8) << "mean" << std::setw(8) << "p50" << std::setw(8) << "p95"
+        << std::setw(8) << "p99" << std::setw(8) << "max";
+    for (int i = 0; i <= PIPELINESTAMPS - 1; i++) {
+        const LatencyHistogram &h = i < PIPELINESTAMPS - 1 ? m_steps[i] : m_endToEnd;
+        out << "\n" << std::left << std::setw(10) << stepName(i) << std::right << std::setw(6) << h.count()
+            << std::setw(8) << h.meanMs() << std::setw(8) << h.percentileMs(0.5f)
+            << std::setw(8) << h.percentileMs(0.95f) << std::setw(8) << h.percentileMs(0.99f)
+            << std::setw(8) << h.maxMs();
+    }
+    return out.str();
+}
+
+bool PipelineLatency::writeCSV(const std::string &path) const {
+    std::ofstream out(path);
+    if (!out) {
+        return false;
+    }
+    out << "bucket upper ms";
+    for (int i = 0; i <= PIPELINESTAMPS - 1; i++) {
+        out << "," << stepName(i);
+    }
+    out << "\n";
+    for (int b = 0; b < LATENCYBUCKETS; b++) {
+        // The last bucket has no upper edge
+        if (b < LATENCYBUCKETS - 1) {
+            out << LatencyHistogram::bucketUpperMs(b);
+        } else {
+            out << "inf";
+        }
+        for (int i = 0; i < PIPELINESTAMPS - 1; i++) {
+            out << "," << m_steps[i].bucketCount(b);
+        }
+        out << "," << m_endToEnd.bucketCount(b) << "\n";
+    }
+    return bool(out);
+}
+
+const char *PipelineLatency::stepName(int step) {
+    switch (step) {
+    case STAMP_REQUESTED: return "generate";
+    case STAMP_GENERATED: return "river";
+    case STAMP_RIVER: return "mesh";
+    case STAMP_MESHED: return "hand off";
+    case STAMP_UPLOAD_QUEUED: return "upload";
+    default: return "total";
+    }
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <string>
+
+// Where the H key writes the histograms to
+#define LATENCYCSVPATH "chunk_latency.csv"
+// Histogram buckets; bucket i counts latencies up to
+// LATENCYFIRSTBUCKETMS * 2^i, and the last one everything longer
+#define LATENCYBUCKETS 18
+#define LATENCYFIRSTBUCKETMS 0.125f
+
+// Points a Chunk passes on its way from being requested to being drawable
+enum PipelineStamp : unsigned char {
+    STAMP_REQUESTED,     // its zone was found missing by checkExpansion
+    STAMP_GENERATED,     // a BlockTypeWorker generated or loaded its blocks
+    STAMP_RIVER,         // rivers were applied to its zone
+    STAMP_MESHED,        // a VBOWorker built its mesh
+    STAMP_UPLOAD_QUEUED, // the mesh was handed to the GL thread
+    STAMP_UPLOADED,      // the mesh was uploaded and can be drawn
+    PIPELINESTAMPS
+};
+
+// Nanoseconds on the steady clock the stamps are taken with
+int64_t pipelineNowNs();
+
+// Counts of latencies in exponentially growing buckets, which keeps
+// both sub-millisecond stages and multi-second stalls readable
+class LatencyHistogram {
+private:
+    std::array<uint64_t, LATENCYBUCKETS> m_counts;
+    uint64_t m_count;
+    double m_sumMs;
+    float m_maxMs;
+
+public:
+    LatencyHistogram();
+
+    void add(float ms);
+    uint64_t count() const;
+    uint64_t bucketCount(int bucket) const;
+    float meanMs() const;
+    float maxMs() const;
+    // Upper edge of the bucket holding the p-th fraction of samples, so
+    // at least that fraction took no longer than the returned time
+    float percentileMs(float p) const;
+    static float bucketUpperMs(int bucket);
+};
+
+// Latency of every step between two consecutive stamps and of the
+// whole way from requested to uploaded, over all Chunks so far
+class PipelineLatency {
+private:
+    std::array<LatencyHistogram, PIPELINESTAMPS - 1> m_steps;
+    LatencyHistogram m_endToEnd;
+
+public:
+    PipelineLatency();
+
+    // Adds a Chunk that went through every stamp
+    void record(const std::array<int64_t, PIPELINESTAMPS> &stamps);
+    const LatencyHistogram &endToEnd() const;
+
+    // One line per step plus one for end to end: count, mean, p50, p95,
+    // p99 and max milliseconds
+    std::string status() const;
+    // Writes every histogram as CSV, one row per bucket
+    bool writeCSV(const std::string &path) const;
+
+    // Name of the step that ends at stamp step + 1
+    static const char *stepName(int step);
+};
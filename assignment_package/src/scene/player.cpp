@@ -26,8 +26,16 @@ Player::~Player()
 {}
 
 void Player::tick(float dT, InputBundle &input) {
+    applyInputs(input);
+    simulate(dT);
+}
+
+void Player::applyInputs(InputBundle &input) {
     processInputs(input);
     rotateCamera(input);
+}
+
+void Player::simulate(float dT) {
     computePhysics(dT, mcr_terrain);
     updateLookAtBlock();
     m_animation.tick();
@@ -118,55 +126,6 @@ void Player::processInputs(InputBundle &inputs) {
 
 }
 
-bool gridMarch(glm::vec3 rayOrigin, glm::vec3 rayDirection, const Terrain &terrain, float *out_dist, glm::ivec3 *out_blockHit) {
-    float maxLen = glm::length(rayDirection); // Farthest we search
-    glm::ivec3 currCell = glm::ivec3(glm::floor(rayOrigin));
-    rayDirection = glm::normalize(rayDirection); // Now all t values represent world dist.
-
-    float curr_t = 0.f;
-    while(curr_t < maxLen) {
-        float min_t = glm::sqrt(3.f);
-        float interfaceAxis = -1; // Track axis for which t is smallest
-        for(int i = 0; i < 3; ++i) { // Iterate over the three axes
-            if(rayDirection[i] != 0) { // Is ray parallel to axis i?
-                float offset = glm::max(0.f, glm::sign(rayDirection[i])); // See slide 5
-                // If the player is *exactly* on an interface then
-                // they'll never move if they're looking in a negative direction
-                if(currCell[i] == rayOrigin[i] && offset == 0.f) {
-                    offset = -1.f;
-                }
-                int nextIntercept = currCell[i] + offset;
-                float axis_t = (nextIntercept - rayOrigin[i]) / rayDirection[i];
-                axis_t = glm::min(axis_t, maxLen); // Clamp to max len to avoid super out of bounds errors
-                if(axis_t < min_t) {
-                    min_t = axis_t;
-                    interfaceAxis = i;
-                }
-            }
-        }
-        if(interfaceAxis == -1) {
-            throw std::out_of_range("interfaceAxis was -1 after the for loop in gridMarch!");
-        }
-        curr_t += min_t; // min_t is declared in slide 7 algorithm
-        rayOrigin += rayDirection * min_t;
-        glm::ivec3 offset = glm::ivec3(0,0,0);
-        // Sets it to 0 if sign is +, -1 if sign is -
-        offset[interfaceAxis] = glm::min(0.f, glm::sign(rayDirection[interfaceAxis]));
-        currCell = glm::ivec3(glm::floor(rayOrigin)) + offset;
-        // If currCell contains something other than EMPTY, return
-        // curr_t
-        BlockType cellType = terrain.getBlockAt(currCell.x, currCell.y, currCell.z);
-        if((cellType != EMPTY) && (cellType != WATER) && (cellType != LAVA)) {
-            *out_blockHit = currCell;
-            *out_dist = glm::min(maxLen, curr_t);
-            return true;
-        }
-    }
-    *out_dist = glm::min(maxLen, curr_t);
-    return false;
-}
-
-
 void Player::computePhysics(float dT, const Terrain &terrain) {
     // TODO: Update the Player's position based on its acceleration
     // and velocity, and also perform collision detection.
@@ -244,6 +203,19 @@ void Player::setCameraWidthHeight(unsigned int w, unsigned int h) {
     m_camera.setWidthHeight(w, h);
 }
 
+void Player::setPose(glm::vec3 pos, glm::vec3 forward) {
+    m_forward = glm::normalize(forward);
+    m_right = glm::normalize(glm::cross(m_forward, glm::vec3(0.f, 1.f, 0.f)));
+    m_up = glm::cross(m_right, m_forward);
+    m_position = pos;
+    m_velocity = glm::vec3(0.f);
+    m_acceleration = glm::vec3(0.f);
+    m_camera.m_forward = m_forward;
+    m_camera.m_right = m_right;
+    m_camera.m_up = m_up;
+    m_camera.m_position = pos + glm::vec3(0.f, 1.5f, 0.f);
+}
+
 void Player::moveAlongVector(glm::vec3 dir) {
     Entity::moveAlongVector(dir);
     m_camera.moveAlongVector(dir);
@@ -369,30 +341,25 @@ void Player::removeBlock(){
         mcr_terrain.setBlockAt(outBlock.x, outBlock.y, outBlock.z, EMPTY);
         Chunk *c = mcr_terrain.getChunkAt(outBlock.x, outBlock.z).get();
         if (c) {
-            c->createVBOdata();
-            c->sendVBOdata();
+            mcr_terrain.remeshChunk(c);
         }
     }
 
     if (mcr_terrain.getChunkAt(outBlock.x - 16, outBlock.z).get())
     {
-        mcr_terrain.getChunkAt(outBlock.x - 16, outBlock.z)->createVBOdata();
-        mcr_terrain.getChunkAt(outBlock.x - 16, outBlock.z)->sendVBOdata();
+        mcr_terrain.remeshChunk(mcr_terrain.getChunkAt(outBlock.x - 16, outBlock.z).get());
     }
     if (mcr_terrain.getChunkAt(outBlock.x, outBlock.z - 16).get())
     {
-        mcr_terrain.getChunkAt(outBlock.x, outBlock.z - 16)->createVBOdata();
-        mcr_terrain.getChunkAt(outBlock.x, outBlock.z - 16)->sendVBOdata();
+        mcr_terrain.remeshChunk(mcr_terrain.getChunkAt(outBlock.x, outBlock.z - 16).get());
     }
     if (mcr_terrain.getChunkAt(outBlock.x + 16, outBlock.z).get())
     {
-        mcr_terrain.getChunkAt(outBlock.x + 16, outBlock.z)->createVBOdata();
-        mcr_terrain.getChunkAt(outBlock.x + 16, outBlock.z)->sendVBOdata();
+        mcr_terrain.remeshChunk(mcr_terrain.getChunkAt(outBlock.x + 16, outBlock.z).get());
     }
     if (mcr_terrain.getChunkAt(outBlock.x, outBlock.z + 16).get())
     {
-        mcr_terrain.getChunkAt(outBlock.x, outBlock.z + 16)->createVBOdata();
-        mcr_terrain.getChunkAt(outBlock.x, outBlock.z + 16)->sendVBOdata();
+        mcr_terrain.remeshChunk(mcr_terrain.getChunkAt(outBlock.x, outBlock.z + 16).get());
     }
 
 }
@@ -432,8 +399,7 @@ void Player::addBlock(){
             c = mcr_terrain.getChunkAt(outBlock.x, outBlock.z).get();
         }
         if (c){
-            c->createVBOdata();
-            c->sendVBOdata();
+            mcr_terrain.remeshChunk(c);
         }
     }
 }
@@ -41,6 +41,13 @@ public:
     void setCameraWidthHeight(unsigned int w, unsigned int h);
 
     void tick(float dT, InputBundle &input) override;
+    // The two halves of tick, so that they can be timed apart: turning
+    // the inputs into acceleration and rotation, then moving
+    void applyInputs(InputBundle &input);
+    void simulate(float dT);
+    // Places the player and its camera at pos looking along forward,
+    // at rest; for scripted camera paths
+    void setPose(glm::vec3 pos, glm::vec3 forward);
 
     // Player overrides all of Entity's movement
     // functions so that it transforms its camera
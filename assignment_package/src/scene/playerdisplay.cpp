@@ -553,8 +553,6 @@ void MyGL::renderThirdPersonPlayer()
         model = glm::translate(model, m_player.mcr_position - m_displayedPlayer.m_position);
         model = model * m_player.getRotationMatrix();
         m_progPlayer.setModelMatrix(model);
-        m_progPlayer.setViewProjMatrix(m_player.mcr_camera.getViewProj());
-        m_progPlayer.setTimeElp(m_timeElapsed);
         m_progPlayer.drawInterleaved(m_displayedPlayer, 0, 1);
     }
 }
@@ -0,0 +1,115 @@
+#include "regionfile.h"
+#include <algorithm>
+#include <iostream>
+
+static const char REGION_MAGIC[4] = {'M', 'M', 'R', 'G'};
+static const uint32_t REGION_VERSION = 1;
+static const uint32_t HEADER_SIZE = 8 + 1024 * 8;
+
+static void putU32(unsigned char *p, uint32_t v) {
+    p[0] = v & 0xff;
+    p[1] = (v >> 8) & 0xff;
+    p[2] = (v >> 16) & 0xff;
+    p[3] = (v >> 24) & 0xff;
+}
+
+static uint32_t getU32(const unsigned char *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+RegionFile::RegionFile(const std::string &path)
+    : m_path(path), m_file(), m_entries(), m_end(HEADER_SIZE)
+{
+    m_entries.fill({0, 0});
+    m_file.open(path, std::ios::in | std::ios::out | std::ios::binary);
+    if (m_file.is_open()) {
+        std::vector<unsigned char> header(HEADER_SIZE);
+        m_file.read(reinterpret_cast<char*>(header.data()), HEADER_SIZE);
+        if (m_file.gcount() == HEADER_SIZE &&
+                std::equal(REGION_MAGIC, REGION_MAGIC + 4, header.begin()) &&
+                getU32(&header[4]) == REGION_VERSION) {
+            for (int i = 0; i < 1024; i++) {
+                m_entries[i].offset = getU32(&header[8 + 8 * i]);
+                m_entries[i].length = getU32(&header[8 + 8 * i + 4]);
+                if (m_entries[i].length > 0) {
+                    m_end = std::max(m_end, m_entries[i].offset + m_entries[i].length);
+                }
+            }
+            return;
+        }
+        std::cout << "Region file " << path << " is corrupt, starting it over" << std::endl;
+        m_file.close();
+    }
+
+    // Create a fresh file with an empty header
+    m_file.open(path, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!m_file.is_open()) {
+        std::cout << "Could not open region file " << path << std::endl;
+        return;
+    }
+    std::vector<unsigned char> header(HEADER_SIZE, 0);
+    std::copy(REGION_MAGIC, REGION_MAGIC + 4, header.begin());
+    putU32(&header[4], REGION_VERSION);
+    m_file.write(reinterpret_cast<const char*>(header.data()), HEADER_SIZE);
+    m_file.flush();
+}
+
+bool RegionFile::isOpen() const {
+    return m_file.is_open();
+}
+
+bool RegionFile::hasChunk(int slot) const {
+    return m_entries[slot].length > 0;
+}
+
+bool RegionFile::readChunk(int slot, std::vector<unsigned char> *out) {
+    const Entry &e = m_entries[slot];
+    if (!m_file.is_open() || e.length == 0) {
+        return false;
+    }
+    out->resize(e.length);
+    m_file.seekg(e.offset);
+    m_file.read(reinterpret_cast<char*>(out->data()), e.length);
+    if (static_cast<uint32_t>(m_file.gcount()) != e.length) {
+        m_file.clear();
+        return false;
+    }
+    return true;
+}
+
+void RegionFile::writeChunk(int slot, const std::vector<unsigned char> &payload) {
+    if (!m_file.is_open() || payload.empty()) {
+        return;
+    }
+    Entry &e = m_entries[slot];
+    if (payload.size() > e.length) {
+        // Old space is abandoned; region files are small enough that
+        // the fragmentation is not worth compacting
+        e.offset = m_end;
+        m_end += payload.size();
+    }
+    e.length = payload.size();
+    m_file.seekp(e.offset);
+    m_file.write(reinterpret_cast<const char*>(payload.data()), payload.size());
+    writeHeaderEntry(slot);
+}
+
+void RegionFile::writeHeaderEntry(int slot) {
+    unsigned char entry[8];
+    putU32(entry, m_entries[slot].offset);
+    putU32(entry + 4, m_entries[slot].length);
+    m_file.seekp(8 + 8 * slot);
+    m_file.write(reinterpret_cast<const char*>(entry), 8);
+}
+
+void RegionFile::flush() {
+    if (m_file.is_open()) {
+        m_file.flush();
+    }
+}
+
+int RegionFile::slotOf(int chunkX, int chunkZ) {
+    int x = ((chunkX % REGION_CHUNKS) + REGION_CHUNKS) % REGION_CHUNKS;
+    int z = ((chunkZ % REGION_CHUNKS) + REGION_CHUNKS) % REGION_CHUNKS;
+    return x + REGION_CHUNKS * z;
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// One region file holds the saved payloads of a 32 x 32 area of Chunks
+// (512 x 512 blocks of the world). The file starts with a fixed-size
+// header holding an (offset, length) entry for each of the 1024 Chunk
+// slots, so a single Chunk can be read or rewritten without touching
+// the rest of the file:
+//
+//   "MMRG" | version | 1024 x (offset, length) | payloads ...
+//
+// All integers are little-endian uint32. A length of 0 means the slot
+// has never been written. RegionFile is not thread-safe; WorldStore
+// serializes access to it.
+class RegionFile {
+private:
+    struct Entry {
+        uint32_t offset;
+        uint32_t length;
+    };
+
+    std::string m_path;
+    std::fstream m_file;
+    std::array<Entry, 1024> m_entries;
+    uint32_t m_end; // Offset of the first byte past the last payload
+
+    void writeHeaderEntry(int slot);
+
+public:
+    static const int REGION_CHUNKS = 32;
+
+    // Opens the region file at path, creating it if it does not exist
+    RegionFile(const std::string &path);
+
+    bool isOpen() const;
+    bool hasChunk(int slot) const;
+    // Reads the payload stored in slot. Returns false if there is none.
+    bool readChunk(int slot, std::vector<unsigned char> *out);
+    // Stores payload in slot, in place if it fits in the old payload's
+    // space and at the end of the file otherwise
+    void writeChunk(int slot, const std::vector<unsigned char> &payload);
+    void flush();
+
+    // Slot of the Chunk with the given chunk-space coordinates
+    // (world coordinates / 16) within its region
+    static int slotOf(int chunkX, int chunkZ);
+};
@@ -1,19 +1,24 @@
 #include "river.h"
 
-River::River(Terrain *m_terrain, int terrainx, int terrainz) :
+River::River(World *m_terrain, int terrainx, int terrainz) :
     m_terrain(m_terrain), terrainx(terrainx), terrainz(terrainz), turtles(std::stack<Turtle>()),
-    grammer("FX"), currTurtle(nullptr), iteration(2), length(10), depth(0), drawingRules()
+    grammer("FX"), currTurtle(nullptr), iteration(2), length(10), depth(0), drawingRules(),
+    m_rng(static_cast<uint32_t>(terrainx * 73856093) ^ static_cast<uint32_t>(terrainz * 19349663))
 {
     for (int i = 0; i < iteration; i++) {
         expand();
     }
 }
 
+double River::random() {
+    return std::uniform_real_distribution<double>(0.0, 1.0)(m_rng);
+}
+
 void River::expand() {
     std::string temp = "";
     for (int i = 0; i < grammer.length(); i++) {
         if (grammer[i] == 'X') {
-            double random = ((double) rand() / (RAND_MAX));
+            double random = this->random();
             if (random < 0.5) {
                 temp.append("[+FX]-FX");
             } else {
@@ -34,7 +39,7 @@ void River::goForward() {
     int riverLength = std::max((int) length * depth, 12);
     float newx, newz;
     int rotatedx, rotatedz;
-    double random = ((double) rand() / (RAND_MAX));
+    double random = this->random();
     if (random > 0.5) random = 1;
     else random = -1;
     for (int i = 0; i < riverLength; i++) {
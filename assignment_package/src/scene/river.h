@@ -4,17 +4,15 @@
 #include <random>
 #include <iostream>
 #include "turtle.h"
-#include "terrain.h"
-
-class Terrain;
+#include "world.h"
 
 const float PI = 3.141592653589793238463;
 
 class River
 {
 public:
-    River(Terrain*, int, int);
-    Terrain *m_terrain;
+    River(World*, int, int);
+    World *m_terrain;
     std::stack<Turtle> turtles;
     std::string grammer;
     Turtle *currTurtle;
@@ -25,6 +23,11 @@ public:
     int length;
     int depth;
     std::map<char, Rule> drawingRules;
+    // Seeded from the zone coordinates so that a zone always gets the
+    // same river, which edit-delta saves rely on
+    std::mt19937 m_rng;
+    // Uniform random number in [0, 1)
+    double random();
     void expand();
     void draw();
     void colorNeighbors(int, int, int, int);
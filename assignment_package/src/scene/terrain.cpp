@@ -1,287 +1,380 @@
 #include "terrain.h"
+#include "river.h"
+#include "trace.h"
 #include <iostream>
 #include <stdexcept>
+#include <algorithm>
+#include <array>
+#include <chrono>
 
 Terrain::Terrain(OpenGLContext *context)
-    : m_chunks(), m_generatedTerrain(), mp_context(context), progen(), mp_texture(nullptr)
+    : World(), m_cullBoxes(), m_cullChunks(), m_cullGrid(), m_cullGridIndex(), m_opaqueCandidates(), m_translucentCandidates(),
+      m_drawSetMinX(0), m_drawSetMinZ(0), m_drawSetSizeX(0), m_drawSetSizeZ(0), m_drawSetRevision(0), m_drawSetRebuilds(0),
+      m_cullVisible(),
+      m_visibility(), m_occlusionCulling(true), m_occlusionBuffer(), m_occluderOrder(), m_depthOcclusion(true),
+      m_drawStats(), m_shadowDrawStats(), m_lodBoxes(), m_lodSlices(), m_lodVisible(),
+      mp_context(context), mp_arena(nullptr), mp_lod(nullptr), m_lodEnabled(true), mp_texture(nullptr)
 {}
 
 Terrain::~Terrain() {
+    // Chunk meshes give their slices back to mp_arena, so it must outlive them
+    releaseChunks();
 }
 
-// Combine two 32-bit ints into one 64-bit int
-// where the upper 32 bits are X and the lower 32 bits are Z
-int64_t toKey(int x, int z) {
-    int64_t xz = 0xffffffffffffffff;
-    int64_t x64 = x;
-    int64_t z64 = z;
-
-    // Set all lower 32 bits to 1 so we can & with Z later
-    xz = (xz & (x64 << 32)) | 0x00000000ffffffff;
-
-    // Set all upper 32 bits to 1 so we can & with XZ
-    z64 = z64 | 0xffffffff00000000;
+void Terrain::createDrawArena() {
+    mp_arena = mkU<TerrainArena>(mp_context);
+    mp_arena->create();
+    mp_lod = mkU<LODTerrain>(this, mp_arena.get());
+}
 
-    // Combine
-    xz = xz & z64;
-    return xz;
+const TerrainArena *Terrain::drawArena() const {
+    return mp_arena.get();
 }
 
-glm::ivec2 toCoords(int64_t k) {
-    // Z is lower 32 bits
-    int64_t z = k & 0x00000000ffffffff;
-    // If the most significant bit of Z is 1, then it's a negative number
-    // so we have to set all the upper 32 bits to 1.
-    // Note the 8    V
-    if(z & 0x0000000080000000) {
-        z = z | 0xffffffff00000000;
+void Terrain::updateLOD(glm::vec3 position) {
+    if (mp_lod && m_lodEnabled) {
+        mp_lod->update(position);
     }
-    int64_t x = (k >> 32);
-
-    return glm::ivec2(x, z);
 }
 
-// Surround calls to this with try-catch if you don't know whether
-// the coordinates at x, y, z have a corresponding Chunk
-BlockType Terrain::getBlockAt(int x, int y, int z) const
-{
-    if(hasChunkAt(x, z)) {
-        // Just disallow action below or above min/max height,
-        // but don't crash the game over it.
-        if(y < 0 || y >= 256) {
-            return EMPTY;
-        }
-        const uPtr<Chunk> &c = getChunkAt(x, z);
-        glm::vec2 chunkOrigin = glm::vec2(floor(x / 16.f) * 16, floor(z / 16.f) * 16);
-        return c->getBlockAt(static_cast<unsigned int>(x - chunkOrigin.x),
-                             static_cast<unsigned int>(y),
-                             static_cast<unsigned int>(z - chunkOrigin.y));
-    }
-    else {
-        throw std::out_of_range("Coordinates " + std::to_string(x) +
-                                " " + std::to_string(y) + " " +
-                                std::to_string(z) + " have no Chunk!");
+void Terrain::setLODEnabled(bool enabled) {
+    m_lodEnabled = enabled;
+    if (!enabled && mp_lod) {
+        mp_lod->clear();
     }
 }
 
-BlockType Terrain::getBlockAt(glm::vec3 p) const {
-    return getBlockAt(p.x, p.y, p.z);
+bool Terrain::lodEnabled() const {
+    return m_lodEnabled;
 }
 
-void Terrain::setBlockAt(int x, int y, int z, BlockType t)
-{
-    if(hasChunkAt(x, z)) {
-        uPtr<Chunk> &c = getChunkAt(x, z);
-        glm::vec2 chunkOrigin = glm::vec2(floor(x / 16.f) * 16, floor(z / 16.f) * 16);
-        c->setBlockAt(static_cast<unsigned int>(x - chunkOrigin.x),
-                      static_cast<unsigned int>(y),
-                      static_cast<unsigned int>(z - chunkOrigin.y),
-                      t);
-    }
-    else {
-        throw std::out_of_range("Coordinates " + std::to_string(x) +
-                                " " + std::to_string(y) + " " +
-                                std::to_string(z) + " have no Chunk!");
-    }
+const LODTerrain *Terrain::lod() const {
+    return mp_lod.get();
 }
 
-bool Terrain::hasChunkAt(int x, int z) const {
-    // Map x and z to their nearest Chunk corner
-    // By flooring x and z, then multiplying by 16,
-    // we clamp (x, z) to its nearest Chunk-space corner,
-    // then scale back to a world-space location.
-    // Note that floor() lets us handle negative numbers
-    // correctly, as floor(-1 / 16.f) gives us -1, as
-    // opposed to (int)(-1 / 16.f) giving us 0 (incorrect!).
-    int xFloor = static_cast<int>(glm::floor(x / 16.f));
-    int zFloor = static_cast<int>(glm::floor(z / 16.f));
-    return m_chunks.find(toKey(16 * xFloor, 16 * zFloor)) != m_chunks.end();
+ChunkDrawable *Terrain::drawableFor(Chunk *c) {
+    ChunkDrawable *drawable = ChunkDrawable::of(c);
+    if (drawable == nullptr) {
+        uPtr<ChunkDrawable> attached = mkU<ChunkDrawable>(mp_context, mp_arena.get(), c, c->minX, c->minZ);
+        drawable = attached.get();
+        c->setRenderData(std::move(attached));
+    }
+    return drawable;
 }
 
-
-uPtr<Chunk>& Terrain::getChunkAt(int x, int z) {
-    int xFloor = static_cast<int>(glm::floor(x / 16.f));
-    int zFloor = static_cast<int>(glm::floor(z / 16.f));
-    return m_chunks[toKey(16 * xFloor, 16 * zFloor)];
+void Terrain::uploadChunk(ChunkVBOData &data) {
+    drawableFor(data.associated_chunk)->upload(data);
 }
 
+void Terrain::remeshChunk(Chunk *c) {
+    drawableFor(c)->createVBOdata();
+}
 
-const uPtr<Chunk>& Terrain::getChunkAt(int x, int z) const {
-    int xFloor = static_cast<int>(glm::floor(x / 16.f));
-    int zFloor = static_cast<int>(glm::floor(z / 16.f));
-    return m_chunks.at(toKey(16 * xFloor, 16 * zFloor));
+bool Terrain::isZoneMeshed(int64_t zone) const {
+    glm::ivec2 origin = toCoords(zone);
+    for (int i = 0; i < 64; i += 16) {
+        for (int j = 0; j < 64; j += 16) {
+            const Chunk *c = findChunk(origin.x + i, origin.y + j);
+            if (c == nullptr || ChunkDrawable::of(c) == nullptr || !ChunkDrawable::of(c)->hasMesh()) {
+                return false;
+            }
+        }
+    }
+    return true;
 }
 
-Chunk* Terrain::instantiateChunkAt(int x, int z) {
-    uPtr<Chunk> chunk = mkU<Chunk>(this->mp_context,x, z);
-    Chunk *cPtr = chunk.get();
-    m_chunks[toKey(x, z)] = std::move(chunk);
-    // Set the neighbor pointers of itself and its neighbors
-    if(hasChunkAt(x, z + 16)) {
-        auto &chunkNorth = m_chunks[toKey(x, z + 16)];
-        cPtr->linkNeighbor(chunkNorth, ZPOS);
+void Terrain::CreateInitialScene(glm::vec3 pos) {
+    int x = 64 * static_cast<int>(glm::floor(pos.x / 64.f));
+    int z = 64 * static_cast<int>(glm::floor(pos.z / 64.f)); //x and z represent the zone's position (lower left corner)
+    int64_t zone = toKey(x, z);
+    markZoneGenerated(zone);
+    markZonePending(zone);
+    // The same steps as a BlockTypeWorker's
+    if (!loadZone(x, z)) {
+        createTerrainZone(x, z);
+        River river(this, x, z);
+        if (river.random() < 0.15) {
+            river.draw();
+        }
+        applyZoneEdits(x, z);
     }
-    if(hasChunkAt(x, z - 16)) {
-        auto &chunkSouth = m_chunks[toKey(x, z - 16)];
-        cPtr->linkNeighbor(chunkSouth, ZNEG);
+
+    Chunk *spawn = getChunkAt(16 * static_cast<int>(glm::floor(pos.x / 16.f)),
+                              16 * static_cast<int>(glm::floor(pos.z / 16.f))).get();
+    remeshChunk(spawn);
+    markChunkUploaded(spawn);
+    m_chunksWithOnlyBlockDataLock.lock();
+    for (int i = 0; i < 64; i += 16) {
+        for (int j = 0; j < 64; j += 16) {
+            Chunk *c = getChunkAt(x + i, z + j).get();
+            if (c != spawn) {
+                m_chunksWithOnlyBlockData.push_back(c);
+            }
+        }
     }
-    if(hasChunkAt(x + 16, z)) {
-        auto &chunkEast = m_chunks[toKey(x + 16, z)];
-        cPtr->linkNeighbor(chunkEast, XPOS);
+    m_chunksWithOnlyBlockDataLock.unlock();
+}
+
+void Terrain::updateDrawSet(int minX, int minZ, int sizeX, int sizeZ) {
+    uint64_t revision = ChunkDrawable::meshRevision();
+    if (minX == m_drawSetMinX && minZ == m_drawSetMinZ && sizeX == m_drawSetSizeX && sizeZ == m_drawSetSizeZ
+            && revision == m_drawSetRevision) {
+        return;
     }
-    if(hasChunkAt(x - 16, z)) {
-        auto &chunkWest = m_chunks[toKey(x - 16, z)];
-        cPtr->linkNeighbor(chunkWest, XNEG);
+    m_drawSetMinX = minX;
+    m_drawSetMinZ = minZ;
+    m_drawSetSizeX = sizeX;
+    m_drawSetSizeZ = sizeZ;
+    m_drawSetRevision = revision;
+    m_drawSetRebuilds++;
+
+    m_cullBoxes.clear();
+    m_cullChunks.clear();
+    m_cullGrid.assign(sizeX * sizeZ, nullptr);
+    m_cullGridIndex.clear();
+    m_opaqueCandidates.clear();
+    m_translucentCandidates.clear();
+    for(int i = 0; i < sizeX; i++) {
+        for(int j = 0; j < sizeZ; j++) {
+            // Drawing only needs the GPU buffers, so don't decompress
+            Chunk *chunk = findChunk(minX + 16 * i, minZ + 16 * j);
+            ChunkDrawable *drawable = chunk ? ChunkDrawable::of(chunk) : nullptr;
+            if (drawable == nullptr || !drawable->hasMesh()) {
+                continue;
+            }
+            int candidate = m_cullChunks.size();
+            m_cullGrid[i + sizeX * j] = drawable->sectionConnectivity().data();
+            m_cullBoxes.push(drawable->boundsMin(), drawable->boundsMax());
+            m_cullChunks.push_back(chunk);
+            m_cullGridIndex.push_back(i + sizeX * j);
+            if (drawable->elemCount() > 0) {
+                m_opaqueCandidates.push_back(candidate);
+            }
+            if (drawable->transCount() > 0) {
+                m_translucentCandidates.push_back(candidate);
+            }
+        }
     }
-    return cPtr;
 }
 
-Chunk* Terrain::createChunkAt(int x, int z) {
-    uPtr<Chunk> chunk = mkU<Chunk>(mp_context,x,z);
-    Chunk *cPtr = chunk.get();
-    chunk->m_count = 0;
-    chunk->m_transCount = 0;
+void Terrain::draw(int minX, int maxX, int minZ, int maxZ, const glm::mat4 &viewProj, glm::vec3 eye,
+                   ShaderProgram *shaderProgram, bool shadow) {
+    // The shadow pass is timed as a whole
+    ProfileScope opaque(mp_context->profiler(), STAGE_TERRAIN_OPAQUE, !shadow);
+    int sizeX = (maxX - minX) / 16;
+    int sizeZ = (maxZ - minZ) / 16;
+    updateDrawSet(minX, minZ, sizeX, sizeZ);
+    Frustum frustum(viewProj);
+    frustum.cullAABBs(m_cullBoxes, &m_cullVisible);
 
-    m_chunks[toKey(x, z)] = std::move(chunk);
-    if(hasChunkAt(x, z + 16)) {
-        auto &chunkNorth = m_chunks[toKey(x, z + 16)];
-        cPtr->linkNeighbor(chunkNorth, ZPOS);
+    TerrainDrawStats &stats = shadow ? m_shadowDrawStats : m_drawStats;
+    stats = TerrainDrawStats();
+    // Chunks hidden from the camera can still cast shadows into view
+    bool occlusion = m_occlusionCulling && !shadow;
+    if (occlusion) {
+        m_visibility.traverse(m_cullGrid, minX, minZ, sizeX, sizeZ, eye, frustum);
     }
-    if(hasChunkAt(x, z - 16)) {
-        auto &chunkSouth = m_chunks[toKey(x, z - 16)];
-        cPtr->linkNeighbor(chunkSouth, ZNEG);
+    bool depthOcclusion = m_depthOcclusion && !shadow;
+    if (depthOcclusion) {
+        rasterizeOccluders(viewProj, eye);
+        stats.occluders = m_occlusionBuffer.occluderCount();
     }
-    if(hasChunkAt(x + 16, z)) {
-        auto &chunkEast = m_chunks[toKey(x + 16, z)];
-        cPtr->linkNeighbor(chunkEast, XPOS);
+    int64_t now = currentMSecs();
+    TerrainDrawList list = shadow ? LIST_SHADOW : LIST_OPAQUE;
+    if (mp_arena) {
+        mp_arena->clearCommands(list);
+        if (!shadow) {
+            mp_arena->clearCommands(LIST_TRANSLUCENT);
+        }
     }
-    if(hasChunkAt(x - 16, z)) {
-        auto &chunkWest = m_chunks[toKey(x - 16, z)];
-        cPtr->linkNeighbor(chunkWest, XNEG);
+    for (size_t i = 0; i < m_cullChunks.size(); i++) {
+        if (!m_cullVisible[i]) {
+            stats.culled++;
+            continue;
+        }
+        if (occlusion && !m_visibility.isChunkVisible(m_cullGridIndex[i])) {
+            m_cullVisible[i] = 0;
+            stats.occluded++;
+            continue;
+        }
+        Chunk *chunk = m_cullChunks[i];
+        const ChunkDrawable *drawable = ChunkDrawable::of(chunk);
+        if (depthOcclusion && !m_occlusionBuffer.isVisible(drawable->boundsMin(), drawable->boundsMax())) {
+            m_cullVisible[i] = 0;
+            stats.depthOccluded++;
+            continue;
+        }
+        stats.drawn++;
+        // Being in the light's view does not make a Chunk visible
+        if (!shadow) {
+            chunk->m_lastVisible = now;
+        }
     }
-    return cPtr;
-}
-
-void Terrain::createTerrainZone(int x, int z, bool createvbo) {
-    std::vector<Chunk*> newChunks;
-    for (int i = 0; i < 64; i += 16) {
-        for (int j = 0; j < 64; j += 16) {
-            if (!hasChunkAt(x + i, z + j)){
-                newChunks.push_back(instantiateChunkAt(x + i, z + j));
-            }
+    for (int i : m_opaqueCandidates) {
+        if (!m_cullVisible[i]) {
+            continue;
+        }
+        ChunkDrawable *drawable = ChunkDrawable::of(m_cullChunks[i]);
+        stats.triangles += drawable->elemCount() / 3;
+        if (mp_arena) {
+            mp_arena->addCommand(list, drawable->slice(LAYER_OPAQUE));
+        } else {
+            shaderProgram->drawInterleaved(*drawable, 0, 1);
+            stats.drawCalls++;
         }
     }
+    // Distant terrain is too coarse to cast useful shadows
+    if (mp_lod && m_lodEnabled && !shadow) {
+        addLODCommands(minX, maxX, minZ, maxZ, frustum, depthOcclusion, &stats);
+    }
+    if (mp_arena) {
+        stats.drawCalls += mp_arena->draw(list, LAYER_OPAQUE, shaderProgram);
+    }
+    if (shadow) {
+        return;
+    }
+    opaque.end();
+    ProfileScope translucent(mp_context->profiler(), STAGE_TERRAIN_TRANSLUCENT);
+    // Water goes after all opaque geometry so that it blends over it
+    for (int i : m_translucentCandidates) {
+        if (!m_cullVisible[i]) {
+            continue;
+        }
+        ChunkDrawable *drawable = ChunkDrawable::of(m_cullChunks[i]);
+        stats.triangles += drawable->transCount() / 3;
+        if (mp_arena) {
+            mp_arena->addCommand(LIST_TRANSLUCENT, drawable->slice(LAYER_TRANSLUCENT));
+        } else {
+            shaderProgram->drawTransInterleaved(*drawable, 0, 1);
+            stats.drawCalls++;
+        }
+    }
+    if (mp_arena) {
+        stats.drawCalls += mp_arena->draw(LIST_TRANSLUCENT, LAYER_TRANSLUCENT, shaderProgram);
+    }
+}
 
-    m_generatedTerrain.insert(toKey(x, z));
-
-    for (int i = 0; i < 64; i++) {
-        for (int j = 0; j < 64; j++) {
-            int curX = x + i;
-            int curZ = z + j;
-            std::vector<int> blockInfo = progen.getBlockHeight(curX, curZ);
-            int curY = blockInfo[0];
-            for (int k = 0; k <= curY; k++) {
-                setBlockAt(curX, k, curZ, getBlockTypeAtHeight(curX, k, curZ, blockInfo[1], curY));
+void Terrain::addLODCommands(int minX, int maxX, int minZ, int maxZ, const Frustum &frustum, bool depthOcclusion,
+                             TerrainDrawStats *stats) {
+    m_lodBoxes.clear();
+    m_lodSlices.clear();
+    for (const auto &zone : mp_lod->tiles()) {
+        const LODTile *tile = mp_lod->tileFor(zone.first);
+        if (tile == nullptr) {
+            continue;
+        }
+        glm::ivec2 origin = toCoords(zone.first);
+        for (int c = 0; c < 16; c++) {
+            int x = origin.x + 16 * (c & 3), z = origin.y + 16 * (c >> 2);
+            // Full Chunks replace the tile column by column as they are meshed
+            if (x >= minX && x < maxX && z >= minZ && z < maxZ
+                    && m_cullGrid[(x - minX) / 16 + m_drawSetSizeX * ((z - minZ) / 16)] != nullptr) {
+                continue;
             }
-            if (curY < 132) {
-                for (int t = curY + 1; t < 132; t++) {
-                    setBlockAt(curX, t, curZ, WATER);
-                }
+            glm::vec2 y = tile->yRange[c];
+            if (y.x > y.y) {
+                continue;
             }
+            m_lodBoxes.push(glm::vec3(x, y.x, z), glm::vec3(x + 16, y.y, z + 16));
+            m_lodSlices.push_back(tile->slices[c]);
         }
     }
-//    for (int i = 0; i < 64; i+=16) {
-//        for (int j = 0; j < 64; j+=16) {
-//            River river = River(this, x+i, z+j);
-//            river.draw();
-//        }
-//    }
-    if (createvbo) {
-        for (Chunk* c : newChunks){
-            c ->createVBOdata();
-            c->sendVBOdata();
+    frustum.cullAABBs(m_lodBoxes, &m_lodVisible);
+    for (size_t i = 0; i < m_lodSlices.size(); i++) {
+        if (!m_lodVisible[i]) {
+            continue;
+        }
+        glm::vec3 min(m_lodBoxes.minX[i], m_lodBoxes.minY[i], m_lodBoxes.minZ[i]);
+        glm::vec3 max(m_lodBoxes.maxX[i], m_lodBoxes.maxY[i], m_lodBoxes.maxZ[i]);
+        if (depthOcclusion && !m_occlusionBuffer.isVisible(min, max)) {
+            continue;
         }
+        const ArenaSlice *slices = m_lodSlices[i];
+        mp_arena->addCommand(LIST_OPAQUE, slices[LAYER_OPAQUE]);
+        mp_arena->addCommand(LIST_TRANSLUCENT, slices[LAYER_TRANSLUCENT]);
+        stats->lodColumns++;
+        stats->triangles += (slices[LAYER_OPAQUE].indexCount + slices[LAYER_TRANSLUCENT].indexCount) / 3;
     }
 }
 
-void Terrain::CreateInitialScene(glm::vec3 pos) {
-    int xFloor = static_cast<int>(glm::floor(pos.x / 64.f));
-    int zFloor = static_cast<int>(glm::floor(pos.z / 64.f));
-    int x = 64 * xFloor;
-    int z = 64 * zFloor; //x and z represent the chunk's position (lower left corner)
-    for (int i = x - 64; i < x + 65; i += 64) {
-        for (int j = z - 64; j < z + 65; j += 64) {
-            createTerrainZone(i, j, true);
+void Terrain::rasterizeOccluders(const glm::mat4 &viewProj, glm::vec3 eye) {
+    m_occluderOrder.clear();
+    for (size_t i = 0; i < m_cullChunks.size(); i++) {
+        if (m_cullVisible[i]) {
+            const ChunkDrawable *drawable = ChunkDrawable::of(m_cullChunks[i]);
+            glm::vec3 center = (drawable->boundsMin() + drawable->boundsMax()) * 0.5f;
+            glm::vec3 d = center - eye;
+            m_occluderOrder.push_back(std::make_pair(glm::dot(d, d), static_cast<int>(i)));
         }
     }
-}
+    std::sort(m_occluderOrder.begin(), m_occluderOrder.end());
 
-BlockType Terrain::getBlockTypeAtHeight(int x, int y, int z, int blockType, bool top) {
-    if (y == 0) {
-        return BEDROCK;
-    } else if (y < 25) {
-        return LAVA;
-    } else if (y < 118) {
-        if (progen.keepCave(x, y, z)) {
-            return STONE;
-        } else {
-            return EMPTY;
+    m_occlusionBuffer.begin(viewProj);
+    int added = 0;
+    for (const auto &o : m_occluderOrder) {
+        const Chunk *chunk = m_cullChunks[o.second];
+        const ChunkDrawable *drawable = ChunkDrawable::of(chunk);
+        for (int q = 0; q < 4 && added < MAXOCCLUDERS; q++) {
+            glm::vec2 slab = drawable->occluderSlabs()[q];
+            // Thin slabs hide little and cost as much as thick ones
+            if (slab.y - slab.x < 2.f) {
+                continue;
+            }
+            glm::vec3 min(chunk->minX + 8 * (q & 1), slab.x, chunk->minZ + 8 * (q >> 1));
+            m_occlusionBuffer.addOccluder(min, glm::vec3(min.x + 8, slab.y, min.z + 8));
+            added++;
         }
-    } else if (y < 120) {
-        return STONE;
-    } else if (y < 128) {
-        return SAND;
-    } else if (y < 160) {
-        if (blockType == 0) {
-            return DUNE;
+        if (added >= MAXOCCLUDERS) {
+            break;
         }
-        return top ? GRASS : DIRT;
-    } else if (y < 200) {
-        return STONE;
-    } else {
-        return top ? SNOW : STONE;
     }
+    m_occlusionBuffer.rasterize();
 }
 
-std::vector<int64_t> Terrain::checkExpansion(glm::vec3 position) {
+void Terrain::setDepthOcclusion(bool enabled) {
+    m_depthOcclusion = enabled;
+}
 
-    std::vector<int64_t> output;
-    int lowerLeftX = glm::floor(position.x / 64.0f);
-    int lowerLeftZ = glm::floor(position.z / 64.0f);
+bool Terrain::depthOcclusion() const {
+    return m_depthOcclusion;
+}
 
-    for (int z = -NUMZONETOWORK; z <= NUMZONETOWORK; z++) {
-        for (int x = -NUMZONETOWORK; x <= NUMZONETOWORK; x++) {
-            int64_t currTerrain = toKey((lowerLeftX + x) * 64, (lowerLeftZ + z) * 64);
-            if (m_generatedTerrain.find(currTerrain) == m_generatedTerrain.end()) {
-                m_generatedTerrain.insert(currTerrain);
-                output.push_back(currTerrain);
-            }
-        }
-    }
-    return output;
+void Terrain::setOcclusionCulling(bool enabled) {
+    m_occlusionCulling = enabled;
 }
 
-// TODO: When you make Chunk inherit from Drawable, change this code so
-// it draws each Chunk with the given ShaderProgram, remembering to set the
-// model matrix to the proper X and Z translation!
-void Terrain::draw(int minX, int maxX, int minZ, int maxZ, ShaderProgram *shaderProgram, bool shadow) {
-    for(int x = minX; x < maxX; x += 16) {
-        for(int z = minZ; z < maxZ; z += 16) {
-            if (hasChunkAt(x, z)) {
-                const uPtr<Chunk> &chunk = getChunkAt(x, z);
-                shaderProgram->drawInterleaved(*chunk, 0, 1);
-            }
-        }
-    }
-    if (shadow) {
-        return;
+bool Terrain::occlusionCulling() const {
+    return m_occlusionCulling;
+}
+
+const TerrainDrawStats &Terrain::drawStats(bool shadow) const {
+    return shadow ? m_shadowDrawStats : m_drawStats;
+}
+
+int Terrain::drawSetRebuilds() const {
+    return m_drawSetRebuilds;
+}
+
+bool Terrain::meshesChangedSince(uint64_t revision, const glm::mat4 &viewProj) const {
+    if (ChunkDrawable::meshRevision() == revision) {
+        return false;
     }
-    for(int x = minX; x < maxX; x += 16) {
-        for(int z = minZ; z < maxZ; z += 16) {
-            if (hasChunkAt(x, z)) {
-                const uPtr<Chunk> &chunk = getChunkAt(x, z);
-                shaderProgram->drawTransInterleaved(*chunk, 0, 1);
-            }
+    Frustum frustum(viewProj);
+    for (const auto &entry : m_chunks) {
+        const Chunk *chunk = entry.second.get();
+        const ChunkDrawable *drawable = ChunkDrawable::of(chunk);
+        if (drawable == nullptr || drawable->meshStamp() <= revision) {
+            continue;
+        }
+        // A freed mesh has no bounds left, so test the whole column
+        glm::vec3 min(chunk->minX, 0.f, chunk->minZ), max(chunk->minX + 16, 256.f, chunk->minZ + 16);
+        if (drawable->hasMesh()) {
+            min = drawable->boundsMin();
+            max = drawable->boundsMax();
+        }
+        if (frustum.intersectsAABB(min, max)) {
+            return true;
         }
     }
+    return false;
 }
@@ -1,59 +1,81 @@
 #pragma once
 #include "smartpointerhelp.h"
-#include "chunk.h"
-#include <unordered_map>
-#include <unordered_set>
+#include "world.h"
+#include "chunkdrawable.h"
 #include "shaderprogram.h"
-#include "progen.h"
 #include "texture.h"
-#include "QMutex"
-#include "river.h"
+#include "frustum.h"
+#include "visibilitygraph.h"
+#include "occlusionbuffer.h"
+#include "terrainarena.h"
+#include "lodterrain.h"
 
-// per side, that is -NUMZONETODRAW to NUMZONETODRAW will be drawn
-#define NUMZONETOWORK 3
-#define NUMZONETODRAW 2
+// Occluders for the software depth buffer come from the solid slabs of
+// at most MAXOCCLUDERS Chunk quarters, nearest to the camera first
+#define MAXOCCLUDERS 384
 
-class Player;
-class River;
-// Helper functions to convert (x, z) to and from hash map key
-int64_t toKey(int x, int z);
-glm::ivec2 toCoords(int64_t k);
+// Counters from the last Terrain::draw call of one pass
+struct TerrainDrawStats {
+    // Chunks with geometry that were drawn, failed the frustum test,
+    // or passed it but were hidden according to the visibility graph
+    int drawn;
+    int culled;
+    int occluded;
+    // Chunks that passed both tests above but were behind the software
+    // depth buffer's occluders, and the number of occluders drawn into it
+    int depthOccluded;
+    int occluders;
+    // Opaque plus translucent triangles submitted
+    int64_t triangles;
+    // GL draw calls issued for them
+    int drawCalls;
+    // Chunk columns drawn from distant-terrain tiles
+    int lodColumns;
 
-struct ChunkVBOData {
-    Chunk *associated_chunk;
-    std::vector<glm::vec4> vertex_data;
-    std::vector<GLuint> idx_data;
-    std::vector<glm::vec4> trans_vertex_data;
-    std::vector<GLuint> trans_idx_data;
+    TerrainDrawStats() : drawn(0), culled(0), occluded(0), depthOccluded(0), occluders(0), triangles(0), drawCalls(0),
+        lodColumns(0) {}
 };
 
-// The container class for all of the Chunks in the game.
-// Ultimately, while Terrain will always store all Chunks,
-// not all Chunks will be drawn at any given time as the world
-// expands.
-class Terrain {
+class Player;
+
+// The World of the game and the GPU side of it: Chunk meshes, and
+// culling and drawing them. Ultimately, while Terrain will always
+// store all Chunks, not all Chunks will be drawn at any given time as
+// the world expands.
+class Terrain : public World {
 private:
-    // Stores every Chunk according to the location of its lower-left corner
-    // in world space.
-    // We combine the X and Z coordinates of the Chunk's corner into one 64-bit int
-    // so that we can use them as a key for the map, as objects like std::pairs or
-    // glm::ivec2s are not hashable by default, so they cannot be used as keys.
-    std::unordered_map<int64_t, uPtr<Chunk>> m_chunks;
+    // Culling: frustum, visibility-graph and occlusion culling state,
+    // reused across draw calls, and what the last draw passes counted
 
-    // We will designate every 64 x 64 area of the world's x-z plane
-    // as one "terrain generation zone". Every time the player moves
-    // near a portion of the world that has not yet been generated
-    // (i.e. its lower-left coordinates are not in this set), a new
-    // 4 x 4 collection of Chunks is created to represent that area
-    // of the world.
-    // The world that exists when the base code is run consists of exactly
-    // one 64 x 64 area with its lower-left corner at (0, 0).
-    // When milestone 1 has been implemented, the Player can move around the
-    // world to add more "terrain generation zone" IDs to this set.
-    // While only the 3 x 3 collection of terrain generation zones
-    // surrounding the Player should be rendered, the Chunks
-    // in the Terrain will never be deleted until the program is terminated.
-    std::unordered_set<int64_t> m_generatedTerrain;
+    // The draw set: every Chunk with a mesh in the draw range and its
+    // bounds, kept across draw calls and rebuilt by updateDrawSet only
+    // when the range moves or some Chunk's mesh changes
+    AABBList m_cullBoxes;
+    std::vector<Chunk*> m_cullChunks;
+    // Section connectivity of every grid cell of the draw range (null
+    // where there is no mesh), and each candidate's cell in it
+    std::vector<const SectionConnectivity*> m_cullGrid;
+    std::vector<int> m_cullGridIndex;
+    // Candidates with opaque and with translucent geometry
+    std::vector<int> m_opaqueCandidates;
+    std::vector<int> m_translucentCandidates;
+    int m_drawSetMinX, m_drawSetMinZ, m_drawSetSizeX, m_drawSetSizeZ;
+    uint64_t m_drawSetRevision;
+    int m_drawSetRebuilds;
+    // Scratch space reused by every draw call for frustum culling
+    std::vector<unsigned char> m_cullVisible;
+    VisibilityGraph m_visibility;
+    bool m_occlusionCulling;
+    OcclusionBuffer m_occlusionBuffer;
+    // (squared distance to the camera, candidate index) of occluder sources
+    std::vector<std::pair<float, int>> m_occluderOrder;
+    bool m_depthOcclusion;
+    TerrainDrawStats m_drawStats;
+    TerrainDrawStats m_shadowDrawStats;
+    // Scratch space for culling the distant-terrain columns
+    AABBList m_lodBoxes;
+    std::vector<const ArenaSlice*> m_lodSlices;
+    std::vector<unsigned char> m_lodVisible;
 
     // TODO: DELETE ALL REFERENCES TO m_geomCube AS YOU WILL NOT USE
     // IT IN YOUR FINAL PROGRAM!
@@ -63,54 +85,76 @@ private:
     // inefficient, and will cause your game to run very slowly until
     // milestone 1's Chunk VBO setup is completed.
     OpenGLContext* mp_context;
-    ProGen progen;
+    // Shared buffers holding every Chunk's mesh, null until createDrawArena
+    uPtr<TerrainArena> mp_arena;
+    // Distant terrain drawn from the same arena, null without one
+    uPtr<LODTerrain> mp_lod;
+    bool m_lodEnabled;
     uPtr<Texture> mp_texture;
 
-    //void createTerrainZone(int x, int z);
-    BlockType getBlockTypeAtHeight(int x, int y, int z, int blockType, bool top);
+    // Fills m_occlusionBuffer with the solid slabs of the Chunks that
+    // passed frustum culling in the current draw call
+    void rasterizeOccluders(const glm::mat4 &viewProj, glm::vec3 eye);
+    // Rebuilds the draw set if the range differs from the last one or
+    // a mesh was uploaded or freed since
+    void updateDrawSet(int minX, int minZ, int sizeX, int sizeZ);
+    // Adds the distant-terrain columns that no Chunk mesh in the draw
+    // range covers to the main pass's draw lists
+    void addLODCommands(int minX, int maxX, int minZ, int maxZ, const Frustum &frustum, bool depthOcclusion,
+                        TerrainDrawStats *stats);
 
 public:
     Terrain(OpenGLContext *context);
     ~Terrain();
 
-    // threads manipulation data
-    std::vector<Chunk*> m_chunksWithOnlyBlockData;
-    QMutex m_chunksWithOnlyBlockDataLock;
-    std::vector<ChunkVBOData> m_chunksWithVBOData;
-    QMutex m_chunksWithVBODataLock;
+    // Creates the shared buffers Chunks created from now on upload
+    // their meshes to, so each draw pass is one multi-draw call per
+    // layer. Needs a current GL context.
+    void createDrawArena();
+    const TerrainArena *drawArena() const;
 
-    // Instantiates a new Chunk and stores it in
-    // our chunk map at the given coordinates.
-    // Returns a pointer to the created Chunk.
-    Chunk* instantiateChunkAt(int x, int z);
-    // Do these world-space coordinates lie within
-    // a Chunk that exists?
-    bool hasChunkAt(int x, int z) const;
-    // Assuming a Chunk exists at these coords,
-    // return a mutable reference to it
-    uPtr<Chunk>& getChunkAt(int x, int z);
-    // Assuming a Chunk exists at these coords,
-    // return a const reference to it
-    const uPtr<Chunk>& getChunkAt(int x, int z) const;
-    // Given a world-space coordinate (which may have negative
-    // values) return the block stored at that point in space.
-    BlockType getBlockAt(int x, int y, int z) const;
-    BlockType getBlockAt(glm::vec3 p) const;
-    // Given a world-space coordinate (which may have negative
-    // values) set the block at that point in space to the
-    // given type.
-    void setBlockAt(int x, int y, int z, BlockType t);
+    // Streams distant-terrain tiles around the given position. Does
+    // nothing without a draw arena or while LOD is disabled.
+    void updateLOD(glm::vec3 position);
+    void setLODEnabled(bool enabled);
+    bool lodEnabled() const;
+    // Null without a draw arena
+    const LODTerrain *lod() const;
+    // Whether every Chunk of the zone exists and has its mesh uploaded
+    bool isZoneMeshed(int64_t zone) const;
+
+    // The Chunk's ChunkDrawable, attaching one first if it has none
+    ChunkDrawable *drawableFor(Chunk *c);
+    // Uploads a mesh handed over by a VBOWorker and frees it
+    void uploadChunk(ChunkVBOData &data);
+    // Meshes the Chunk on this thread and uploads it, for edits that
+    // must show up right away
+    void remeshChunk(Chunk *c);
 
     // Draws every Chunk that falls within the bounding box
-    // described by the min and max coords, using the provided
-    // ShaderProgram
-    void draw(int minX, int maxX, int minZ, int maxZ, ShaderProgram *shaderProgram, bool shader);
+    // described by the min and max coords and intersects the view
+    // frustum of viewProj, using the provided ShaderProgram, and
+    // distant-terrain tiles wherever the main pass has no Chunk mesh.
+    // The main pass also skips Chunks that cannot be seen from eye
+    // through caves and open air. The shadow pass only draws opaque
+    // geometry.
+    void draw(int minX, int maxX, int minZ, int maxZ, const glm::mat4 &viewProj, glm::vec3 eye,
+              ShaderProgram *shaderProgram, bool shadow);
+    void setOcclusionCulling(bool enabled);
+    bool occlusionCulling() const;
+    void setDepthOcclusion(bool enabled);
+    bool depthOcclusion() const;
+    // Culling and submission counters of the last main or shadow pass
+    const TerrainDrawStats &drawStats(bool shadow) const;
+    // Number of times the draw set has been rebuilt
+    int drawSetRebuilds() const;
+    // Whether a Chunk intersecting the frustum of viewProj had its mesh
+    // uploaded or freed after the given ChunkDrawable::meshRevision()
+    bool meshesChangedSince(uint64_t revision, const glm::mat4 &viewProj) const;
 
+    // Generates the zone around pos and meshes the Chunk pos is in, so
+    // that there is something to stand on and draw right away. The
+    // zone's other Chunks are left to the VBOWorkers, and the zones
+    // around it to streamTerrain.
     void CreateInitialScene(glm::vec3);
-
-    // void updateScene(const glm::vec3 pos, ShaderProgram *shaderProgram, Player *p);
-    Chunk* createChunkAt(int x, int z);
-    std::vector<int64_t> checkExpansion(glm::vec3 position);
-
-    void createTerrainZone(int x, int z, bool createvbo);
 };
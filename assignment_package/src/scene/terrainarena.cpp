@@ -0,0 +1,167 @@
+#include "terrainarena.h"
+#include <QOpenGLContext>
+#include <iostream>
+
+// Initial sizes of each layer, in vertices and indices. The opaque
+// layer is grown on demand by GpuArena, the translucent one rarely is.
+static const size_t OPAQUE_VERTICES = 1 << 19;
+static const size_t TRANSLUCENT_VERTICES = 1 << 16;
+
+TerrainArena::TerrainArena(OpenGLContext *context)
+    : mp_context(context), m_commandBuffers{0, 0, 0}, m_created(false),
+      m_multiDrawElementsIndirect(nullptr)
+{
+    size_t vertices[2] = {OPAQUE_VERTICES, TRANSLUCENT_VERTICES};
+    for (int i = 0; i < 2; i++) {
+        // Three vec4s per vertex, and four faces of six indices per four vertices
+        m_layers[i].vertices = mkU<GpuArena>(context, 3 * sizeof(glm::vec4), vertices[i]);
+        m_layers[i].indices = mkU<GpuArena>(context, sizeof(GLuint), vertices[i] * 3 / 2);
+        m_layers[i].vao = 0;
+        m_layers[i].stale = true;
+    }
+}
+
+TerrainArena::~TerrainArena() {
+    destroy();
+}
+
+void TerrainArena::create() {
+    for (Layer &layer : m_layers) {
+        layer.vertices->create();
+        layer.indices->create();
+        mp_context->glGenVertexArrays(1, &layer.vao);
+        layer.stale = true;
+    }
+    mp_context->glGenBuffers(3, m_commandBuffers);
+    m_created = true;
+
+    QOpenGLContext *ctx = QOpenGLContext::currentContext();
+    QSurfaceFormat format = ctx->format();
+    bool core43 = format.majorVersion() > 4 || (format.majorVersion() == 4 && format.minorVersion() >= 3);
+    if (core43 || ctx->hasExtension(QByteArray("GL_ARB_multi_draw_indirect"))) {
+        m_multiDrawElementsIndirect = reinterpret_cast<MultiDrawElementsIndirect>(
+                    ctx->getProcAddress("glMultiDrawElementsIndirect"));
+    }
+    std::cout << "Terrain draws with "
+              << (m_multiDrawElementsIndirect ? "glMultiDrawElementsIndirect" : "glDrawElementsBaseVertex")
+              << std::endl;
+}
+
+void TerrainArena::destroy() {
+    if (!m_created) {
+        return;
+    }
+    for (Layer &layer : m_layers) {
+        layer.vertices->destroy();
+        layer.indices->destroy();
+        mp_context->glState().deleteVertexArray(layer.vao);
+    }
+    mp_context->glDeleteBuffers(3, m_commandBuffers);
+    m_created = false;
+}
+
+void TerrainArena::setupVAO(Layer &layer) {
+    // The VAO is bound by the caller
+    mp_context->glState().bindArrayBuffer(layer.vertices->buffer());
+    mp_context->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, layer.indices->buffer());
+    specifyVertexAttribs(mp_context, INTERLEAVED_VERTEX_FORMAT, INTERLEAVED_VERTEX_STRIDE);
+    layer.stale = false;
+}
+
+void TerrainArena::upload(ArenaSlice *slice, TerrainLayer layer,
+                          const std::vector<glm::vec4> &vertices, const std::vector<GLuint> &indices) {
+    release(slice, layer);
+    if (indices.empty()) {
+        return;
+    }
+    Layer &l = m_layers[layer];
+    bool grew = false;
+    slice->vertexCount = vertices.size() / 3;
+    slice->firstVertex = l.vertices->allocate(slice->vertexCount, &grew);
+    l.stale |= grew;
+    slice->indexCount = indices.size();
+    slice->firstIndex = l.indices->allocate(slice->indexCount, &grew);
+    l.stale |= grew;
+    l.vertices->write(slice->firstVertex, vertices.data(), slice->vertexCount);
+    l.indices->write(slice->firstIndex, indices.data(), slice->indexCount);
+}
+
+void TerrainArena::release(ArenaSlice *slice, TerrainLayer layer) {
+    if (slice->empty()) {
+        return;
+    }
+    m_layers[layer].vertices->release(slice->firstVertex, slice->vertexCount);
+    m_layers[layer].indices->release(slice->firstIndex, slice->indexCount);
+    *slice = ArenaSlice();
+}
+
+void TerrainArena::clearCommands(TerrainDrawList list) {
+    m_commands[list].clear();
+}
+
+void TerrainArena::addCommand(TerrainDrawList list, const ArenaSlice &slice) {
+    if (slice.empty()) {
+        return;
+    }
+    DrawElementsIndirectCommand cmd;
+    cmd.count = static_cast<GLuint>(slice.indexCount);
+    cmd.instanceCount = 1;
+    cmd.firstIndex = static_cast<GLuint>(slice.firstIndex);
+    cmd.baseVertex = static_cast<GLint>(slice.firstVertex);
+    cmd.baseInstance = 0;
+    m_commands[list].push_back(cmd);
+}
+
+int TerrainArena::draw(TerrainDrawList list, TerrainLayer layer, ShaderProgram *shaderProgram) {
+    const std::vector<DrawElementsIndirectCommand> &commands = m_commands[list];
+    if (commands.empty()) {
+        return 0;
+    }
+    shaderProgram->setSamplers(0, 1);
+    mp_context->uniforms().flushDraw();
+
+    Layer &l = m_layers[layer];
+    mp_context->glState().bindVertexArray(l.vao);
+    if (l.stale) {
+        setupVAO(l);
+    }
+
+    int drawCalls = 0;
+    int64_t triangles = 0;
+    for (const DrawElementsIndirectCommand &cmd : commands) {
+        triangles += cmd.count / 3;
+    }
+    if (m_multiDrawElementsIndirect) {
+        mp_context->glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffers[list]);
+        mp_context->glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawElementsIndirectCommand),
+                                 commands.data(), GL_STREAM_DRAW);
+        mp_context->glState().countUpload(commands.size() * sizeof(DrawElementsIndirectCommand));
+        m_multiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr,
+                                    static_cast<GLsizei>(commands.size()), 0);
+        mp_context->glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        drawCalls = 1;
+    } else {
+        // Still saves the per-Chunk buffer binds and attribute setup
+        for (const DrawElementsIndirectCommand &cmd : commands) {
+            mp_context->glDrawElementsBaseVertex(GL_TRIANGLES, cmd.count, GL_UNSIGNED_INT,
+                                                 (void*)(cmd.firstIndex * sizeof(GLuint)), cmd.baseVertex);
+        }
+        drawCalls = static_cast<int>(commands.size());
+    }
+    mp_context->glState().countDraws(drawCalls, triangles);
+    return drawCalls;
+}
+
+bool TerrainArena::hasMultiDrawIndirect() const {
+    return m_multiDrawElementsIndirect != nullptr;
+}
+
+size_t TerrainArena::usedBytes() const {
+    return m_layers[0].vertices->usedBytes() + m_layers[0].indices->usedBytes()
+            + m_layers[1].vertices->usedBytes() + m_layers[1].indices->usedBytes();
+}
+
+size_t TerrainArena::capacityBytes() const {
+    return m_layers[0].vertices->capacityBytes() + m_layers[0].indices->capacityBytes()
+            + m_layers[1].vertices->capacityBytes() + m_layers[1].indices->capacityBytes();
+}
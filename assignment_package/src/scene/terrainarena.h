@@ -0,0 +1,85 @@
+#pragma once
+#include "gpuarena.h"
+#include "shaderprogram.h"
+#include "smartpointerhelp.h"
+#include <vector>
+
+// Where one layer of a Chunk's mesh lives in a TerrainArena
+struct ArenaSlice {
+    size_t firstVertex, vertexCount;
+    size_t firstIndex, indexCount;
+
+    ArenaSlice() : firstVertex(0), vertexCount(0), firstIndex(0), indexCount(0) {}
+    bool empty() const { return indexCount == 0; }
+};
+
+enum TerrainLayer : unsigned char {
+    LAYER_OPAQUE, LAYER_TRANSLUCENT
+};
+
+// The draw lists Terrain fills each frame
+enum TerrainDrawList : unsigned char {
+    LIST_OPAQUE, LIST_TRANSLUCENT, LIST_SHADOW
+};
+
+// Layout of glMultiDrawElementsIndirect's commands
+struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+// Holds the meshes of every Chunk in a few shared buffers, one vertex
+// and one index buffer per layer, so that a whole draw list can be
+// submitted with a single glMultiDrawElementsIndirect call instead of
+// one bind-and-draw per Chunk. Chunk indices stay 0-based and are
+// offset by each command's baseVertex.
+class TerrainArena {
+private:
+    struct Layer {
+        uPtr<GpuArena> vertices;
+        uPtr<GpuArena> indices;
+        GLuint vao;
+        // Set when a buffer was reallocated and the VAO needs to point
+        // at the new one
+        bool stale;
+    };
+
+    OpenGLContext *mp_context;
+    Layer m_layers[2];
+    std::vector<DrawElementsIndirectCommand> m_commands[3];
+    GLuint m_commandBuffers[3];
+    bool m_created;
+
+    typedef void (QOPENGLF_APIENTRYP MultiDrawElementsIndirect)(GLenum, GLenum, const void*, GLsizei, GLsizei);
+    // Null when the context offers neither GL 4.3 nor ARB_multi_draw_indirect
+    MultiDrawElementsIndirect m_multiDrawElementsIndirect;
+
+    void setupVAO(Layer &layer);
+
+public:
+    TerrainArena(OpenGLContext *context);
+    ~TerrainArena();
+
+    // Allocates the buffers; the context must be current
+    void create();
+    void destroy();
+
+    // Replaces the contents of slice with the given mesh
+    void upload(ArenaSlice *slice, TerrainLayer layer,
+                const std::vector<glm::vec4> &vertices, const std::vector<GLuint> &indices);
+    void release(ArenaSlice *slice, TerrainLayer layer);
+
+    void clearCommands(TerrainDrawList list);
+    void addCommand(TerrainDrawList list, const ArenaSlice &slice);
+    // Draws every command in the list from the given layer.
+    // Returns the number of draw calls issued.
+    int draw(TerrainDrawList list, TerrainLayer layer, ShaderProgram *shaderProgram);
+
+    bool hasMultiDrawIndirect() const;
+    // Bytes of vertex and index data currently stored, and allocated
+    size_t usedBytes() const;
+    size_t capacityBytes() const;
+};
@@ -1,5 +1,6 @@
 #include "vboworker.h"
 #include "iostream"
+#include "trace.h"
 
 VBOWorker::VBOWorker(
                      std::vector<ChunkVBOData>* mp_chunksWithVBOData,
@@ -8,20 +9,21 @@ VBOWorker::VBOWorker(
     :
     mp_chunksWithVBOData(mp_chunksWithVBOData),
     mp_mutex(mutex),
-    mp_chunk(c)
+    mp_chunk(c),
+    m_memory(MEMORY_JOB_QUEUES)
 {
+    m_memory.set(sizeof(VBOWorker));
 }
 void VBOWorker::run() {
+    TRACE_SCOPE("mesh chunk");
     mp_chunk->createVBOdata();
+    mp_chunk->stampPipeline(STAMP_MESHED);
 
-    ChunkVBOData vboData;
-    vboData.associated_chunk = mp_chunk;
-    vboData.idx_data = mp_chunk->m_VBOdataIdx;
-    vboData.vertex_data = mp_chunk->m_VBOdataAll;
-    vboData.trans_idx_data = mp_chunk->m_VBOdataTransIdx;
-    vboData.trans_vertex_data = mp_chunk->m_VBOdataTransAll;
+    ChunkVBOData vboData = mp_chunk->takeVBOdata();
 
     mp_mutex->lock();
-    mp_chunksWithVBOData->push_back(vboData);
+    // Stamped before the GL thread can see the mesh and record the Chunk
+    mp_chunk->stampPipeline(STAMP_UPLOAD_QUEUED);
+    mp_chunksWithVBOData->push_back(std::move(vboData));
     mp_mutex->unlock();
 }
@@ -4,7 +4,7 @@
 #include <QRunnable>
 #include <QMutex>
 #include <scene/chunk.h>
-#include <scene/terrain.h>
+#include <scene/world.h>
 using namespace std;
 
 class VBOWorker : public QRunnable
@@ -14,6 +14,8 @@ private:
     std::vector<ChunkVBOData>* mp_chunksWithVBOData;
     QMutex *mp_mutex;
     Chunk *mp_chunk;
+    // This job while it waits for or runs on the thread pool
+    MemoryAccount m_memory;
 
 public:
 
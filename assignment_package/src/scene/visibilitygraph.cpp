@@ -0,0 +1,157 @@
+#include "visibilitygraph.h"
+
+static inline bool isOpaque(BlockType t) {
+    return t != EMPTY && t != WATER;
+}
+
+// Offsets of the Direction enum, in the same order
+static const int DIR_X[6] = {1, -1, 0, 0, 0, 0};
+static const int DIR_Y[6] = {0, 0, 1, -1, 0, 0};
+static const int DIR_Z[6] = {0, 0, 0, 0, 1, -1};
+static const int OPPOSITE[6] = {XNEG, XPOS, YNEG, YPOS, ZNEG, ZPOS};
+
+// Bit mask of the section faces that a cell at local (x, y, z) touches
+static inline int boundaryFaces(int x, int y, int z) {
+    return (x == 15) << XPOS | (x == 0) << XNEG
+         | (y == 15) << YPOS | (y == 0) << YNEG
+         | (z == 15) << ZPOS | (z == 0) << ZNEG;
+}
+
+static SectionConnectivity connectFaces(SectionConnectivity c, int faces) {
+    for (int a = 0; a < 6; a++) {
+        if (!(faces & (1 << a))) {
+            continue;
+        }
+        for (int b = 0; b < 6; b++) {
+            if (faces & (1 << b)) {
+                c |= 1ull << (6 * a + b);
+            }
+        }
+    }
+    return c;
+}
+
+static SectionConnectivity sectionConnectivity(const BlockType *blocks, int section,
+                                               std::vector<unsigned char> &visited,
+                                               std::vector<int> &stack) {
+    // Cells are indexed x + 16 * y + 256 * z within the section
+    int openCells = 0;
+    for (int z = 0; z < 16; z++) {
+        for (int y = 0; y < 16; y++) {
+            for (int x = 0; x < 16; x++) {
+                bool open = !isOpaque(blocks[x + 16 * (16 * section + y) + 4096 * z]);
+                visited[x + 16 * y + 256 * z] = !open;
+                openCells += open;
+            }
+        }
+    }
+    if (openCells == 4096) {
+        return ALL_FACES_CONNECTED;
+    }
+
+    SectionConnectivity c = 0;
+    for (int start = 0; start < 4096 && c != ALL_FACES_CONNECTED; start++) {
+        if (visited[start]) {
+            continue;
+        }
+        int faces = 0;
+        visited[start] = 1;
+        stack.clear();
+        stack.push_back(start);
+        while (!stack.empty()) {
+            int cell = stack.back();
+            stack.pop_back();
+            int x = cell & 15, y = (cell >> 4) & 15, z = cell >> 8;
+            faces |= boundaryFaces(x, y, z);
+            for (int d = 0; d < 6; d++) {
+                int nx = x + DIR_X[d], ny = y + DIR_Y[d], nz = z + DIR_Z[d];
+                if (nx < 0 || nx > 15 || ny < 0 || ny > 15 || nz < 0 || nz > 15) {
+                    continue;
+                }
+                int n = nx + 16 * ny + 256 * nz;
+                if (!visited[n]) {
+                    visited[n] = 1;
+                    stack.push_back(n);
+                }
+            }
+        }
+        c = connectFaces(c, faces);
+    }
+    return c;
+}
+
+void computeSectionConnectivity(const BlockType *blocks, std::array<SectionConnectivity, 16> *out) {
+    std::vector<unsigned char> visited(4096);
+    std::vector<int> stack;
+    stack.reserve(4096);
+    for (int s = 0; s < 16; s++) {
+        (*out)[s] = sectionConnectivity(blocks, s, visited, stack);
+    }
+}
+
+VisibilityGraph::VisibilityGraph()
+    : m_sizeX(0), m_sizeZ(0), m_visitedSections(), m_visibleChunks(), m_queue(), m_sectionsVisited(0)
+{}
+
+void VisibilityGraph::traverse(const std::vector<const SectionConnectivity*> &grid, int minX, int minZ, int sizeX, int sizeZ,
+                               glm::vec3 camera, const Frustum &frustum) {
+    m_sizeX = sizeX;
+    m_sizeZ = sizeZ;
+    m_sectionsVisited = 0;
+    int cx = static_cast<int>(glm::floor((camera.x - minX) / 16.f));
+    int cy = static_cast<int>(glm::floor(camera.y / 16.f));
+    int cz = static_cast<int>(glm::floor((camera.z - minZ) / 16.f));
+    if (cx < 0 || cx >= sizeX || cy < 0 || cy >= 16 || cz < 0 || cz >= sizeZ) {
+        m_visibleChunks.assign(sizeX * sizeZ, 1);
+        return;
+    }
+    m_visibleChunks.assign(sizeX * sizeZ, 0);
+    m_visitedSections.assign(sizeX * sizeZ * 16, 0);
+
+    // Sections are indexed y + 16 * chunk
+    auto sectionIndex = [sizeX](int x, int y, int z) { return y + 16 * (x + sizeX * z); };
+    m_queue.clear();
+    m_queue.push_back({cx, cy, cz, 6, 0});
+    m_visitedSections[sectionIndex(cx, cy, cz)] = 1;
+
+    for (size_t head = 0; head < m_queue.size(); head++) {
+        Node n = m_queue[head];
+        m_sectionsVisited++;
+        int chunk = n.x + sizeX * n.z;
+        m_visibleChunks[chunk] = 1;
+        // Missing or not yet meshed Chunks hide nothing
+        SectionConnectivity c = grid[chunk] ? grid[chunk][n.y] : ALL_FACES_CONNECTED;
+
+        for (int d = 0; d < 6; d++) {
+            if (n.entry != 6 && !facesConnected(c, n.entry, d)) {
+                continue;
+            }
+            if (n.directions & (1 << OPPOSITE[d])) {
+                continue;
+            }
+            int nx = n.x + DIR_X[d], ny = n.y + DIR_Y[d], nz = n.z + DIR_Z[d];
+            if (nx < 0 || nx >= sizeX || ny < 0 || ny >= 16 || nz < 0 || nz >= sizeZ) {
+                continue;
+            }
+            int s = sectionIndex(nx, ny, nz);
+            if (m_visitedSections[s]) {
+                continue;
+            }
+            m_visitedSections[s] = 1;
+            glm::vec3 min(minX + 16 * nx, 16 * ny, minZ + 16 * nz);
+            if (!frustum.intersectsAABB(min, min + glm::vec3(16.f))) {
+                continue;
+            }
+            m_queue.push_back({nx, ny, nz, static_cast<unsigned char>(OPPOSITE[d]),
+                               static_cast<unsigned char>(n.directions | (1 << d))});
+        }
+    }
+}
+
+bool VisibilityGraph::isChunkVisible(int i) const {
+    return m_visibleChunks[i];
+}
+
+int VisibilityGraph::sectionsVisited() const {
+    return m_sectionsVisited;
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include "glm_includes.h"
+#include "texturehelp.h"
+#include "frustum.h"
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// Which of the six faces of a 16 x 16 x 16 section of a Chunk can see
+// each other through non-opaque blocks (air and water). Bit 6 * a + b is
+// set when faces a and b, numbered in Direction order, are connected.
+typedef uint64_t SectionConnectivity;
+const SectionConnectivity ALL_FACES_CONNECTED = (1ull << 36) - 1;
+
+inline bool facesConnected(SectionConnectivity c, int a, int b) {
+    return (c >> (6 * a + b)) & 1;
+}
+
+// Flood fills each of the 16 sections of a Chunk's 16 x 256 x 16 block
+// array (indexed x + 16 * y + 256 * 16 * z) to find its connectivity
+void computeSectionConnectivity(const BlockType *blocks, std::array<SectionConnectivity, 16> *out);
+
+// Occlusion culling over the graph of Chunk sections: starting at the
+// camera's section, a breadth-first search only moves into a neighboring
+// section through a face that the section it came in through can see,
+// never reverses a direction it has already moved in, and only enters
+// sections inside the view frustum. Chunks none of whose sections are
+// reached are hidden behind solid terrain.
+class VisibilityGraph {
+private:
+    struct Node {
+        int x, y, z;
+        // Face the search entered this section through, 6 for none
+        unsigned char entry;
+        // Bit d is set once the search has moved in Direction d
+        unsigned char directions;
+    };
+
+    int m_sizeX, m_sizeZ;
+    std::vector<unsigned char> m_visitedSections;
+    std::vector<unsigned char> m_visibleChunks;
+    std::vector<Node> m_queue;
+    int m_sectionsVisited;
+
+public:
+    VisibilityGraph();
+
+    // grid holds the 16 section connectivities of sizeX * sizeZ Chunks
+    // (or null where there is no mesh), the one at grid[i + sizeX * j]
+    // having its lower-left corner at (minX + 16 * i, minZ + 16 * j).
+    // If the camera is outside the grid every Chunk is reported visible.
+    void traverse(const std::vector<const SectionConnectivity*> &grid, int minX, int minZ, int sizeX, int sizeZ,
+                  glm::vec3 camera, const Frustum &frustum);
+    // Whether the last traversal reached grid[i]
+    bool isChunkVisible(int i) const;
+    int sectionsVisited() const;
+};
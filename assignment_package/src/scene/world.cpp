@@ -0,0 +1,680 @@
+#include "world.h"
+#include "trace.h"
+#include <iostream>
+#include <stdexcept>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <tuple>
+
+World::World()
+    : m_generatedTerrain(), m_pendingZoneChunks(), m_pipelineLatency(),
+      m_drawRadius(NUMZONETODRAW), m_workRadius(NUMZONETOWORK), m_keepRadius(NUMZONETOKEEP), m_memoryBudget(CHUNKMEMORYBUDGET), m_lastUnloadCheck(0),
+      m_coldChunkMSecs(COLDCHUNKSECONDS * 1000), m_lastCompressCheck(0), m_compressedChunks(0),
+      mp_store(nullptr), m_saveMode(SAVE_FULL_CHUNKS), m_lastAutosave(0), progen(), m_chunks(),
+      m_indexMemory(MEMORY_CHUNK_INDEX)
+{}
+
+World::~World() {
+    releaseChunks();
+}
+
+void World::releaseChunks() {
+    // The owner must have waited for the worker threads by now,
+    // so every Chunk can be saved
+    if (mp_store) {
+        for (auto &c : m_chunks) {
+            if (c.second) {
+                saveChunk(c.second.get());
+            }
+        }
+    }
+    m_chunks.clear();
+    accountChunkIndex();
+}
+
+void World::accountChunkIndex() {
+    // Each node holds the next pointer and the key and value; the
+    // hash of an integer key is not cached
+    m_indexMemory.set(m_chunks.bucket_count() * sizeof(void*)
+                      + m_chunks.size() * (sizeof(void*) + sizeof(std::pair<const int64_t, uPtr<Chunk>>)));
+}
+
+
+BlockType World::generatedSurfaceAt(int x, int z, int *out_height) {
+    std::vector<int> blockInfo = progen.getBlockHeight(x, z);
+    *out_height = blockInfo[0];
+    BlockType t = getBlockTypeAtHeight(x, blockInfo[0], z, blockInfo[1], true);
+    // A cave open to the sky shows the stone around it from afar
+    return t == EMPTY ? STONE : t;
+}
+
+// Combine two 32-bit ints into one 64-bit int
+// where the upper 32 bits are X and the lower 32 bits are Z
+int64_t toKey(int x, int z) {
+    int64_t xz = 0xffffffffffffffff;
+    int64_t x64 = x;
+    int64_t z64 = z;
+
+    // Set all lower 32 bits to 1 so we can & with Z later
+    xz = (xz & (x64 << 32)) | 0x00000000ffffffff;
+
+    // Set all upper 32 bits to 1 so we can & with XZ
+    z64 = z64 | 0xffffffff00000000;
+
+    // Combine
+    xz = xz & z64;
+    return xz;
+}
+
+glm::ivec2 toCoords(int64_t k) {
+    // Z is lower 32 bits
+    int64_t z = k & 0x00000000ffffffff;
+    // If the most significant bit of Z is 1, then it's a negative number
+    // so we have to set all the upper 32 bits to 1.
+    // Note the 8    V
+    if(z & 0x0000000080000000) {
+        z = z | 0xffffffff00000000;
+    }
+    int64_t x = (k >> 32);
+
+    return glm::ivec2(x, z);
+}
+
+int64_t toZoneKey(int x, int z) {
+    return toKey(64 * static_cast<int>(glm::floor(x / 64.f)),
+                 64 * static_cast<int>(glm::floor(z / 64.f)));
+}
+
+int64_t currentMSecs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Surround calls to this with try-catch if you don't know whether
+// the coordinates at x, y, z have a corresponding Chunk
+BlockType World::getBlockAt(int x, int y, int z) const
+{
+    if(hasChunkAt(x, z)) {
+        // Just disallow action below or above min/max height,
+        // but don't crash the game over it.
+        if(y < 0 || y >= 256) {
+            return EMPTY;
+        }
+        const uPtr<Chunk> &c = getChunkAt(x, z);
+        glm::vec2 chunkOrigin = glm::vec2(floor(x / 16.f) * 16, floor(z / 16.f) * 16);
+        return c->getBlockAt(static_cast<unsigned int>(x - chunkOrigin.x),
+                             static_cast<unsigned int>(y),
+                             static_cast<unsigned int>(z - chunkOrigin.y));
+    }
+    else {
+        throw std::out_of_range("Coordinates " + std::to_string(x) +
+                                " " + std::to_string(y) + " " +
+                                std::to_string(z) + " have no Chunk!");
+    }
+}
+
+BlockType World::getBlockAt(glm::vec3 p) const {
+    return getBlockAt(p.x, p.y, p.z);
+}
+
+void World::setBlockAt(int x, int y, int z, BlockType t)
+{
+    if(hasChunkAt(x, z)) {
+        uPtr<Chunk> &c = getChunkAt(x, z);
+        glm::vec2 chunkOrigin = glm::vec2(floor(x / 16.f) * 16, floor(z / 16.f) * 16);
+        c->setBlockAt(static_cast<unsigned int>(x - chunkOrigin.x),
+                      static_cast<unsigned int>(y),
+                      static_cast<unsigned int>(z - chunkOrigin.y),
+                      t);
+    }
+    else {
+        throw std::out_of_range("Coordinates " + std::to_string(x) +
+                                " " + std::to_string(y) + " " +
+                                std::to_string(z) + " have no Chunk!");
+    }
+}
+
+bool World::hasChunkAt(int x, int z) const {
+    // Map x and z to their nearest Chunk corner
+    // By flooring x and z, then multiplying by 16,
+    // we clamp (x, z) to its nearest Chunk-space corner,
+    // then scale back to a world-space location.
+    // Note that floor() lets us handle negative numbers
+    // correctly, as floor(-1 / 16.f) gives us -1, as
+    // opposed to (int)(-1 / 16.f) giving us 0 (incorrect!).
+    int xFloor = static_cast<int>(glm::floor(x / 16.f));
+    int zFloor = static_cast<int>(glm::floor(z / 16.f));
+    return m_chunks.find(toKey(16 * xFloor, 16 * zFloor)) != m_chunks.end();
+}
+
+
+uPtr<Chunk>& World::getChunkAt(int x, int z) {
+    int xFloor = static_cast<int>(glm::floor(x / 16.f));
+    int zFloor = static_cast<int>(glm::floor(z / 16.f));
+    uPtr<Chunk> &c = m_chunks[toKey(16 * xFloor, 16 * zFloor)];
+    if (c) {
+        c->ensureResident();
+    }
+    return c;
+}
+
+
+const uPtr<Chunk>& World::getChunkAt(int x, int z) const {
+    int xFloor = static_cast<int>(glm::floor(x / 16.f));
+    int zFloor = static_cast<int>(glm::floor(z / 16.f));
+    const uPtr<Chunk> &c = m_chunks.at(toKey(16 * xFloor, 16 * zFloor));
+    if (c) {
+        c->ensureResident();
+    }
+    return c;
+}
+
+Chunk *World::findChunk(int x, int z) const {
+    int xFloor = static_cast<int>(glm::floor(x / 16.f));
+    int zFloor = static_cast<int>(glm::floor(z / 16.f));
+    auto it = m_chunks.find(toKey(16 * xFloor, 16 * zFloor));
+    return it != m_chunks.end() ? it->second.get() : nullptr;
+}
+
+Chunk* World::instantiateChunkAt(int x, int z) {
+    uPtr<Chunk> chunk = mkU<Chunk>(x, z);
+    Chunk *cPtr = chunk.get();
+    m_chunks[toKey(x, z)] = std::move(chunk);
+    accountChunkIndex();
+    // Set the neighbor pointers of itself and its neighbors
+    if(hasChunkAt(x, z + 16)) {
+        auto &chunkNorth = m_chunks[toKey(x, z + 16)];
+        cPtr->linkNeighbor(chunkNorth, ZPOS);
+    }
+    if(hasChunkAt(x, z - 16)) {
+        auto &chunkSouth = m_chunks[toKey(x, z - 16)];
+        cPtr->linkNeighbor(chunkSouth, ZNEG);
+    }
+    if(hasChunkAt(x + 16, z)) {
+        auto &chunkEast = m_chunks[toKey(x + 16, z)];
+        cPtr->linkNeighbor(chunkEast, XPOS);
+    }
+    if(hasChunkAt(x - 16, z)) {
+        auto &chunkWest = m_chunks[toKey(x - 16, z)];
+        cPtr->linkNeighbor(chunkWest, XNEG);
+    }
+    return cPtr;
+}
+
+Chunk* World::createChunkAt(int x, int z) {
+    return instantiateChunkAt(x, z);
+}
+
+void World::createTerrainZone(int x, int z) {
+    for (int i = 0; i < 64; i += 16) {
+        for (int j = 0; j < 64; j += 16) {
+            if (!hasChunkAt(x + i, z + j)){
+                instantiateChunkAt(x + i, z + j);
+            }
+        }
+    }
+
+    m_generatedTerrain.insert(toKey(x, z));
+
+    // Height and biome of every column, sampled before any block is set
+    // so that the two can be traced apart
+    std::array<glm::ivec2, 64 * 64> columns;
+    {
+        TRACE_SCOPE("noise");
+        for (int i = 0; i < 64; i++) {
+            for (int j = 0; j < 64; j++) {
+                std::vector<int> blockInfo = progen.getBlockHeight(x + i, z + j);
+                columns[i * 64 + j] = glm::ivec2(blockInfo[0], blockInfo[1]);
+            }
+        }
+    }
+    TRACE_SCOPE("fill blocks");
+    for (int i = 0; i < 64; i++) {
+        for (int j = 0; j < 64; j++) {
+            int curX = x + i;
+            int curZ = z + j;
+            int curY = columns[i * 64 + j].x;
+            for (int k = 0; k <= curY; k++) {
+                setBlockAt(curX, k, curZ, getBlockTypeAtHeight(curX, k, curZ, columns[i * 64 + j].y, curY));
+            }
+            if (curY < 132) {
+                for (int t = curY + 1; t < 132; t++) {
+                    setBlockAt(curX, t, curZ, WATER);
+                }
+            }
+        }
+    }
+//    for (int i = 0; i < 64; i+=16) {
+//        for (int j = 0; j < 64; j+=16) {
+//            River river = River(this, x+i, z+j);
+//            river.draw();
+//        }
+//    }
+}
+
+void World::trackZoneEdits(int x, int z) {
+    // Only edit-delta saves read the recorded edits back
+    bool recordDeltas = mp_store && m_saveMode == SAVE_EDIT_DELTAS;
+    for (int i = 0; i < 64; i += 16) {
+        for (int j = 0; j < 64; j += 16) {
+            auto it = m_chunks.find(toKey(x + i, z + j));
+            if (it != m_chunks.end()) {
+                it->second->trackEdits(recordDeltas);
+            }
+        }
+    }
+}
+
+BlockType World::getBlockTypeAtHeight(int x, int y, int z, int blockType, bool top) {
+    if (y == 0) {
+        return BEDROCK;
+    } else if (y < 25) {
+        return LAVA;
+    } else if (y < 118) {
+        if (progen.keepCave(x, y, z)) {
+            return STONE;
+        } else {
+            return EMPTY;
+        }
+    } else if (y < 120) {
+        return STONE;
+    } else if (y < 128) {
+        return SAND;
+    } else if (y < 160) {
+        if (blockType == 0) {
+            return DUNE;
+        }
+        return top ? GRASS : DIRT;
+    } else if (y < 200) {
+        return STONE;
+    } else {
+        return top ? SNOW : STONE;
+    }
+}
+
+std::vector<int64_t> World::checkExpansion(glm::vec3 position) {
+
+    std::vector<int64_t> output;
+    int lowerLeftX = glm::floor(position.x / 64.0f);
+    int lowerLeftZ = glm::floor(position.z / 64.0f);
+
+    for (int z = -m_workRadius; z <= m_workRadius; z++) {
+        for (int x = -m_workRadius; x <= m_workRadius; x++) {
+            int64_t currTerrain = toKey((lowerLeftX + x) * 64, (lowerLeftZ + z) * 64);
+            if (m_generatedTerrain.find(currTerrain) == m_generatedTerrain.end()) {
+                m_generatedTerrain.insert(currTerrain);
+                output.push_back(currTerrain);
+            }
+        }
+    }
+    // Nearest first: the thread pool starts jobs in the order they come,
+    // so the world fills in outwards from the player
+    std::stable_sort(output.begin(), output.end(), [&](int64_t a, int64_t b) {
+        glm::ivec2 da = glm::abs(toCoords(a) / 64 - glm::ivec2(lowerLeftX, lowerLeftZ));
+        glm::ivec2 db = glm::abs(toCoords(b) / 64 - glm::ivec2(lowerLeftX, lowerLeftZ));
+        return std::max(da.x, da.y) < std::max(db.x, db.y);
+    });
+    return output;
+}
+
+void World::markZoneGenerated(int64_t zone) {
+    m_generatedTerrain.insert(zone);
+}
+
+void World::setRetention(int keepRadius, size_t memoryBudget) {
+    m_keepRadius = keepRadius;
+    m_memoryBudget = memoryBudget;
+}
+
+void World::setViewDistance(int drawRadius) {
+    m_drawRadius = glm::clamp(drawRadius, MINZONETODRAW, MAXZONETODRAW);
+    m_workRadius = m_drawRadius + 1;
+}
+
+int World::drawRadius() const {
+    return m_drawRadius;
+}
+
+int World::workRadius() const {
+    return m_workRadius;
+}
+
+const PipelineLatency &World::pipelineLatency() const {
+    return m_pipelineLatency;
+}
+
+int World::pendingZoneCount() const {
+    return static_cast<int>(m_pendingZoneChunks.size());
+}
+
+void World::markZonePending(int64_t zone) {
+    m_pendingZoneChunks[zone] = 16;
+}
+
+void World::markChunkUploaded(Chunk *c) {
+    c->stampPipeline(STAMP_UPLOADED);
+    // Chunks requested before the pipeline was stamped, or re-meshed
+    // after an edit, have no earlier stamps
+    const std::array<int64_t, PIPELINESTAMPS> &stamps = c->pipelineStamps();
+    if (std::all_of(stamps.begin(), stamps.end(), [](int64_t t) { return t != 0; })) {
+        m_pipelineLatency.record(stamps);
+    }
+    c->clearPipelineStamps();
+    auto it = m_pendingZoneChunks.find(toZoneKey(c->minX, c->minZ));
+    if (it != m_pendingZoneChunks.end() && --it->second <= 0) {
+        m_pendingZoneChunks.erase(it);
+    }
+}
+
+void World::zoneUsage(int64_t zone, size_t *out_bytes, int64_t *out_lastVisible) const {
+    glm::ivec2 origin = toCoords(zone);
+    *out_bytes = 0;
+    *out_lastVisible = 0;
+    for (int i = 0; i < 64; i += 16) {
+        for (int j = 0; j < 64; j += 16) {
+            auto it = m_chunks.find(toKey(origin.x + i, origin.y + j));
+            if (it != m_chunks.end() && it->second) {
+                *out_bytes += it->second->memoryFootprint();
+                *out_lastVisible = std::max(*out_lastVisible, it->second->m_lastVisible);
+            }
+        }
+    }
+}
+
+void World::unloadZone(int64_t zone) {
+    glm::ivec2 origin = toCoords(zone);
+    for (int i = 0; i < 64; i += 16) {
+        for (int j = 0; j < 64; j += 16) {
+            auto it = m_chunks.find(toKey(origin.x + i, origin.y + j));
+            if (it == m_chunks.end()) {
+                continue;
+            }
+            if (it->second) {
+                // Deleting the Chunk frees its mesh along with it
+                saveChunk(it->second.get());
+                it->second->unlinkNeighbors();
+            }
+            m_chunks.erase(it);
+        }
+    }
+    accountChunkIndex();
+    m_generatedTerrain.erase(zone);
+}
+
+bool World::isNearPendingZone(int64_t zone) const {
+    if (m_pendingZoneChunks.empty()) {
+        return false;
+    }
+    glm::ivec2 origin = toCoords(zone);
+    for (int i = -64; i <= 64; i += 64) {
+        for (int j = -64; j <= 64; j += 64) {
+            if (m_pendingZoneChunks.count(toKey(origin.x + i, origin.y + j))) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+int World::unloadZones(glm::vec3 position) {
+    int64_t now = currentMSecs();
+    if (now - m_lastUnloadCheck < 1000) {
+        return 0;
+    }
+    m_lastUnloadCheck = now;
+
+    int playerX = static_cast<int>(glm::floor(position.x / 64.f));
+    int playerZ = static_cast<int>(glm::floor(position.z / 64.f));
+    // Anything inside the work radius would be regenerated right away
+    int keepRadius = std::max(m_keepRadius, m_workRadius + 1);
+
+    std::vector<int64_t> unload;
+    // (last visible time, memory, zone) of zones that may be evicted
+    std::vector<std::tuple<int64_t, size_t, int64_t>> evictable;
+    size_t usage = 0;
+    for (int64_t zone : m_generatedTerrain) {
+        glm::ivec2 coords = toCoords(zone) / 64;
+        int dist = std::max(std::abs(coords.x - playerX), std::abs(coords.y - playerZ));
+        size_t bytes;
+        int64_t lastVisible;
+        zoneUsage(zone, &bytes, &lastVisible);
+        usage += bytes;
+        // Worker threads hold raw pointers to Chunks and their
+        // neighbors, so zones in or next to the pipeline stay for now
+        if (isNearPendingZone(zone)) {
+            continue;
+        }
+        if (dist > keepRadius) {
+            unload.push_back(zone);
+            usage -= bytes;
+        } else if (dist > m_workRadius) {
+            evictable.push_back(std::make_tuple(lastVisible, bytes, zone));
+        }
+    }
+
+    if (usage > m_memoryBudget) {
+        std::sort(evictable.begin(), evictable.end());
+        for (const auto &e : evictable) {
+            if (usage <= m_memoryBudget) {
+                break;
+            }
+            usage -= std::get<1>(e);
+            unload.push_back(std::get<2>(e));
+        }
+    }
+
+    for (int64_t zone : unload) {
+        unloadZone(zone);
+    }
+    return unload.size();
+}
+
+int World::compressColdChunks() {
+    int64_t now = currentMSecs();
+    if (now - m_lastCompressCheck < 1000) {
+        return 0;
+    }
+    m_lastCompressCheck = now;
+
+    int compressed = 0;
+    m_compressedChunks = 0;
+    for (auto &c : m_chunks) {
+        Chunk *chunk = c.second.get();
+        if (chunk == nullptr) {
+            continue;
+        }
+        // A Chunk that was never drawn goes cold counting from now
+        if (chunk->m_lastVisible == 0) {
+            chunk->m_lastVisible = now;
+        }
+        // Workers read Chunks and their neighbors without locking
+        if (now - chunk->m_lastVisible >= m_coldChunkMSecs
+                && !isNearPendingZone(toZoneKey(chunk->minX, chunk->minZ)) && chunk->compress()) {
+            compressed++;
+        }
+        if (chunk->isCompressed()) {
+            m_compressedChunks++;
+        }
+    }
+    return compressed;
+}
+
+int World::compressedChunkCount() const {
+    return m_compressedChunks;
+}
+
+int World::chunkCount() const {
+    return static_cast<int>(m_chunks.size());
+}
+
+size_t World::chunkMemory() const {
+    size_t bytes = 0;
+    for (const auto &c : m_chunks) {
+        if (c.second) {
+            bytes += c.second->memoryFootprint();
+        }
+    }
+    return bytes;
+}
+
+void World::enablePersistence(const std::string &directory, SaveMode mode) {
+    mp_store = mkU<WorldStore>(directory);
+    m_saveMode = mode;
+    m_lastAutosave = currentMSecs();
+}
+
+bool World::loadZone(int x, int z) {
+    if (!mp_store) {
+        return false;
+    }
+    // Read everything first so a partially saved zone is left alone
+    std::array<std::vector<unsigned char>, 16> payloads;
+    for (int i = 0; i < 16; i++) {
+        if (!mp_store->loadChunk(x + 16 * (i % 4), z + 16 * (i / 4), &payloads[i])) {
+            return false;
+        }
+        // Edit deltas go on top of generated terrain; applyZoneEdits
+        // applies them once the zone has been generated
+        if (!Chunk::isFullPayload(payloads[i])) {
+            return false;
+        }
+    }
+
+    std::array<Chunk*, 16> chunks;
+    for (int i = 0; i < 16; i++) {
+        int cx = x + 16 * (i % 4);
+        int cz = z + 16 * (i / 4);
+        // Worker threads must not insert into m_chunks, so the Chunks
+        // of a zone loaded from a BlockTypeWorker already exist
+        auto it = m_chunks.find(toKey(cx, cz));
+        chunks[i] = it != m_chunks.end() ? it->second.get() : instantiateChunkAt(cx, cz);
+    }
+    for (int i = 0; i < 16; i++) {
+        if (!chunks[i]->deserialize(payloads[i])) {
+            std::cout << "Saved zone (" << x << ", " << z << ") is corrupt, regenerating it" << std::endl;
+            for (Chunk *c : chunks) {
+                c->clearBlocks();
+            }
+            return false;
+        }
+    }
+    m_generatedTerrain.insert(toKey(x, z));
+    trackZoneEdits(x, z);
+    return true;
+}
+
+void World::applyZoneEdits(int x, int z) {
+    std::vector<unsigned char> payload;
+    for (int i = 0; mp_store && i < 64; i += 16) {
+        for (int j = 0; j < 64; j += 16) {
+            auto it = m_chunks.find(toKey(x + i, z + j));
+            if (it == m_chunks.end()) {
+                continue;
+            }
+            bool saved = mp_store->loadChunk(x + i, z + j, &payload);
+            // A zone only partly saved in full, say by a crash between
+            // saves, is generated and the saved Chunks replace their
+            // generated versions
+            if (saved && Chunk::isFullPayload(payload)) {
+                it->second->deserialize(payload);
+            } else {
+                if (saved) {
+                    it->second->applyEdits(payload);
+                }
+                // Full saves store generated terrain too, so that
+                // loadZone can read the zone next time instead of
+                // generating it
+                if (m_saveMode == SAVE_FULL_CHUNKS) {
+                    it->second->markUnsaved();
+                }
+            }
+        }
+    }
+    trackZoneEdits(x, z);
+}
+
+bool World::needsSave(const Chunk *c) const {
+    return c->hasUnsavedEdits();
+}
+
+void World::saveChunk(Chunk *c) {
+    if (!mp_store || !needsSave(c)) {
+        return;
+    }
+    std::vector<unsigned char> payload;
+    if (m_saveMode == SAVE_FULL_CHUNKS) {
+        c->serialize(&payload);
+    } else {
+        c->serializeEdits(&payload);
+    }
+    mp_store->saveChunk(c->minX, c->minZ, std::move(payload));
+}
+
+int World::saveDirtyChunks(bool force) {
+    int64_t now = currentMSecs();
+    if (!mp_store || (!force && now - m_lastAutosave < AUTOSAVEINTERVAL)) {
+        return 0;
+    }
+    m_lastAutosave = now;
+
+    int saved = 0;
+    for (auto &c : m_chunks) {
+        Chunk *chunk = c.second.get();
+        if (chunk == nullptr || !needsSave(chunk) ||
+                m_pendingZoneChunks.count(toZoneKey(chunk->minX, chunk->minZ))) {
+            continue;
+        }
+        saveChunk(chunk);
+        saved++;
+    }
+    return saved;
+}
+
+bool gridMarch(glm::vec3 rayOrigin, glm::vec3 rayDirection, const World &terrain, float *out_dist, glm::ivec3 *out_blockHit) {
+    float maxLen = glm::length(rayDirection); // Farthest we search
+    glm::ivec3 currCell = glm::ivec3(glm::floor(rayOrigin));
+    rayDirection = glm::normalize(rayDirection); // Now all t values represent world dist.
+
+    float curr_t = 0.f;
+    while(curr_t < maxLen) {
+        float min_t = glm::sqrt(3.f);
+        float interfaceAxis = -1; // Track axis for which t is smallest
+        for(int i = 0; i < 3; ++i) { // Iterate over the three axes
+            if(rayDirection[i] != 0) { // Is ray parallel to axis i?
+                float offset = glm::max(0.f, glm::sign(rayDirection[i])); // See slide 5
+                // If the player is *exactly* on an interface then
+                // they'll never move if they're looking in a negative direction
+                if(currCell[i] == rayOrigin[i] && offset == 0.f) {
+                    offset = -1.f;
+                }
+                int nextIntercept = currCell[i] + offset;
+                float axis_t = (nextIntercept - rayOrigin[i]) / rayDirection[i];
+                axis_t = glm::min(axis_t, maxLen); // Clamp to max len to avoid super out of bounds errors
+                if(axis_t < min_t) {
+                    min_t = axis_t;
+                    interfaceAxis = i;
+                }
+            }
+        }
+        if(interfaceAxis == -1) {
+            throw std::out_of_range("interfaceAxis was -1 after the for loop in gridMarch!");
+        }
+        curr_t += min_t; // min_t is declared in slide 7 algorithm
+        rayOrigin += rayDirection * min_t;
+        glm::ivec3 offset = glm::ivec3(0,0,0);
+        // Sets it to 0 if sign is +, -1 if sign is -
+        offset[interfaceAxis] = glm::min(0.f, glm::sign(rayDirection[interfaceAxis]));
+        currCell = glm::ivec3(glm::floor(rayOrigin)) + offset;
+        // If currCell contains something other than EMPTY, return
+        // curr_t
+        BlockType cellType = terrain.getBlockAt(currCell.x, currCell.y, currCell.z);
+        if((cellType != EMPTY) && (cellType != WATER) && (cellType != LAVA)) {
+            *out_blockHit = currCell;
+            *out_dist = glm::min(maxLen, curr_t);
+            return true;
+        }
+    }
+    *out_dist = glm::min(maxLen, curr_t);
+    return false;
+}
@@ -0,0 +1,232 @@
+#pragma once
+#include "smartpointerhelp.h"
+#include "chunk.h"
+#include <unordered_map>
+#include <unordered_set>
+#include "progen.h"
+#include "QMutex"
+#include "worldstore.h"
+
+// per side, that is -NUMZONETODRAW to NUMZONETODRAW will be drawn.
+// These are the starting radii; setViewDistance changes them at runtime
+// within [MINZONETODRAW, MAXZONETODRAW], always working one zone further
+// out than drawing.
+#define NUMZONETOWORK 3
+#define NUMZONETODRAW 2
+#define MINZONETODRAW 1
+#define MAXZONETODRAW 5
+// Default retention policy: zones further than NUMZONETOKEEP from the
+// player are unloaded, and zones outside the work radius are evicted least
+// recently visible first while chunk memory exceeds CHUNKMEMORYBUDGET
+#define NUMZONETOKEEP 5
+#define CHUNKMEMORYBUDGET (768ull * 1024 * 1024)
+// Chunks not drawn for this many seconds have their blocks compressed
+#define COLDCHUNKSECONDS 20
+// Milliseconds between background saves of unsaved Chunks
+#define AUTOSAVEINTERVAL 30000
+
+// What World writes when it saves a Chunk. Either kind of save is
+// read back regardless of the current mode.
+enum SaveMode : unsigned char {
+    // The whole RLE-compressed block array; loading skips generation
+    SAVE_FULL_CHUNKS,
+    // Only the blocks changed after generation; loading regenerates
+    // the zone and applies them, so saves scale with edits
+    SAVE_EDIT_DELTAS
+};
+
+// Helper functions to convert (x, z) to and from hash map key
+int64_t toKey(int x, int z);
+glm::ivec2 toCoords(int64_t k);
+// Key of the terrain generation zone containing world-space (x, z)
+int64_t toZoneKey(int x, int z);
+// Milliseconds on a monotonic clock, used to timestamp Chunk visibility
+int64_t currentMSecs();
+
+// Every Chunk of the world and everything that happens to them without
+// a GPU: generation, editing, retention and persistence, and the queues
+// the worker threads pass Chunks through. Terrain adds drawing on top;
+// the worldgen tool uses a World on its own.
+class World {
+private:
+    // We will designate every 64 x 64 area of the world's x-z plane
+    // as one "terrain generation zone". Every time the player moves
+    // near a portion of the world that has not yet been generated
+    // (i.e. its lower-left coordinates are not in this set), a new
+    // 4 x 4 collection of Chunks is created to represent that area
+    // of the world.
+    // The world that exists when the base code is run consists of exactly
+    // one 64 x 64 area with its lower-left corner at (0, 0).
+    // When milestone 1 has been implemented, the Player can move around the
+    // world to add more "terrain generation zone" IDs to this set.
+    // While only the 3 x 3 collection of terrain generation zones
+    // surrounding the Player should be rendered, the Chunks
+    // in the World stay loaded until unloadZones() decides the zone
+    // is too far away or memory is over budget, at which point the zone
+    // is removed from this set and regenerated when the Player returns.
+    std::unordered_set<int64_t> m_generatedTerrain;
+
+    // Number of Chunks per zone that are still being generated or
+    // meshed on a worker thread. Workers hold raw Chunk pointers,
+    // so these zones and their neighbors are not unloaded.
+    std::unordered_map<int64_t, int> m_pendingZoneChunks;
+    // Request to upload latencies of the Chunks of generated zones
+    PipelineLatency m_pipelineLatency;
+    // Zones drawn and generated around the player, per side
+    int m_drawRadius;
+    int m_workRadius;
+    int m_keepRadius;
+    size_t m_memoryBudget;
+    int64_t m_lastUnloadCheck;
+
+    // Milliseconds a Chunk must go undrawn before it is compressed
+    int64_t m_coldChunkMSecs;
+    int64_t m_lastCompressCheck;
+    int m_compressedChunks;
+
+    // Where Chunks are saved to and loaded from. Null when the world
+    // is not persisted.
+    uPtr<WorldStore> mp_store;
+    SaveMode m_saveMode;
+    int64_t m_lastAutosave;
+
+    ProGen progen;
+
+    BlockType getBlockTypeAtHeight(int x, int y, int z, int blockType, bool top);
+    // Sums the memory and finds the latest visible time of a zone's Chunks
+    void zoneUsage(int64_t zone, size_t *out_bytes, int64_t *out_lastVisible) const;
+    // Saves and deletes every Chunk in the zone
+    void unloadZone(int64_t zone);
+    // Whether a worker may be reading the zone's Chunks: it or one of
+    // the eight zones around it is pending
+    bool isNearPendingZone(int64_t zone) const;
+    // Makes later block changes in the zone count as edits
+    void trackZoneEdits(int x, int z);
+    // Whether the Chunk changed since it was last saved or loaded. In
+    // SAVE_FULL_CHUNKS mode generated Chunks count as changed.
+    bool needsSave(const Chunk *c) const;
+    // Queues a save of the Chunk if it has changed since it was loaded
+    void saveChunk(Chunk *c);
+
+protected:
+    // Stores every Chunk according to the location of its lower-left corner
+    // in world space.
+    // We combine the X and Z coordinates of the Chunk's corner into one 64-bit int
+    // so that we can use them as a key for the map, as objects like std::pairs or
+    // glm::ivec2s are not hashable by default, so they cannot be used as keys.
+    std::unordered_map<int64_t, uPtr<Chunk>> m_chunks;
+    // Buckets and nodes of m_chunks, as MEMORY_CHUNK_INDEX
+    MemoryAccount m_indexMemory;
+    // Brings m_indexMemory up to date after Chunks were added or removed
+    void accountChunkIndex();
+
+    // Looks up the Chunk at world-space (x, z) without decompressing
+    // it, or returns null if there is none
+    Chunk *findChunk(int x, int z) const;
+    // Saves and deletes every Chunk. A subclass whose state the Chunks
+    // refer to calls this from its own destructor.
+    void releaseChunks();
+
+public:
+    World();
+    virtual ~World();
+
+    // The topmost block terrain generation puts in column (x, z),
+    // computed without any Chunk; its Y goes in out_height.
+    // Safe to call from any thread.
+    BlockType generatedSurfaceAt(int x, int z, int *out_height);
+
+    // threads manipulation data
+    std::vector<Chunk*> m_chunksWithOnlyBlockData;
+    QMutex m_chunksWithOnlyBlockDataLock;
+    std::vector<ChunkVBOData> m_chunksWithVBOData;
+    QMutex m_chunksWithVBODataLock;
+
+    // Instantiates a new Chunk and stores it in
+    // our chunk map at the given coordinates.
+    // Returns a pointer to the created Chunk.
+    Chunk* instantiateChunkAt(int x, int z);
+    // Do these world-space coordinates lie within
+    // a Chunk that exists?
+    bool hasChunkAt(int x, int z) const;
+    // Assuming a Chunk exists at these coords,
+    // return a mutable reference to it, decompressing it if needed
+    uPtr<Chunk>& getChunkAt(int x, int z);
+    // Assuming a Chunk exists at these coords,
+    // return a const reference to it, decompressing it if needed
+    const uPtr<Chunk>& getChunkAt(int x, int z) const;
+    // Given a world-space coordinate (which may have negative
+    // values) return the block stored at that point in space.
+    BlockType getBlockAt(int x, int y, int z) const;
+    BlockType getBlockAt(glm::vec3 p) const;
+    // Given a world-space coordinate (which may have negative
+    // values) set the block at that point in space to the
+    // given type.
+    void setBlockAt(int x, int y, int z, BlockType t);
+
+    Chunk* createChunkAt(int x, int z);
+    std::vector<int64_t> checkExpansion(glm::vec3 position);
+    // Keeps checkExpansion from handing out a zone that was generated
+    // or loaded some other way. Only call from the GL thread.
+    void markZoneGenerated(int64_t zone);
+
+    // Fills the blocks of the zone whose lower-left corner is (x, z),
+    // creating its Chunks if needed
+    void createTerrainZone(int x, int z);
+
+    // Zones further than keepRadius zones from the player are always
+    // unloaded; beyond the work radius, zones are also unloaded while the
+    // loaded Chunks use more than memoryBudget bytes. The keep radius
+    // never drops below the work radius plus one.
+    void setRetention(int keepRadius, size_t memoryBudget);
+    // Sets how many zones per side are drawn, clamped to
+    // [MINZONETODRAW, MAXZONETODRAW]; zones are generated one further
+    void setViewDistance(int drawRadius);
+    int drawRadius() const;
+    int workRadius() const;
+    // Bookkeeping for zones handed to the worker threads
+    void markZonePending(int64_t zone);
+    // Call once the mesh a VBOWorker made for the Chunk has been
+    // consumed. Also records how long the Chunk took to get through
+    // the pipeline.
+    void markChunkUploaded(Chunk *c);
+    const PipelineLatency &pipelineLatency() const;
+    // Number of zones still being generated or meshed
+    int pendingZoneCount() const;
+    // Applies the retention policy around the given position.
+    // Returns the number of zones unloaded.
+    int unloadZones(glm::vec3 position);
+    // Compresses the blocks of loaded Chunks that have not been drawn
+    // for COLDCHUNKSECONDS, except near zones still in the pipeline.
+    // They are decompressed again on first access. Returns the number
+    // of Chunks compressed.
+    int compressColdChunks();
+    // Number of Chunks found compressed by the last compressColdChunks
+    int compressedChunkCount() const;
+    // Number of loaded Chunks and the memory they hold, in bytes
+    int chunkCount() const;
+    size_t chunkMemory() const;
+
+    // Saves the world's Chunks under the given directory from now on,
+    // and loads previously saved Chunks from it instead of generating them
+    void enablePersistence(const std::string &directory, SaveMode mode);
+    // Fills the zone whose lower-left corner is (x, z) from disk,
+    // creating its Chunks if needed. Only succeeds if all 16 Chunks
+    // were saved in full; returns false otherwise, and the zone must
+    // be generated.
+    bool loadZone(int x, int z);
+    // Applies saved edit deltas, and Chunks saved in full, to the
+    // freshly generated zone at (x, z), rivers included. In
+    // SAVE_FULL_CHUNKS mode the generated Chunks are marked for saving.
+    // Any change to the zone after this is an edit.
+    void applyZoneEdits(int x, int z);
+    // Queues a save of every Chunk needsSave picks that is not owned by
+    // a worker thread. Unless force is set, does nothing until
+    // AUTOSAVEINTERVAL has passed since the last save. Returns the
+    // number of Chunks saved.
+    int saveDirtyChunks(bool force);
+};
+
+// Steps through the blocks along rayDirection, up to its length, and
+// reports the first one that is not empty or a fluid
+bool gridMarch(glm::vec3 rayOrigin, glm::vec3 rayDirection, const World &terrain, float *out_dist, glm::ivec3 *out_blockHit);
@@ -0,0 +1,93 @@
+#include "worldstore.h"
+#include "world.h"
+#include <QDir>
+#include <QThreadPool>
+#include <iostream>
+
+WorldStore::WorldStore(const std::string &directory)
+    : m_directory(directory), m_lock(), m_regions(), m_pendingWrites(), m_writerQueued(false)
+{
+    if (!QDir().mkpath(QString::fromStdString(directory))) {
+        std::cout << "Could not create save directory " << directory << std::endl;
+    }
+}
+
+WorldStore::~WorldStore() {
+    // A RegionWriteWorker may still be queued with a pointer to us
+    QThreadPool::globalInstance()->waitForDone();
+    flush();
+}
+
+const std::string &WorldStore::directory() const {
+    return m_directory;
+}
+
+RegionFile *WorldStore::regionFor(int x, int z) {
+    int regionX = static_cast<int>(glm::floor(x / (16.f * RegionFile::REGION_CHUNKS)));
+    int regionZ = static_cast<int>(glm::floor(z / (16.f * RegionFile::REGION_CHUNKS)));
+    int64_t key = toKey(regionX, regionZ);
+    auto it = m_regions.find(key);
+    if (it == m_regions.end()) {
+        std::string path = m_directory + "/r." + std::to_string(regionX) + "."
+                + std::to_string(regionZ) + ".mmr";
+        it = m_regions.emplace(key, mkU<RegionFile>(path)).first;
+    }
+    return it->second.get();
+}
+
+bool WorldStore::hasChunk(int x, int z) {
+    QMutexLocker locker(&m_lock);
+    if (m_pendingWrites.find(toKey(x, z)) != m_pendingWrites.end()) {
+        return true;
+    }
+    return regionFor(x, z)->hasChunk(RegionFile::slotOf(x / 16, z / 16));
+}
+
+bool WorldStore::loadChunk(int x, int z, std::vector<unsigned char> *out) {
+    QMutexLocker locker(&m_lock);
+    auto pending = m_pendingWrites.find(toKey(x, z));
+    if (pending != m_pendingWrites.end()) {
+        *out = pending->second;
+        return true;
+    }
+    return regionFor(x, z)->readChunk(RegionFile::slotOf(x / 16, z / 16), out);
+}
+
+void WorldStore::saveChunk(int x, int z, std::vector<unsigned char> &&payload) {
+    QMutexLocker locker(&m_lock);
+    m_pendingWrites[toKey(x, z)] = std::move(payload);
+    if (!m_writerQueued) {
+        m_writerQueued = true;
+        QThreadPool::globalInstance()->start(new RegionWriteWorker(this));
+    }
+}
+
+void WorldStore::writePendingLocked() {
+    for (auto &p : m_pendingWrites) {
+        glm::ivec2 coords = toCoords(p.first);
+        regionFor(coords.x, coords.y)->writeChunk(
+                    RegionFile::slotOf(coords.x / 16, coords.y / 16), p.second);
+    }
+    m_pendingWrites.clear();
+}
+
+void WorldStore::flush() {
+    QMutexLocker locker(&m_lock);
+    writePendingLocked();
+    for (auto &r : m_regions) {
+        r.second->flush();
+    }
+}
+
+RegionWriteWorker::RegionWriteWorker(WorldStore *store)
+    : mp_store(store)
+{}
+
+void RegionWriteWorker::run() {
+    QMutexLocker locker(&mp_store->m_lock);
+    mp_store->m_writerQueued = false;
+    mp_store->writePendingLocked();
+    for (auto &r : mp_store->m_regions) {
+        r.second->flush();
+    }
+}
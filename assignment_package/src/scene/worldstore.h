@@ -0,0 +1,59 @@
+#pragma once
+#include "smartpointerhelp.h"
+#include "regionfile.h"
+#include <QMutex>
+#include <QRunnable>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// On-disk storage for a world's Chunks, split into region files named
+// r.<regionX>.<regionZ>.mmr inside one directory. Chunks are addressed
+// by the world-space coordinates of their lower-left corner.
+// Saves are queued and written to disk by a RegionWriteWorker on the
+// global thread pool, so the GL thread never waits on file I/O; a load
+// of a Chunk whose save is still queued returns the queued payload.
+// All public functions are thread-safe.
+class WorldStore {
+private:
+    std::string m_directory;
+    // Guards every member below
+    QMutex m_lock;
+    // Open region files, keyed by toKey(regionX, regionZ)
+    std::unordered_map<int64_t, uPtr<RegionFile>> m_regions;
+    // Payloads waiting to be written, keyed by toKey(chunkX, chunkZ)
+    std::unordered_map<int64_t, std::vector<unsigned char>> m_pendingWrites;
+    // Whether a RegionWriteWorker has been started and not yet run
+    bool m_writerQueued;
+
+    // Must be called with m_lock held
+    RegionFile *regionFor(int x, int z);
+    void writePendingLocked();
+
+public:
+    WorldStore(const std::string &directory);
+    // Waits for the thread pool, then writes anything still queued
+    ~WorldStore();
+
+    const std::string &directory() const;
+    bool hasChunk(int x, int z);
+    // Reads the payload of the Chunk at (x, z). Returns false if the
+    // Chunk has never been saved.
+    bool loadChunk(int x, int z, std::vector<unsigned char> *out);
+    // Queues a payload to be written in the background
+    void saveChunk(int x, int z, std::vector<unsigned char> &&payload);
+    // Writes every queued payload now and flushes the region files
+    void flush();
+
+    friend class RegionWriteWorker;
+};
+
+// Drains a WorldStore's queued writes on a worker thread
+class RegionWriteWorker : public QRunnable {
+private:
+    WorldStore *mp_store;
+
+public:
+    RegionWriteWorker(WorldStore *store);
+    void run() override;
+};
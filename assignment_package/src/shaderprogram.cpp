@@ -4,20 +4,24 @@
 #include <QTextStream>
 #include <QDebug>
 #include <stdexcept>
+#include <cstring>
 #include "texture.h"
 
 
 ShaderProgram::ShaderProgram(OpenGLContext *context)
     : vertShader(), fragShader(), prog(),
     attrPos(-1), attrNor(-1), attrUV(-1), attrAnimatable(-1), attrPosOffset(-1), attrBodyPart(-1),
-    unifModel(-1), unifModelInvTr(-1), unifViewProj(-1), unifColor(-1), unifShadowViewProj(-1),
-    unifDimension(-1), unifEye(-1), unifSampler2D(-1), unifDepthSampler2D(-1), unifTime(-1),
-    unifTimeElp(-1), unifCameraPos(-1),
-    unifFrame(-1), unifAnime(-1),
-    context(context)
+    unifSampler2D(-1), unifDepthSampler2D(-1),
+    m_uniformValues(), context(context)
 {}
 
 void ShaderProgram::create(const char *vertfile, const char *fragfile)
+{
+    compile(vertfile, fragfile);
+    finishCreate();
+}
+
+void ShaderProgram::compile(const char *vertfile, const char *fragfile)
 {
     // Allocate space on our GPU for a vertex shader and a fragment shader and a shader program to manage the two
     vertShader = context->glCreateShader(GL_VERTEX_SHADER);
@@ -39,7 +43,24 @@ void ShaderProgram::create(const char *vertfile, const char *fragfile)
     // Tell OpenGL to compile the shader text stored above
     context->glCompileShader(vertShader);
     context->glCompileShader(fragShader);
-    // Check if everything compiled OK
+
+    // Tell prog that it manages these particular vertex and fragment shaders
+    context->glAttachShader(prog, vertShader);
+    context->glAttachShader(prog, fragShader);
+    context->glBindAttribLocation(prog, ATTR_LOC_POS, "vs_Pos");
+    context->glBindAttribLocation(prog, ATTR_LOC_NOR, "vs_Nor");
+    context->glBindAttribLocation(prog, ATTR_LOC_UV, "vs_UV");
+    context->glBindAttribLocation(prog, ATTR_LOC_ANIMATABLE, "vs_isAnimatable");
+    context->glBindAttribLocation(prog, ATTR_LOC_COL, "vs_Col");
+    context->glBindAttribLocation(prog, ATTR_LOC_OFFSET, "vs_OffsetInstanced");
+    context->glBindAttribLocation(prog, ATTR_LOC_PART, "vs_Part");
+    context->glLinkProgram(prog);
+}
+
+void ShaderProgram::finishCreate()
+{
+    // Check if everything compiled OK. These are the first queries
+    // that wait for the driver.
     GLint compiled;
     context->glGetShaderiv(vertShader, GL_COMPILE_STATUS, &compiled);
     if (!compiled) {
@@ -49,11 +70,7 @@ void ShaderProgram::create(const char *vertfile, const char *fragfile)
     if (!compiled) {
         printShaderInfoLog(fragShader);
     }
-
-    // Tell prog that it manages these particular vertex and fragment shaders
-    context->glAttachShader(prog, vertShader);
-    context->glAttachShader(prog, fragShader);
-    context->glLinkProgram(prog);
+    m_uniformValues.clear();
 
     // Check for linking success
     GLint linked;
@@ -74,119 +91,50 @@ void ShaderProgram::create(const char *vertfile, const char *fragfile)
     attrPosOffset = context->glGetAttribLocation(prog, "vs_OffsetInstanced");
     attrBodyPart = context->glGetAttribLocation(prog, "vs_Part");
 
-    unifModel          = context->glGetUniformLocation(prog, "u_Model");
-    unifModelInvTr     = context->glGetUniformLocation(prog, "u_ModelInvTr");
-    unifViewProj       = context->glGetUniformLocation(prog, "u_ViewProj");
-    unifColor          = context->glGetUniformLocation(prog, "u_Color");
-    unifShadowViewProj = context->glGetUniformLocation(prog, "u_ShadowViewProj");
-    unifDimension      = context->glGetUniformLocation(prog, "u_Dimensions");
-    unifEye            = context->glGetUniformLocation(prog, "u_Eye");
     unifSampler2D      = context->glGetUniformLocation(prog, "u_Texture");
     unifDepthSampler2D = context->glGetUniformLocation(prog, "u_Depth");
-    unifTime           = context->glGetUniformLocation(prog, "u_Time");
-    unifTimeElp        = context->glGetUniformLocation(prog, "u_TimeElapsed");
-    unifCameraPos = context->glGetUniformLocation(prog, "u_CameraPos");
-    unifFrame = context->glGetUniformLocation(prog, "u_CurrFrame");
-    unifAnime = context->glGetUniformLocation(prog, "u_Animation");
-}
 
-void ShaderProgram::useMe()
-{
-    context->glUseProgram(prog);
-}
-
-void ShaderProgram::setModelMatrix(const glm::mat4 &model)
-{
-    useMe();
-
-    if (unifModel != -1) {
-        // Pass a 4x4 matrix into a uniform variable in our shader
-        // Handle to the matrix variable on the GPU
-        context->glUniformMatrix4fv(unifModel,
-                                    // How many matrices to pass
-                                    1,
-                                    // Transpose the matrix? OpenGL uses column-major, so no.
-                                    GL_FALSE,
-                                    // Pointer to the first element of the matrix
-                                    &model[0][0]);
+    // Point the shared blocks, if this program reads them, at the
+    // buffers UniformBlocks binds
+    GLuint frameBlock = context->glGetUniformBlockIndex(prog, "FrameUniforms");
+    if (frameBlock != GL_INVALID_INDEX) {
+        context->glUniformBlockBinding(prog, frameBlock, FRAMEUNIFORMBINDING);
     }
-
-    if (unifModelInvTr != -1) {
-        glm::mat4 modelinvtr = glm::inverse(glm::transpose(model));
-        // Pass a 4x4 matrix into a uniform variable in our shader
-        // Handle to the matrix variable on the GPU
-        context->glUniformMatrix4fv(unifModelInvTr,
-                                    // How many matrices to pass
-                                    1,
-                                    // Transpose the matrix? OpenGL uses column-major, so no.
-                                    GL_FALSE,
-                                    // Pointer to the first element of the matrix
-                                    &modelinvtr[0][0]);
+    GLuint drawBlock = context->glGetUniformBlockIndex(prog, "DrawUniforms");
+    if (drawBlock != GL_INVALID_INDEX) {
+        context->glUniformBlockBinding(prog, drawBlock, DRAWUNIFORMBINDING);
     }
 }
 
-void ShaderProgram::setViewProjMatrix(const glm::mat4 &vp)
+void ShaderProgram::useMe()
 {
-    // Tell OpenGL to use this shader program for subsequent function calls
-    useMe();
-
-    if(unifViewProj != -1) {
-        // Pass a 4x4 matrix into a uniform variable in our shader
-        // Handle to the matrix variable on the GPU
-        context->glUniformMatrix4fv(unifViewProj,
-                                    // How many matrices to pass
-                                    1,
-                                    // Transpose the matrix? OpenGL uses column-major, so no.
-                                    GL_FALSE,
-                                    // Pointer to the first element of the matrix
-                                    &vp[0][0]);
-    }
+    context->glState().useProgram(prog);
 }
 
-void ShaderProgram::setShadowViewProjMatrix(const glm::mat4 &vp)
+bool ShaderProgram::uniformChanged(int location, const void *value, size_t bytes)
 {
-    // Tell OpenGL to use this shader program for subsequent function calls
-    useMe();
-
-    if(unifShadowViewProj != -1) {
-        // Pass a 4x4 matrix into a uniform variable in our shader
-        // Handle to the matrix variable on the GPU
-        context->glUniformMatrix4fv(unifShadowViewProj,
-                                    // How many matrices to pass
-                                    1,
-                                    // Transpose the matrix? OpenGL uses column-major, so no.
-                                    GL_FALSE,
-                                    // Pointer to the first element of the matrix
-                                    &vp[0][0]);
+    std::vector<unsigned char> &last = m_uniformValues[location];
+    bool changed = last.size() != bytes || std::memcmp(last.data(), value, bytes) != 0;
+    if (changed) {
+        last.assign(static_cast<const unsigned char*>(value), static_cast<const unsigned char*>(value) + bytes);
     }
+    context->glState().countUniform(!changed);
+    return changed;
 }
 
-void ShaderProgram::setGeometryColor(glm::vec4 color)
+void ShaderProgram::setModelMatrix(const glm::mat4 &model)
 {
-    useMe();
-
-    if(unifColor != -1)
-    {
-        context->glUniform4fv(unifColor, 1, &color[0]);
-    }
+    context->uniforms().setModel(model);
 }
 
-void ShaderProgram::setDimension(int width, int height) {
-    useMe();
-
-    if(unifDimension != -1)
-    {
-        context->glUniform2i(unifDimension, width, height);
-    }
+void ShaderProgram::setGeometryColor(glm::vec4 color)
+{
+    context->uniforms().setColor(color);
 }
 
-void ShaderProgram::setEye(glm::vec3 eye) {
-    useMe();
-
-    if(unifEye != -1)
-    {
-        context->glUniform3fv(unifEye, 1, &eye[0]);
-    }
+void ShaderProgram::setAnimation(int animation, int currFrame)
+{
+    context->uniforms().setAnimation(animation, currFrame);
 }
 
 //This function, as its name implies, uses the passed in GL widget
@@ -198,140 +146,55 @@ void ShaderProgram::draw(Drawable &d)
         throw std::out_of_range("Attempting to draw a drawable with m_count of " + std::to_string(d.elemCount()) + "!");
     }
 
-    // Each of the following blocks checks that:
-    //   * This shader has this attribute, and
-    //   * This Drawable has a vertex buffer for this attribute.
-    // If so, it binds the appropriate buffers to each attribute.
-
-    // Remember, by calling bindPos(), we call
-    // glBindBuffer on the Drawable's VBO for vertex position,
-    // meaning that glVertexAttribPointer associates vs_Pos
-    // (referred to by attrPos) with that VBO
-    if (attrPos != -1 && d.bindPos()) {
-        context->glEnableVertexAttribArray(attrPos);
-        context->glVertexAttribPointer(attrPos, 4, GL_FLOAT, false, 0, NULL);
-    }
-
-    if (attrNor != -1 && d.bindNor()) {
-        context->glEnableVertexAttribArray(attrNor);
-        context->glVertexAttribPointer(attrNor, 4, GL_FLOAT, false, 0, NULL);
-    }
-
-
-    if (attrCol != -1 && d.bindCol()) {
-        context->glEnableVertexAttribArray(attrCol);
-        context->glVertexAttribPointer(attrCol, 4, GL_FLOAT, false, 0, NULL);
-    }
-
-    // Bind the index buffer and then draw shapes from it.
-    // This invokes the shader program, which accesses the vertex buffers.
-    d.bindIdx();
+    // The Drawable's VAO remembers which of its buffers feed which
+    // attribute, and its index buffer, so there is nothing to set up
+    // per draw
+    context->uniforms().flushDraw();
+    d.bindVAO(LAYOUT_SEPARATE);
     context->glDrawElements(d.drawMode(), d.elemCount(), GL_UNSIGNED_INT, 0);
-
-    if (attrPos != -1) context->glDisableVertexAttribArray(attrPos);
-    if (attrNor != -1) context->glDisableVertexAttribArray(attrNor);
-    if (attrCol != -1) context->glDisableVertexAttribArray(attrCol);
+    context->glState().countDraws(1, d.drawMode() == GL_TRIANGLES ? d.elemCount() / 3 : 0);
 
     context->printGLErrorLog();
 }
 
-void ShaderProgram::drawInterleaved(Drawable &d, int textureSlot = 0, int depthSlot = 1) {
+void ShaderProgram::setSamplers(int textureSlot, int depthSlot) {
     useMe();
 
-    if(d.elemCount() < 0) {
-        throw std::out_of_range("Error: Draw a drawable with m_count of " + std::to_string(d.elemCount()) + "!");
-    }
-
-
-    if(unifSampler2D != -1)
+    if(unifSampler2D != -1 && uniformChanged(unifSampler2D, &textureSlot, sizeof(int)))
     {
         context->glUniform1i(unifSampler2D, /*GL_TEXTURE*/textureSlot);
     }
 
-    if(unifDepthSampler2D != -1)
+    if(unifDepthSampler2D != -1 && uniformChanged(unifDepthSampler2D, &depthSlot, sizeof(int)))
     {
         context->glUniform1i(unifDepthSampler2D, /*GL_TEXTURE*/depthSlot);
     }
+}
 
-    if (d.bindAll()){
-        if (attrPos != -1) {
-            context->glEnableVertexAttribArray(attrPos);
-            context->glVertexAttribPointer(attrPos, 4, GL_FLOAT, false, 3 * sizeof(glm::vec4), (void*)0);
-        }
-
-        if (attrNor != -1){
-            context->glEnableVertexAttribArray(attrNor);
-            context->glVertexAttribPointer(attrNor, 4, GL_FLOAT, false, 3 * sizeof(glm::vec4), (void*)sizeof(glm::vec4));
-        }
-        if (attrUV != -1){
-            context->glEnableVertexAttribArray(attrUV);
-            context->glVertexAttribPointer(attrUV, 2, GL_FLOAT, false, 3 * sizeof(glm::vec4), (void*)(2*sizeof(glm::vec4)));
-        }
-        if (attrAnimatable != -1){
-            context->glEnableVertexAttribArray(attrAnimatable);
-            context->glVertexAttribPointer(attrAnimatable, 1, GL_FLOAT, false, 3 * sizeof(glm::vec4), (void*)(2*sizeof(glm::vec4) + 3*sizeof(float)));
-        }
-        if (attrBodyPart != -1){
-            context->glEnableVertexAttribArray(attrBodyPart);
-            context->glVertexAttribPointer(attrBodyPart, 1, GL_FLOAT, false, 3 * sizeof(glm::vec4), (void*)(2*sizeof(glm::vec4) + 3*sizeof(float)));
-        }
+void ShaderProgram::drawInterleaved(Drawable &d, int textureSlot = 0, int depthSlot = 1) {
+    if(d.elemCount() < 0) {
+        throw std::out_of_range("Error: Draw a drawable with m_count of " + std::to_string(d.elemCount()) + "!");
     }
-    d.bindIdx();
-    context->glDrawElements(d.drawMode(), d.elemCount(), GL_UNSIGNED_INT, 0);
 
-    if (attrPos != -1) context->glDisableVertexAttribArray(attrPos);
-    if (attrNor != -1) context->glDisableVertexAttribArray(attrNor);
-    //if (attrCol != -1) context->glDisableVertexAttribArray(attrCol);
-    if (attrUV != -1) context->glDisableVertexAttribArray(attrUV);
+    setSamplers(textureSlot, depthSlot);
+    context->uniforms().flushDraw();
+    d.bindVAO(LAYOUT_INTERLEAVED);
+    context->glDrawElements(d.drawMode(), d.elemCount(), GL_UNSIGNED_INT, 0);
+    context->glState().countDraws(1, d.drawMode() == GL_TRIANGLES ? d.elemCount() / 3 : 0);
 
     context->printGLErrorLog();
-
 }
 
 void ShaderProgram::drawTransInterleaved(Drawable &d, int textureSlot = 0, int depthSlot = 1){
-    useMe();
-
     if(d.transCount() < 0) {
         throw std::out_of_range("Error: Draw a drawable with m_count of " + std::to_string(d.elemCount()) + "!");
     }
 
-
-    if(unifSampler2D != -1)
-    {
-        context->glUniform1i(unifSampler2D, /*GL_TEXTURE*/textureSlot);
-    }
-
-    if(unifDepthSampler2D != -1)
-    {
-        context->glUniform1i(unifDepthSampler2D, /*GL_TEXTURE*/depthSlot);
-    }
-
-    if (d.bindTransAll()){
-        if (attrPos != -1) {
-            context->glEnableVertexAttribArray(attrPos);
-            context->glVertexAttribPointer(attrPos, 4, GL_FLOAT, false, 3 * sizeof(glm::vec4), (void*)0);
-        }
-
-        if (attrNor != -1){
-            context->glEnableVertexAttribArray(attrNor);
-            context->glVertexAttribPointer(attrNor, 4, GL_FLOAT, false, 3 * sizeof(glm::vec4), (void*)sizeof(glm::vec4));
-        }
-        if (attrUV != -1){
-            context->glEnableVertexAttribArray(attrUV);
-            context->glVertexAttribPointer(attrUV, 2, GL_FLOAT, false, 3 * sizeof(glm::vec4), (void*)(2*sizeof(glm::vec4)));
-        }
-        if (attrAnimatable != -1){
-            context->glEnableVertexAttribArray(attrAnimatable);
-            context->glVertexAttribPointer(attrAnimatable, 1, GL_FLOAT, false, 3 * sizeof(glm::vec4), (void*)(2*sizeof(glm::vec4) + 3*sizeof(float)));
-        }
-    }
-    d.bindTransIdx();
+    setSamplers(textureSlot, depthSlot);
+    context->uniforms().flushDraw();
+    d.bindTransVAO();
     context->glDrawElements(d.drawMode(), d.transCount(), GL_UNSIGNED_INT, 0);
-
-    if (attrPos != -1) context->glDisableVertexAttribArray(attrPos);
-    if (attrNor != -1) context->glDisableVertexAttribArray(attrNor);
-    //if (attrCol != -1) context->glDisableVertexAttribArray(attrCol);
-    if (attrUV != -1) context->glDisableVertexAttribArray(attrUV);
+    context->glState().countDraws(1, d.drawMode() == GL_TRIANGLES ? d.transCount() / 3 : 0);
 
     context->printGLErrorLog();
 }
@@ -344,59 +207,11 @@ void ShaderProgram::drawInstanced(InstancedDrawable &d)
         throw std::out_of_range("Attempting to draw a drawable with m_count of " + std::to_string(d.elemCount()) + "!");
     }
 
-    // Each of the following blocks checks that:
-    //   * This shader has this attribute, and
-    //   * This Drawable has a vertex buffer for this attribute.
-    // If so, it binds the appropriate buffers to each attribute.
-
-    // Remember, by calling bindPos(), we call
-    // glBindBuffer on the Drawable's VBO for vertex position,
-    // meaning that glVertexAttribPointer associates vs_Pos
-    // (referred to by attrPos) with that VBO
-    if (attrPos != -1 && d.bindPos()) {
-        context->glEnableVertexAttribArray(attrPos);
-        context->glVertexAttribPointer(attrPos, 4, GL_FLOAT, false, 0, NULL);
-        context->glVertexAttribDivisor(attrPos, 0);
-    }
-
-    if (attrNor != -1 && d.bindNor()) {
-        context->glEnableVertexAttribArray(attrNor);
-        context->glVertexAttribPointer(attrNor, 4, GL_FLOAT, false, 0, NULL);
-        context->glVertexAttribDivisor(attrNor, 0);
-    }
-
-    /**
-    if (attrCol != -1 && d.bindCol()) {
-        context->glEnableVertexAttribArray(attrCol);
-        context->glVertexAttribPointer(attrCol, 3, GL_FLOAT, false, 0, NULL);
-        context->glVertexAttribDivisor(attrCol, 1);
-    }
-    **/
-
-    if (attrUV != -1 && d.bindCol()) {
-        context->glEnableVertexAttribArray(attrUV);
-        context->glVertexAttribPointer(attrUV, 2, GL_FLOAT, false, 0, NULL);
-        context->glVertexAttribDivisor(attrUV, 0);
-    }
-
-    if (attrPosOffset != -1 && d.bindOffsetBuf()) {
-        context->glEnableVertexAttribArray(attrPosOffset);
-        context->glVertexAttribPointer(attrPosOffset, 3, GL_FLOAT, false, 0, NULL);
-        context->glVertexAttribDivisor(attrPosOffset, 1);
-    }
-
-    // Bind the index buffer and then draw shapes from it.
-    // This invokes the shader program, which accesses the vertex buffers.
-    d.bindIdx();
+    context->uniforms().flushDraw();
+    d.bindVAO(LAYOUT_INSTANCED);
     context->glDrawElementsInstanced(d.drawMode(), d.elemCount(), GL_UNSIGNED_INT, 0, d.instanceCount());
+    context->glState().countDraws(1, d.drawMode() == GL_TRIANGLES ? int64_t(d.elemCount() / 3) * d.instanceCount() : 0);
     context->printGLErrorLog();
-
-    if (attrPos != -1) context->glDisableVertexAttribArray(attrPos);
-    if (attrNor != -1) context->glDisableVertexAttribArray(attrNor);
-    //if (attrCol != -1) context->glDisableVertexAttribArray(attrCol);
-    if (attrUV != -1) context->glDisableVertexAttribArray(attrUV);
-    if (attrPosOffset != -1) context->glDisableVertexAttribArray(attrPosOffset);
-
 }
 
 char* ShaderProgram::textFileRead(const char* fileName) {
@@ -474,52 +289,3 @@ void ShaderProgram::printLinkInfoLog(int prog)
         delete [] infoLog;
     }
 }
-
-void ShaderProgram::setTime(int time)
-{
-    useMe();
-
-    if(unifTime != -1)
-    {
-        context->glUniform1i(unifTime, time);
-    }
-}
-
-void ShaderProgram::setTimeElp(float timeElp)
-{
-    useMe();
-
-    if(unifTimeElp != -1)
-    {
-        context->glUniform1f(unifTimeElp, timeElp);
-    }
-}
-
-void ShaderProgram::setCameraPos(glm::vec3 eye){
-    useMe();
-
-    if(unifCameraPos != -1)
-    {
-        context->glUniform3fv(unifCameraPos, 1, &eye[0]);
-    }
-}
-
-void ShaderProgram::setAnimation(int i)
-{
-    useMe();
-
-    if(unifAnime != -1)
-    {
-        context->glUniform1i(unifAnime, i);
-    }
-}
-
-void ShaderProgram::setCurrFrame(int i)
-{
-    useMe();
-
-    if(unifFrame != -1)
-    {
-        context->glUniform1i(unifFrame, i);
-    }
-}
@@ -6,6 +6,8 @@
 #include <glm/glm.hpp>
 
 #include "drawable.h"
+#include <unordered_map>
+#include <vector>
 
 
 class ShaderProgram
@@ -23,40 +25,30 @@ public:
     int attrPosOffset; // A handle for a vec3 used only in the instanced rendering shader
     int attrBodyPart;
 
-    int unifModel; // A handle for the "uniform" mat4 representing model matrix in the vertex shader
-    int unifModelInvTr; // A handle for the "uniform" mat4 representing inverse transpose of the model matrix in the vertex shader
-    int unifViewProj; // A handle for the "uniform" mat4 representing combined projection and view matrices in the vertex shader
-    int unifColor; // A handle for the "uniform" vec4 representing color of geometry in the vertex shader
-    int unifShadowViewProj;
-
-    int unifDimension;
-    int unifEye;
     int unifSampler2D;
     int unifDepthSampler2D;
-    int unifTime;
-    int unifTimeElp;
-    int unifCameraPos;
-    int unifFrame;
-    int unifAnime;
 
 public:
     ShaderProgram(OpenGLContext* context);
     // Sets up the requisite GL data and shaders from the given .glsl files
     void create(const char *vertfile, const char *fragfile);
+    // create() in two halves. compile only hands the sources to the
+    // driver, which may build several programs at once if nothing asks
+    // for their results; finishCreate waits for them and reports errors.
+    void compile(const char *vertfile, const char *fragfile);
+    void finishCreate();
     // Tells our OpenGL context to use this shader to draw things
     void useMe();
-    // Pass the given model matrix to this shader on the GPU
+    // Everything shared by the whole frame (camera, sun, time, fog) is
+    // read from the FrameUniforms block; see UniformBlocks. The setters
+    // below change the DrawUniforms block, which every program shares,
+    // so they apply to whatever is drawn next with any program.
+    // Pass the given model matrix to the GPU
     void setModelMatrix(const glm::mat4 &model);
-    // Pass the given Projection * View matrix to this shader on the GPU
-    void setViewProjMatrix(const glm::mat4 &vp);
-    // Pass the given sun Projection * View matrix to this shader on the GPU
-    void setShadowViewProjMatrix(const glm::mat4 &vp);
-    // Pass the given color to this shader on the GPU
+    // Pass the given color to the GPU
     void setGeometryColor(glm::vec4 color);
-    // Pass the given dimension to this shader on the GPU
-    void setDimension(int width, int height);
-    // Pass the camera location (eye) to this shader on the GPU
-    void setEye(glm::vec3 eye);
+    // Pass the player's animation and the frame of it to the GPU
+    void setAnimation(int animation, int currFrame);
     // Draw the given object to our screen using this ShaderProgram's shaders
     void draw(Drawable &d);
     // Draw the given object to our screen multiple times using instanced rendering
@@ -68,18 +60,21 @@ public:
     // Utility function that prints any shader linking errors to the console
     void printLinkInfoLog(int prog);
 
+    // Points the texture and shadow map samplers at the given slots
+    void setSamplers(int textureSlot, int depthSlot);
     void drawInterleaved(Drawable &d, int textureSlot, int depthSlot);
     void drawTransInterleaved(Drawable &d, int textureSlot, int depthSlot);
 
     QString qTextFileRead(const char*);
 
-    void setTime(int time);
-    void setTimeElp(float timeElp);
-    void setCameraPos(glm::vec3);
-    void setCurrFrame(int);
-    void setAnimation(int);
-
 private:
+    // Bytes last uploaded to each uniform location. Uniforms belong to
+    // the program object, so unchanged values can be skipped for good.
+    std::unordered_map<int, std::vector<unsigned char>> m_uniformValues;
+    // Whether value differs from what location last received, in which
+    // case it is remembered as the new value
+    bool uniformChanged(int location, const void *value, size_t bytes);
+
     OpenGLContext* context;   // Since Qt's OpenGL support is done through classes like QOpenGLFunctions_3_2_Core,
         // we need to pass our OpenGL context to the Drawable in order to call GL functions
         // from within this class.
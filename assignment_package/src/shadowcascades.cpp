@@ -0,0 +1,127 @@
+#include "shadowcascades.h"
+#include <iomanip>
+#include <sstream>
+
+ShadowCascades::ShadowCascades() : m_cascades() {}
+
+glm::mat4 ShadowCascades::fitLight(glm::vec3 sunDir, glm::vec3 *center, float radius) {
+    // The sun moves in the XY plane, so Z is never parallel to it
+    glm::vec3 up(0.f, 0.f, 1.f);
+    glm::mat4 lightRotation = glm::lookAt(glm::vec3(0.f), -sunDir, up);
+    glm::vec4 lightSpace = lightRotation * glm::vec4(*center, 1.f);
+    float texel = 2.f * radius / SHADOWMAPSIZE;
+    lightSpace.x = glm::floor(lightSpace.x / texel) * texel;
+    lightSpace.y = glm::floor(lightSpace.y / texel) * texel;
+    *center = glm::vec3(glm::inverse(lightRotation) * lightSpace);
+
+    glm::mat4 view = glm::lookAt(*center + sunDir * SHADOWLIGHTDISTANCE, *center, up);
+    return glm::ortho(-radius, radius, -radius, radius, 1.f, SHADOWLIGHTDISTANCE + radius) * view;
+}
+
+bool ShadowCascades::isStale(const ShadowCascade &c, glm::vec3 eye, glm::vec3 sunDir, glm::ivec2 drawOrigin,
+                             const Terrain &terrain) {
+    if (!c.valid || c.drawOrigin != drawOrigin) {
+        return true;
+    }
+    // The shadow distance follows the adaptive draw distance
+    if (glm::abs(c.radius - c.splitFar * (1.f + SHADOWCACHEMARGIN)) > 0.5f) {
+        return true;
+    }
+    if (glm::distance(eye, c.center) > c.splitFar * SHADOWCACHEMARGIN) {
+        return true;
+    }
+    if (glm::dot(sunDir, c.sunDir) < glm::cos(glm::radians(SHADOWSUNANGLE))) {
+        return true;
+    }
+    return terrain.meshesChangedSince(c.meshRevision, c.viewProj);
+}
+
+void ShadowCascades::update(const Camera &camera, glm::vec3 eye, glm::vec3 sunDir, float shadowDistance,
+                            glm::ivec2 drawOrigin, const Terrain &terrain) {
+    // Each slice is a bit over twice as deep as the one before it
+    static const float fractions[SHADOWCASCADES] = {0.08f, 0.2f, 0.45f, 1.f};
+    float splitNear = camera.getNearClip();
+    for (int i = 0; i < SHADOWCASCADES; i++) {
+        ShadowCascade &c = m_cascades[i];
+        c.splitFar = shadowDistance * fractions[i];
+        if (i < FIRSTCACHEDCASCADE) {
+            // Bounding sphere of the slice's corners
+            glm::mat4 invViewProj = glm::inverse(camera.getViewProj(splitNear, c.splitFar));
+            glm::vec3 corners[8];
+            glm::vec3 center(0.f);
+            for (int k = 0; k < 8; k++) {
+                glm::vec4 p = invViewProj * glm::vec4(k & 1 ? 1.f : -1.f, k & 2 ? 1.f : -1.f, k & 4 ? 1.f : -1.f, 1.f);
+                corners[k] = glm::vec3(p) / p.w;
+                center += corners[k] / 8.f;
+            }
+            float radius = 0.f;
+            for (const glm::vec3 &corner : corners) {
+                radius = glm::max(radius, glm::distance(center, corner));
+            }
+            // A whole-block radius keeps the texel size fixed while turning
+            c.radius = glm::ceil(radius);
+            c.center = center;
+            c.viewProj = fitLight(sunDir, &c.center, c.radius);
+            c.sunDir = sunDir;
+            c.render = true;
+        } else if (isStale(c, eye, sunDir, drawOrigin, terrain)) {
+            c.center = eye;
+            c.radius = c.splitFar * (1.f + SHADOWCACHEMARGIN);
+            c.viewProj = fitLight(sunDir, &c.center, c.radius);
+            c.sunDir = sunDir;
+            c.drawOrigin = drawOrigin;
+            c.valid = false;
+            c.render = true;
+        } else {
+            c.render = false;
+        }
+        splitNear = c.splitFar;
+    }
+}
+
+void ShadowCascades::invalidate() {
+    for (ShadowCascade &c : m_cascades) {
+        c.valid = false;
+    }
+}
+
+void ShadowCascades::rendered(int i, float ms) {
+    ShadowCascade &c = m_cascades[i];
+    c.valid = true;
+    c.meshRevision = ChunkDrawable::meshRevision();
+    c.renderMs = ms;
+    c.renders++;
+}
+
+const ShadowCascade &ShadowCascades::cascade(int i) const {
+    return m_cascades[i];
+}
+
+glm::vec4 ShadowCascades::splits() const {
+    glm::vec4 splits;
+    for (int i = 0; i < SHADOWCASCADES; i++) {
+        splits[i] = m_cascades[i].splitFar;
+    }
+    return splits;
+}
+
+glm::ivec2 ShadowCascades::atlasOffset(int i) {
+    return glm::ivec2((i & 1) * SHADOWMAPSIZE, (i >> 1) * SHADOWMAPSIZE);
+}
+
+std::string ShadowCascades::status() const {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(2);
+    for (int i = 0; i < SHADOWCASCADES; i++) {
+        if (i > 0) {
+            out << " ";
+        }
+        if (m_cascades[i].render) {
+            out << m_cascades[i].renderMs;
+        } else {
+            out << "-";
+        }
+    }
+    out << " ms";
+    return out.str();
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include "glm_includes.h"
+#include "scene/camera.h"
+#include "scene/terrain.h"
+#include <array>
+#include <cstdint>
+#include <string>
+
+// The view is split into SHADOWCASCADES slices, each with its own
+// SHADOWMAPSIZE square shadow map in one 2 x 2 atlas texture
+#define SHADOWCASCADES 4
+#define SHADOWMAPSIZE 1024
+// Cascades from this one on are cached between frames
+#define FIRSTCACHEDCASCADE 2
+// Degrees the sun may move before cached cascades are re-rendered
+#define SHADOWSUNANGLE 0.25f
+// Cached cascades cover this much more than their slice of the view,
+// and are re-rendered once the camera has moved that far
+#define SHADOWCACHEMARGIN 0.1f
+// How far towards the sun each light view starts from its cascade,
+// so that anything between them can cast shadows into it
+#define SHADOWLIGHTDISTANCE 1000.f
+
+// One slice of the view and the shadow map rendered for it
+struct ShadowCascade {
+    glm::mat4 viewProj;
+    // Distance from the camera at which the slice ends
+    float splitFar;
+    // Sphere the light view was fitted around
+    glm::vec3 center;
+    float radius;
+    // What a cached cascade was fitted for, and the mesh revision when
+    // it was last rendered
+    glm::vec3 sunDir;
+    glm::ivec2 drawOrigin;
+    uint64_t meshRevision;
+    // Whether the shadow map matches the fit
+    bool valid;
+    // Whether update decided it must be rendered this frame
+    bool render;
+    // Milliseconds spent submitting its last render, and renders so far
+    float renderMs;
+    int renders;
+
+    ShadowCascade()
+        : viewProj(), splitFar(0.f), center(0.f), radius(0.f), sunDir(0.f), drawOrigin(0),
+          meshRevision(0), valid(false), render(false), renderMs(0.f), renders(0)
+    {}
+};
+
+// Fits shadow cascades to the camera and decides which ones need to be
+// rendered this frame. Near cascades are fitted tightly around their
+// slice of the view and rendered every frame. Cached cascades are
+// fitted around the camera position instead, which does not change
+// when it turns, and keep their shadow map until the camera leaves
+// the margin, the sun moves, the draw range moves or a mesh inside
+// them changes.
+class ShadowCascades {
+private:
+    std::array<ShadowCascade, SHADOWCASCADES> m_cascades;
+
+    // Light view-projection of a sphere, snapped to whole shadow map
+    // texels so that shadow edges do not shimmer as the camera moves
+    static glm::mat4 fitLight(glm::vec3 sunDir, glm::vec3 *center, float radius);
+    // Whether cached cascade c no longer matches the scene
+    static bool isStale(const ShadowCascade &c, glm::vec3 eye, glm::vec3 sunDir, glm::ivec2 drawOrigin,
+                        const Terrain &terrain);
+
+public:
+    ShadowCascades();
+
+    // Splits the view up to shadowDistance, refits every cascade and
+    // marks the ones whose shadow map must be rendered this frame.
+    // terrain tells whether a mesh inside a cached cascade changed.
+    void update(const Camera &camera, glm::vec3 eye, glm::vec3 sunDir, float shadowDistance,
+                glm::ivec2 drawOrigin, const Terrain &terrain);
+    // Marks every cached cascade for re-rendering
+    void invalidate();
+    // Records that cascade i was rendered, taking the given time
+    void rendered(int i, float ms);
+
+    const ShadowCascade &cascade(int i) const;
+    // Far distance of every cascade, for the lambert shader
+    glm::vec4 splits() const;
+    // Lower-left corner of cascade i's tile in the atlas, in texels
+    static glm::ivec2 atlasOffset(int i);
+    // Per-cascade render times, "-" for cascades served from cache
+    std::string status() const;
+};
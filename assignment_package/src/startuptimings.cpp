@@ -0,0 +1,41 @@
+#include "startuptimings.h"
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+StartupTimings::StartupTimings()
+    : m_start(std::chrono::steady_clock::now()), m_last(m_start), m_steps(), m_reported(false)
+{}
+
+void StartupTimings::mark(const std::string &step) {
+    auto now = std::chrono::steady_clock::now();
+    m_steps.push_back({step, std::chrono::duration<double, std::milli>(now - m_last).count()});
+    m_last = now;
+}
+
+double StartupTimings::elapsedMs() const {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_start).count();
+}
+
+bool StartupTimings::hasStep(const std::string &step) const {
+    return std::any_of(m_steps.begin(), m_steps.end(),
+                       [&](const std::pair<std::string, double> &s) { return s.first == step; });
+}
+
+bool StartupTimings::reported() const {
+    return m_reported;
+}
+
+std::string StartupTimings::report() {
+    m_reported = true;
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1);
+    out << std::left << std::setw(20) << "step" << std::right << std::setw(9) << "ms" << std::setw(9) << "total";
+    double total = 0.0;
+    for (const auto &step : m_steps) {
+        total += step.second;
+        out << "\n" << std::left << std::setw(20) << step.first << std::right << std::setw(9) << step.second
+            << std::setw(9) << total;
+    }
+    return out.str();
+}
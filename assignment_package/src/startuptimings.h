@@ -0,0 +1,30 @@
+#pragma once
+#include <chrono>
+#include <string>
+#include <vector>
+
+// Wall-clock time of each step of starting the game, from the GL
+// context being ready to the first frame and on to the last of the
+// zones around the player being meshed. Steps may overlap work started
+// by earlier ones, such as shaders the driver is still compiling.
+class StartupTimings {
+private:
+    std::chrono::steady_clock::time_point m_start, m_last;
+    // Name and milliseconds of each step
+    std::vector<std::pair<std::string, double>> m_steps;
+    bool m_reported;
+
+public:
+    // Starts the clock
+    StartupTimings();
+
+    // Ends a step: the time since the previous one, or since the start
+    void mark(const std::string &step);
+    double elapsedMs() const;
+    bool hasStep(const std::string &step) const;
+
+    // Whether report was called; later marks are not worth logging
+    bool reported() const;
+    // Each step's milliseconds and the running total
+    std::string report();
+};
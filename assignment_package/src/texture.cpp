@@ -4,7 +4,7 @@
 #include <iostream>
 
 Texture::Texture(OpenGLContext *context)
-    : context(context), m_textureHandle(-1), m_textureImage(nullptr)
+    : context(context), m_textureHandle(-1), m_textureImage(nullptr), m_memory(MEMORY_TEXTURES)
 {}
 
 Texture::~Texture()
@@ -27,8 +27,7 @@ void Texture::load(int texSlot = 0)
 {
     context->printGLErrorLog();
 
-    context->glActiveTexture(GL_TEXTURE0 + texSlot);
-    context->glBindTexture(GL_TEXTURE_2D, m_textureHandle);
+    context->glState().bindTexture(texSlot, m_textureHandle);
 
     // These parameters need to be set for EVERY texture you create
     // They don't always have to be set to the values given here, but they do need
@@ -41,12 +40,12 @@ void Texture::load(int texSlot = 0)
     context->glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA,
                           m_textureImage->width(), m_textureImage->height(),
                           0, GL_BGRA, GL_UNSIGNED_BYTE, m_textureImage->bits());
+    m_memory.set(2 * 4 * static_cast<size_t>(m_textureImage->width()) * m_textureImage->height());
     context->printGLErrorLog();
 }
 
 
 void Texture::bind(int texSlot = 0)
 {
-    context->glActiveTexture(GL_TEXTURE0 + texSlot);
-    context->glBindTexture(GL_TEXTURE_2D, m_textureHandle);
+    context->glState().bindTexture(texSlot, m_textureHandle);
 }
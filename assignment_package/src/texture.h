@@ -2,6 +2,7 @@
 
 #include <openglcontext.h>
 #include <glm_includes.h>
+#include "memorystats.h"
 #include <memory>
 
 class Texture
@@ -18,4 +19,6 @@ private:
     OpenGLContext* context;
     GLuint m_textureHandle;
     std::shared_ptr<QImage> m_textureImage;
+    // The image kept in RAM plus its copy on the GPU
+    MemoryAccount m_memory;
 };
@@ -0,0 +1,174 @@
+#include "trace.h"
+#include "smartpointerhelp.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+// The events of one thread. Only that thread records into it; the lock
+// is there for the writer, so it is almost never contended.
+struct TraceBuffer {
+    std::mutex mutex;
+    std::vector<TraceEvent> events;
+    uint64_t recorded;
+    int tid;
+    std::string threadName;
+
+    TraceBuffer(int id)
+        : mutex(), events(), recorded(0), tid(id), threadName("thread " + std::to_string(id))
+    {}
+};
+
+std::atomic<bool> tracing(false);
+const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+// Buffers outlive their threads, so their events can still be
+// written. Pool threads exit when idle and new ones start later, so a
+// finished thread's buffer goes to freeBuffers and the next new thread
+// records into it, on the same track; there are only ever as many
+// buffers as threads that ran at once.
+std::mutex buffersMutex;
+std::vector<uPtr<TraceBuffer>> buffers;
+std::vector<TraceBuffer*> freeBuffers;
+
+// Hands the thread's buffer back when the thread exits
+struct ThreadBufferHolder {
+    TraceBuffer *buffer;
+
+    ThreadBufferHolder() : buffer(nullptr) {}
+    ~ThreadBufferHolder() {
+        if (buffer) {
+            std::lock_guard<std::mutex> lock(buffersMutex);
+            freeBuffers.push_back(buffer);
+        }
+    }
+};
+thread_local ThreadBufferHolder threadBuffer;
+
+TraceBuffer &currentBuffer() {
+    if (threadBuffer.buffer == nullptr) {
+        std::lock_guard<std::mutex> lock(buffersMutex);
+        if (!freeBuffers.empty()) {
+            threadBuffer.buffer = freeBuffers.back();
+            freeBuffers.pop_back();
+        } else {
+            buffers.push_back(mkU<TraceBuffer>(static_cast<int>(buffers.size()) + 1));
+            threadBuffer.buffer = buffers.back().get();
+        }
+    }
+    return *threadBuffer.buffer;
+}
+
+void record(const TraceEvent &e) {
+    TraceBuffer &b = currentBuffer();
+    std::lock_guard<std::mutex> lock(b.mutex);
+    if (b.events.empty()) {
+        b.events.resize(TRACEBUFFEREVENTS);
+    }
+    b.events[b.recorded % TRACEBUFFEREVENTS] = e;
+    b.recorded++;
+}
+
+void writeString(std::ostream &out, const std::string &s) {
+    out << '"';
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            out << '\\';
+        }
+        out << c;
+    }
+    out << '"';
+}
+
+}
+
+bool Tracer::enabled() {
+    return tracing.load(std::memory_order_relaxed);
+}
+
+void Tracer::setEnabled(bool enabled) {
+    tracing.store(enabled, std::memory_order_relaxed);
+}
+
+int64_t Tracer::nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+void Tracer::zone(const char *name, int64_t startNs, int64_t endNs) {
+    record({name, startNs, endNs - startNs, false});
+}
+
+void Tracer::counter(const char *name, int64_t value) {
+    if (enabled()) {
+        record({name, nowNs(), value, true});
+    }
+}
+
+void Tracer::setThreadName(const std::string &name) {
+    TraceBuffer &b = currentBuffer();
+    std::lock_guard<std::mutex> lock(b.mutex);
+    b.threadName = name;
+}
+
+bool Tracer::write(const std::string &path) {
+    std::ofstream out(path);
+    if (!out) {
+        return false;
+    }
+    out << std::fixed << std::setprecision(3);
+    out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    bool first = true;
+    std::lock_guard<std::mutex> buffersLock(buffersMutex);
+    for (const uPtr<TraceBuffer> &b : buffers) {
+        std::vector<TraceEvent> events;
+        std::string threadName;
+        {
+            std::lock_guard<std::mutex> lock(b->mutex);
+            uint64_t count = std::min<uint64_t>(b->recorded, TRACEBUFFEREVENTS);
+            events.reserve(count);
+            for (uint64_t i = b->recorded - count; i < b->recorded; i++) {
+                events.push_back(b->events[i % TRACEBUFFEREVENTS]);
+            }
+            threadName = b->threadName;
+        }
+        out << (first ? "" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": "
+            << b->tid << ", \"args\": {\"name\": ";
+        writeString(out, threadName);
+        out << "}}";
+        first = false;
+        for (const TraceEvent &e : events) {
+            out << ",\n{\"name\": ";
+            writeString(out, e.name);
+            out << ", \"pid\": 1, \"tid\": " << b->tid << ", \"ts\": " << e.startNs / 1e3;
+            if (e.counter) {
+                out << ", \"ph\": \"C\", \"args\": {\"value\": " << e.value << "}}";
+            } else {
+                out << ", \"ph\": \"X\", \"dur\": " << e.value / 1e3 << "}";
+            }
+        }
+    }
+    out << "\n]}\n";
+    return bool(out);
+}
+
+TraceScope::TraceScope(const char *name)
+    : m_name(Tracer::enabled() ? name : nullptr), m_startNs(m_name ? Tracer::nowNs() : 0)
+{
+    // Takes the thread's buffer before the zone starts, so that a
+    // buffer freed meanwhile by an exiting thread cannot put this zone
+    // on a track where it overlaps that thread's last one
+    if (m_name) {
+        currentBuffer();
+    }
+}
+
+TraceScope::~TraceScope() {
+    if (m_name) {
+        Tracer::zone(m_name, m_startNs, Tracer::nowNs());
+    }
+}
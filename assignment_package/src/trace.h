@@ -0,0 +1,57 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+// Events kept per thread; older ones are overwritten
+#define TRACEBUFFEREVENTS 32768
+// Where the T key writes the trace unless MINIMINECRAFT_TRACE names a file
+#define TRACEDEFAULTPATH "trace.json"
+
+// One timed zone or counter sample. Names must be string literals,
+// since only the pointer is kept.
+struct TraceEvent {
+    const char *name;
+    int64_t startNs;
+    // Length of a zone, or the value of a counter
+    int64_t value;
+    bool counter;
+};
+
+// Records timed zones into a ring buffer per thread and writes them as
+// a Chrome trace (chrome://tracing, ui.perfetto.dev) with one track
+// per buffer. A thread that exits leaves its buffer to the next new
+// one. While it is disabled a zone costs one atomic load.
+class Tracer {
+public:
+    static bool enabled();
+    static void setEnabled(bool enabled);
+
+    // Nanoseconds since the first call, on a monotonic clock
+    static int64_t nowNs();
+    static void zone(const char *name, int64_t startNs, int64_t endNs);
+    // Samples a value shown as a graph above the thread tracks, such
+    // as the length of a queue
+    static void counter(const char *name, int64_t value);
+    // Names the calling thread's track
+    static void setThreadName(const std::string &name);
+
+    // Writes every thread's buffered events; safe while others record
+    static bool write(const std::string &path);
+};
+
+// Records a zone from construction to destruction if tracing was
+// enabled at construction
+class TraceScope {
+private:
+    const char *m_name;
+    int64_t m_startNs;
+
+public:
+    explicit TraceScope(const char *name);
+    ~TraceScope();
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+// Traces the rest of the enclosing block as a zone called name
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
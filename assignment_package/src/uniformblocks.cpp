@@ -0,0 +1,109 @@
+#include "uniformblocks.h"
+#include "glstatecache.h"
+#include <cstring>
+
+// std140 puts these members at the same offsets glm does, as long as
+// every vec3 is followed by a scalar and the sizes stay as they are
+static_assert(sizeof(FrameUniforms) == 448, "FrameUniforms no longer matches its std140 block");
+static_assert(sizeof(DrawUniforms) == 160, "DrawUniforms no longer matches its std140 block");
+
+FrameUniforms::FrameUniforms()
+    : viewProj(), invViewProj(), cascadeViewProj(), cameraPos(0.f), timeElapsed(0.f),
+      cascadeSplits(0.f), fogRange(0.f), dimensions(0), time(0), padding{0, 0, 0}
+{}
+
+DrawUniforms::DrawUniforms()
+    : model(), modelInvTr(), color(0.f), cascade(0), animation(0), currFrame(0), padding(0)
+{}
+
+UniformBlocks::UniformBlocks(QOpenGLExtraFunctions *gl, GLStateCache *state)
+    : mp_gl(gl), mp_state(state), m_frameBuffer(0), m_drawBuffer(0), m_frame(), m_draw(),
+      m_drawDirty(true), m_drawStride(0), m_nextDrawSlot(0)
+{}
+
+void UniformBlocks::create() {
+    GLint alignment = 256;
+    mp_gl->glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    m_drawStride = (sizeof(DrawUniforms) + alignment - 1) / alignment * alignment;
+
+    mp_gl->glGenBuffers(1, &m_frameBuffer);
+    mp_gl->glBindBuffer(GL_UNIFORM_BUFFER, m_frameBuffer);
+    mp_gl->glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniforms), &m_frame, GL_STREAM_DRAW);
+    mp_gl->glBindBufferBase(GL_UNIFORM_BUFFER, FRAMEUNIFORMBINDING, m_frameBuffer);
+
+    mp_gl->glGenBuffers(1, &m_drawBuffer);
+    mp_gl->glBindBuffer(GL_UNIFORM_BUFFER, m_drawBuffer);
+    mp_gl->glBufferData(GL_UNIFORM_BUFFER, m_drawStride * DRAWUNIFORMSLOTS, nullptr, GL_STREAM_DRAW);
+    m_nextDrawSlot = 0;
+    m_drawDirty = true;
+}
+
+void UniformBlocks::destroy() {
+    mp_gl->glDeleteBuffers(1, &m_frameBuffer);
+    mp_gl->glDeleteBuffers(1, &m_drawBuffer);
+    m_frameBuffer = 0;
+    m_drawBuffer = 0;
+}
+
+FrameUniforms &UniformBlocks::frame() {
+    return m_frame;
+}
+
+void UniformBlocks::uploadFrame() {
+    // Respecifying the whole buffer lets the driver hand out fresh
+    // storage instead of waiting on last frame's draws
+    mp_gl->glBindBuffer(GL_UNIFORM_BUFFER, m_frameBuffer);
+    mp_gl->glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniforms), &m_frame, GL_STREAM_DRAW);
+    mp_state->countUniform(false);
+    mp_state->countUpload(sizeof(FrameUniforms));
+}
+
+void UniformBlocks::setModel(const glm::mat4 &model) {
+    if (std::memcmp(&model[0][0], &m_draw.model[0][0], sizeof(glm::mat4)) == 0) {
+        return;
+    }
+    m_draw.model = model;
+    m_draw.modelInvTr = glm::inverse(glm::transpose(model));
+    m_drawDirty = true;
+}
+
+void UniformBlocks::setColor(glm::vec4 color) {
+    if (color != m_draw.color) {
+        m_draw.color = color;
+        m_drawDirty = true;
+    }
+}
+
+void UniformBlocks::setCascade(int cascade) {
+    if (cascade != m_draw.cascade) {
+        m_draw.cascade = cascade;
+        m_drawDirty = true;
+    }
+}
+
+void UniformBlocks::setAnimation(int animation, int currFrame) {
+    if (animation != m_draw.animation || currFrame != m_draw.currFrame) {
+        m_draw.animation = animation;
+        m_draw.currFrame = currFrame;
+        m_drawDirty = true;
+    }
+}
+
+void UniformBlocks::flushDraw() {
+    if (!m_drawDirty) {
+        mp_state->countUniform(true);
+        return;
+    }
+    mp_gl->glBindBuffer(GL_UNIFORM_BUFFER, m_drawBuffer);
+    if (m_nextDrawSlot == DRAWUNIFORMSLOTS) {
+        mp_gl->glBufferData(GL_UNIFORM_BUFFER, m_drawStride * DRAWUNIFORMSLOTS, nullptr, GL_STREAM_DRAW);
+        m_nextDrawSlot = 0;
+    }
+    GLintptr offset = static_cast<GLintptr>(m_nextDrawSlot) * m_drawStride;
+    mp_gl->glBufferSubData(GL_UNIFORM_BUFFER, offset, sizeof(DrawUniforms), &m_draw);
+    mp_gl->glBindBufferRange(GL_UNIFORM_BUFFER, DRAWUNIFORMBINDING, m_drawBuffer, offset, sizeof(DrawUniforms));
+    m_nextDrawSlot++;
+    m_drawDirty = false;
+    mp_state->countUniform(false);
+    mp_state->countUpload(sizeof(DrawUniforms));
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include <QOpenGLExtraFunctions>
+#include "glm_includes.h"
+
+class GLStateCache;
+
+// Binding points of the uniform blocks every shader program shares
+#define FRAMEUNIFORMBINDING 0
+#define DRAWUNIFORMBINDING 1
+// Per-draw blocks written before the draw buffer is orphaned and
+// written from the start again
+#define DRAWUNIFORMSLOTS 256
+
+// CPU copy of the std140 FrameUniforms block, which holds everything
+// that is the same for every draw of a frame. The member order and
+// padding must match the block declared in the shaders.
+struct FrameUniforms {
+    glm::mat4 viewProj;
+    // Inverse of viewProj, for casting rays from the sky's screen quad
+    glm::mat4 invViewProj;
+    // Light view-projection of each shadow cascade, see ShadowCascades
+    glm::mat4 cascadeViewProj[4];
+    glm::vec3 cameraPos;
+    float timeElapsed;
+    glm::vec4 cascadeSplits;
+    glm::vec2 fogRange;
+    glm::ivec2 dimensions;
+    int time;
+    int padding[3];
+
+    FrameUniforms();
+};
+
+// CPU copy of the std140 DrawUniforms block, which holds what may
+// change between draws
+struct DrawUniforms {
+    glm::mat4 model;
+    glm::mat4 modelInvTr;
+    glm::vec4 color;
+    // Shadow cascade the shadow program renders into
+    int cascade;
+    // Player animation and frame of it
+    int animation;
+    int currFrame;
+    int padding;
+
+    DrawUniforms();
+};
+
+// Owns the uniform buffers behind FrameUniforms and DrawUniforms.
+// The frame block is uploaded once per frame however many programs
+// read it. Draw state is uploaded lazily: setters only change the CPU
+// copy, and flushDraw writes it to the next slot of a ring buffer and
+// binds that slot, so earlier draws still in flight keep their values.
+class UniformBlocks {
+private:
+    QOpenGLExtraFunctions *mp_gl;
+    GLStateCache *mp_state;
+    GLuint m_frameBuffer;
+    GLuint m_drawBuffer;
+    FrameUniforms m_frame;
+    DrawUniforms m_draw;
+    // Whether m_draw changed since it was last flushed
+    bool m_drawDirty;
+    // Bytes between draw slots, a multiple of the uniform buffer offset alignment
+    GLint m_drawStride;
+    int m_nextDrawSlot;
+
+public:
+    UniformBlocks(QOpenGLExtraFunctions *gl, GLStateCache *state);
+
+    // Allocates both buffers and binds them to their binding points;
+    // call once the GL context exists
+    void create();
+    void destroy();
+
+    // Fill in, then call uploadFrame before the first draw of the frame
+    FrameUniforms &frame();
+    void uploadFrame();
+
+    void setModel(const glm::mat4 &model);
+    void setColor(glm::vec4 color);
+    void setCascade(int cascade);
+    void setAnimation(int animation, int currFrame);
+    // Uploads and binds the draw state if it changed; call right before drawing
+    void flushDraw();
+};
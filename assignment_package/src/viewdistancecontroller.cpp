@@ -0,0 +1,114 @@
+#include "viewdistancecontroller.h"
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+ViewDistanceController::ViewDistanceController(int radius, int minRadius, int maxRadius)
+    : m_radius(radius), m_minRadius(minRadius), m_maxRadius(maxRadius), m_enabled(true),
+      m_frameMs(), m_nextFrame(0), m_frameMsSum(0.f), m_uploadBacklog(0), m_pendingZones(0),
+      m_growSince(-1), m_shrinkSince(-1), m_lastChange(0), m_lastGrow(-1), m_lastDecision(VIEW_HOLD), m_reason("warming up")
+{
+    m_frameMs.reserve(FRAMETIMEWINDOW);
+}
+
+void ViewDistanceController::resetWindow() {
+    m_frameMs.clear();
+    m_nextFrame = 0;
+    m_frameMsSum = 0.f;
+    m_growSince = -1;
+    m_shrinkSince = -1;
+}
+
+int ViewDistanceController::update(float frameMs, int uploadBacklog, int pendingZones, int64_t nowMSecs) {
+    if (m_frameMs.size() < FRAMETIMEWINDOW) {
+        m_frameMs.push_back(frameMs);
+    } else {
+        m_frameMsSum -= m_frameMs[m_nextFrame];
+        m_frameMs[m_nextFrame] = frameMs;
+    }
+    m_frameMsSum += frameMs;
+    m_nextFrame = (m_nextFrame + 1) % FRAMETIMEWINDOW;
+    m_uploadBacklog = uploadBacklog;
+    m_pendingZones = pendingZones;
+
+    if (!m_enabled || m_frameMs.size() < FRAMETIMEWINDOW) {
+        return m_radius;
+    }
+
+    float average = averageFrameMs();
+    std::string shrinkReason;
+    if (average > FRAMEBUDGETMS) {
+        shrinkReason = "frame time";
+    } else if (uploadBacklog > MAXUPLOADBACKLOG) {
+        shrinkReason = "upload backlog";
+    } else if (pendingZones > MAXPENDINGZONES
+               && (m_lastGrow < 0 || nowMSecs - m_lastGrow >= VIEWDISTANCESETTLEMS)) {
+        shrinkReason = "generation queue";
+    }
+    // The gap between the two thresholds keeps a radius that is just
+    // affordable from growing straight back into one that is not
+    bool canGrow = average < FRAMEBUDGETMS * FRAMEGROWFRACTION
+            && uploadBacklog == 0 && pendingZones <= MAXPENDINGZONES / 4;
+
+    m_shrinkSince = shrinkReason.empty() ? -1 : (m_shrinkSince < 0 ? nowMSecs : m_shrinkSince);
+    m_growSince = canGrow ? (m_growSince < 0 ? nowMSecs : m_growSince) : -1;
+
+    if (nowMSecs - m_lastChange < VIEWDISTANCECOOLDOWNMS) {
+        return m_radius;
+    }
+    if (m_shrinkSince >= 0 && nowMSecs - m_shrinkSince >= VIEWDISTANCEHOLDMS && m_radius > m_minRadius) {
+        m_radius--;
+        m_lastDecision = VIEW_SHRINK;
+        m_reason = shrinkReason;
+    } else if (m_growSince >= 0 && nowMSecs - m_growSince >= VIEWDISTANCEHOLDMS && m_radius < m_maxRadius) {
+        m_radius++;
+        m_lastGrow = nowMSecs;
+        m_lastDecision = VIEW_GROW;
+        m_reason = "headroom";
+    } else {
+        return m_radius;
+    }
+    m_lastChange = nowMSecs;
+    // Frames drawn at the old radius say nothing about the new one, and
+    // neither do the reasons to change it
+    resetWindow();
+    return m_radius;
+}
+
+int ViewDistanceController::radius() const {
+    return m_radius;
+}
+
+void ViewDistanceController::setEnabled(bool enabled) {
+    m_enabled = enabled;
+    m_lastDecision = VIEW_HOLD;
+    m_reason = enabled ? "warming up" : "fixed";
+    resetWindow();
+}
+
+bool ViewDistanceController::enabled() const {
+    return m_enabled;
+}
+
+float ViewDistanceController::averageFrameMs() const {
+    return m_frameMs.empty() ? 0.f : m_frameMsSum / m_frameMs.size();
+}
+
+ViewDistanceDecision ViewDistanceController::lastDecision() const {
+    return m_lastDecision;
+}
+
+std::string ViewDistanceController::status() const {
+    std::ostringstream out;
+    out << m_radius << " zones, " << std::fixed << std::setprecision(1) << averageFrameMs() << " ms";
+    switch (m_lastDecision) {
+    case VIEW_GROW: out << ", grew: "; break;
+    case VIEW_SHRINK: out << ", shrank: "; break;
+    default: out << ", "; break;
+    }
+    out << m_reason;
+    if (m_uploadBacklog > 0 || m_pendingZones > 0) {
+        out << " (" << m_uploadBacklog << " up, " << m_pendingZones << " gen)";
+    }
+    return out.str();
+}
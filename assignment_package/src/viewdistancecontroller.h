@@ -0,0 +1,69 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Milliseconds of CPU work per frame the controller keeps the draw
+// distance under, and the fraction of it below which it grows again
+#define FRAMEBUDGETMS 14.f
+#define FRAMEGROWFRACTION 0.6f
+// Frames averaged into the frame time the controller acts on
+#define FRAMETIMEWINDOW 60
+// Backlogs above which the world is falling behind the player: meshes
+// waiting to be uploaded and zones waiting to be generated or meshed
+#define MAXUPLOADBACKLOG 48
+#define MAXPENDINGZONES 12
+// How long a reason to change must persist before the radius changes,
+// and how long after a change the next one may happen
+#define VIEWDISTANCEHOLDMS 2000
+#define VIEWDISTANCECOOLDOWNMS 4000
+// How long after growing the generation queue is no reason to shrink:
+// growing queues the whole new ring of zones at once
+#define VIEWDISTANCESETTLEMS 15000
+
+enum ViewDistanceDecision : unsigned char {
+    VIEW_HOLD, VIEW_GROW, VIEW_SHRINK
+};
+
+// Picks the number of zones drawn around the player from how long
+// frames take and how far the chunk pipeline lags behind. It shrinks
+// when either is over budget and grows only well under budget with no
+// backlog; both must hold for VIEWDISTANCEHOLDMS and changes are
+// VIEWDISTANCECOOLDOWNMS apart, so it settles instead of oscillating.
+class ViewDistanceController {
+private:
+    int m_radius;
+    int m_minRadius, m_maxRadius;
+    bool m_enabled;
+    // Ring buffer of the last FRAMETIMEWINDOW frame times
+    std::vector<float> m_frameMs;
+    size_t m_nextFrame;
+    float m_frameMsSum;
+    int m_uploadBacklog;
+    int m_pendingZones;
+    // When the current reason to grow or shrink first appeared, or -1
+    int64_t m_growSince, m_shrinkSince;
+    int64_t m_lastChange;
+    // When the radius last grew, or -1
+    int64_t m_lastGrow;
+    ViewDistanceDecision m_lastDecision;
+    // Why the radius last changed, or is being held
+    std::string m_reason;
+
+    void resetWindow();
+
+public:
+    ViewDistanceController(int radius, int minRadius, int maxRadius);
+
+    // Records one frame and returns the radius to draw from now on
+    int update(float frameMs, int uploadBacklog, int pendingZones, int64_t nowMSecs);
+    int radius() const;
+    // A disabled controller keeps the current radius
+    void setEnabled(bool enabled);
+    bool enabled() const;
+
+    float averageFrameMs() const;
+    ViewDistanceDecision lastDecision() const;
+    // One line summary for the player info window
+    std::string status() const;
+};
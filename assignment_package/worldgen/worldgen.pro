@@ -0,0 +1,20 @@
+# Generates and meshes zones without a window or a GPU and reports how
+# fast. Built by ../headless.pro, which builds the core library first:
+#   ./worldgen [--zones N] [--threads T]
+QT = core
+
+TARGET = worldgen
+TEMPLATE = app
+CONFIG += console
+CONFIG += c++1z
+CONFIG -= app_bundle
+CONFIG -= debug
+CONFIG += release
+
+INCLUDEPATH += ../include ../src
+win32: LIBS += -L$$OUT_PWD/../core/release
+LIBS += -L$$OUT_PWD/../core -lminecraftcore
+unix: PRE_TARGETDEPS += $$OUT_PWD/../core/libminecraftcore.a
+
+SOURCES += \
+    $$PWD/worldgenmain.cpp
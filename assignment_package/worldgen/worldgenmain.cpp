@@ -0,0 +1,156 @@
+#include "scene/world.h"
+#include "scene/blocktypeworker.h"
+#include "scene/vboworker.h"
+#include "memorystats.h"
+#include <QThread>
+#include <QThreadPool>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+namespace {
+
+struct WorldGenOptions {
+    int zones;
+    int threads;
+
+    WorldGenOptions() : zones(64), threads(QThread::idealThreadCount()) {}
+};
+
+// Totals over every mesh the VBOWorkers hand back
+struct MeshTotals {
+    uint64_t vertices, transVertices;
+    uint64_t indices, transIndices;
+
+    MeshTotals() : vertices(0), transVertices(0), indices(0), transIndices(0) {}
+
+    void add(const ChunkVBOData &data) {
+        // Three vec4s per vertex: position, normal and UV
+        vertices += data.vertex_data.size() / 3;
+        transVertices += data.trans_vertex_data.size() / 3;
+        indices += data.idx_data.size();
+        transIndices += data.trans_idx_data.size();
+    }
+
+    uint64_t bytes() const {
+        return (vertices + transVertices) * 3 * sizeof(glm::vec4) + (indices + transIndices) * sizeof(uint32_t);
+    }
+};
+
+// Returns false if the arguments are not understood
+bool parseArgs(int argc, char *argv[], WorldGenOptions *options) {
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--zones") == 0 && hasValue) {
+            options->zones = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--threads") == 0 && hasValue) {
+            options->threads = std::max(1, std::atoi(argv[++i]));
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+double mib(uint64_t bytes) {
+    return bytes / (1024.0 * 1024.0);
+}
+
+}
+
+// Runs the game's chunk pipeline, minus the upload: BlockTypeWorkers
+// generate the zones, and every Chunk they finish goes to a VBOWorker.
+// Zones are laid out in a square around the origin.
+int main(int argc, char *argv[]) {
+    WorldGenOptions options;
+    if (!parseArgs(argc, argv, &options)) {
+        std::cerr << "Usage: worldgen [--zones N] [--threads T]" << std::endl;
+        return 1;
+    }
+    QThreadPool::globalInstance()->setMaxThreadCount(options.threads);
+    // Same format as the game's; see MemoryStats::parseBudgets
+    const char *budgets = std::getenv("MINIMINECRAFT_MEMORY_BUDGETS");
+    if (budgets && !MemoryStats::parseBudgets(budgets)) {
+        std::cerr << "Ignoring malformed MINIMINECRAFT_MEMORY_BUDGETS" << std::endl;
+    }
+
+    World world;
+    int side = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(options.zones))));
+    std::vector<int64_t> zones;
+    std::vector<std::vector<Chunk*>> zoneChunks;
+    // Every Chunk exists before any worker starts, since workers must
+    // not race with insertions into the World
+    for (int i = 0; i < options.zones; i++) {
+        int x = 64 * (i % side - side / 2), z = 64 * (i / side - side / 2);
+        zones.push_back(toKey(x, z));
+        world.markZonePending(zones.back());
+        std::vector<Chunk*> chunks;
+        for (int cx = 0; cx < 64; cx += 16) {
+            for (int cz = 0; cz < 64; cz += 16) {
+                chunks.push_back(world.createChunkAt(x + cx, z + cz));
+            }
+        }
+        zoneChunks.push_back(chunks);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < zones.size(); i++) {
+        for (Chunk *c : zoneChunks[i]) {
+            c->stampPipeline(STAMP_REQUESTED);
+        }
+        QThreadPool::globalInstance()->start(new BlockTypeWorker(&world, zones[i], zoneChunks[i],
+                                                                 &world.m_chunksWithOnlyBlockData,
+                                                                 &world.m_chunksWithOnlyBlockDataLock));
+    }
+
+    MeshTotals meshes;
+    std::vector<ChunkVBOData> meshed;
+    while (world.pendingZoneCount() > 0) {
+        world.m_chunksWithOnlyBlockDataLock.lock();
+        for (Chunk *c : world.m_chunksWithOnlyBlockData) {
+            QThreadPool::globalInstance()->start(new VBOWorker(&world.m_chunksWithVBOData, c,
+                                                               &world.m_chunksWithVBODataLock));
+        }
+        world.m_chunksWithOnlyBlockData.clear();
+        world.m_chunksWithOnlyBlockDataLock.unlock();
+
+        world.m_chunksWithVBODataLock.lock();
+        meshed.swap(world.m_chunksWithVBOData);
+        world.m_chunksWithVBODataLock.unlock();
+        for (ChunkVBOData &data : meshed) {
+            meshes.add(data);
+            world.markChunkUploaded(data.associated_chunk);
+        }
+        meshed.clear();
+        QThread::msleep(1);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    QThreadPool::globalInstance()->waitForDone();
+
+    int chunks = world.chunkCount();
+    std::cout << std::fixed << std::setprecision(2)
+              << options.zones << " zones (" << chunks << " chunks) on " << options.threads << " threads in "
+              << seconds << " s" << std::endl
+              << "  " << options.zones / seconds << " zones/s, " << chunks / seconds << " chunks/s" << std::endl
+              << "  chunk memory: " << mib(world.chunkMemory()) << " MiB, "
+              << world.chunkMemory() / std::max(chunks, 1) << " B per chunk" << std::endl
+              << "  meshes: " << mib(meshes.bytes()) << " MiB, " << meshes.bytes() / std::max(chunks, 1)
+              << " B per chunk" << std::endl
+              << "    opaque: " << meshes.vertices << " vertices, " << meshes.indices / 3 << " triangles" << std::endl
+              << "    translucent: " << meshes.transVertices << " vertices, " << meshes.transIndices / 3
+              << " triangles" << std::endl
+              << "Latency (ms):" << std::endl << world.pipelineLatency().status() << std::endl
+              << "Memory (MiB):" << std::endl << MemoryStats::status(chunks, world.compressedChunkCount(),
+                                                                     Chunk::compressionCount(),
+                                                                     Chunk::decompressionCount()) << std::endl;
+    for (int i = 0; i < MEMORYCATEGORIES; i++) {
+        if (MemoryStats::exceededBudget(static_cast<MemoryCategory>(i))) {
+            return 1;
+        }
+    }
+    return 0;
+}